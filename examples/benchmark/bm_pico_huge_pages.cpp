@@ -0,0 +1,167 @@
+#include <cstdint>
+#include <memory_resource>
+#include <pico_toolshed/point.hpp>
+#include <pico_tree/kd_tree.hpp>
+#include <pico_tree/vector_traits.hpp>
+#include <pico_understory/huge_page_memory_resource.hpp>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "benchmark.hpp"
+
+namespace {
+
+// Counts the dTLB load misses of the calling thread using a perf event. The
+// count is unavailable when perf events are not supported or restricted, such
+// as by a perf_event_paranoid setting or inside a container.
+class DtlbMissCounter {
+ public:
+  DtlbMissCounter() {
+#if defined(__linux__)
+    perf_event_attr attr{};
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(perf_event_attr);
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+
+  ~DtlbMissCounter() {
+#if defined(__linux__)
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+#endif
+  }
+
+  bool available() const { return fd_ >= 0; }
+
+  void Start() {
+#if defined(__linux__)
+    if (available()) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  std::uint64_t Stop() {
+    std::uint64_t count = 0;
+#if defined(__linux__)
+    if (available()) {
+      ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+#endif
+    return count;
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+}  // namespace
+
+class BmPicoHugePages : public pico_tree::Benchmark {
+ protected:
+  template <typename Tree_>
+  void RunKnn(benchmark::State& state, Tree_ const& tree, int knn_count) {
+    DtlbMissCounter counter;
+    std::uint64_t misses = 0;
+
+    for (auto _ : state) {
+      std::vector<pico_tree::Neighbor<Index, Scalar>> results;
+      std::size_t sum = 0;
+      counter.Start();
+      for (auto const& p : points_test_) {
+        tree.SearchKnn(p, knn_count, results);
+        benchmark::DoNotOptimize(sum += results.size());
+      }
+      misses += counter.Stop();
+    }
+
+    if (counter.available()) {
+      state.counters["dtlb_misses"] = benchmark::Counter(
+          static_cast<double>(misses), benchmark::Counter::kAvgIterations);
+    }
+  }
+};
+
+// The points are owned by the tree such that they can be placed in huge pages
+// as well.
+template <typename PointX, typename Allocator_>
+using PicoKdTreeCtSldMid =
+    pico_tree::KdTree<std::vector<PointX, Allocator_>>;
+
+// ****************************************************************************
+// Knn
+// ****************************************************************************
+
+BENCHMARK_DEFINE_F(BmPicoHugePages, KnnCtSldMid)(benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+  int knn_count = state.range(1);
+
+  PicoKdTreeCtSldMid<PointX, std::allocator<PointX>> tree(
+      points_tree_, max_leaf_size);
+
+  RunKnn(state, tree, knn_count);
+}
+
+BENCHMARK_DEFINE_F(BmPicoHugePages, KnnCtSldMidThp)(benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+  int knn_count = state.range(1);
+
+  pico_tree::HugePageMemoryResource resource(
+      pico_tree::HugePageMode::kTransparent);
+  std::pmr::vector<PointX> points(
+      points_tree_.begin(), points_tree_.end(), &resource);
+  PicoKdTreeCtSldMid<PointX, std::pmr::polymorphic_allocator<PointX>> tree(
+      std::move(points), max_leaf_size, &resource);
+
+  RunKnn(state, tree, knn_count);
+}
+
+BENCHMARK_DEFINE_F(BmPicoHugePages, KnnCtSldMidHtlb)(benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+  int knn_count = state.range(1);
+
+  pico_tree::HugePageMemoryResource resource(
+      pico_tree::HugePageMode::kExplicit);
+  std::pmr::vector<PointX> points(
+      points_tree_.begin(), points_tree_.end(), &resource);
+  PicoKdTreeCtSldMid<PointX, std::pmr::polymorphic_allocator<PointX>> tree(
+      std::move(points), max_leaf_size, &resource);
+
+  RunKnn(state, tree, knn_count);
+}
+
+// Argument 1: Maximum leaf size.
+// Argument 2: The amount of nearest neighbors to search for.
+BENCHMARK_REGISTER_F(BmPicoHugePages, KnnCtSldMid)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({8, 1})
+    ->Args({8, 8});
+
+BENCHMARK_REGISTER_F(BmPicoHugePages, KnnCtSldMidThp)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({8, 1})
+    ->Args({8, 8});
+
+BENCHMARK_REGISTER_F(BmPicoHugePages, KnnCtSldMidHtlb)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({8, 1})
+    ->Args({8, 8});
+
+BENCHMARK_MAIN();
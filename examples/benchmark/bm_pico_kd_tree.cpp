@@ -1,26 +1,96 @@
 #include <pico_toolshed/dynamic_space.hpp>
 #include <pico_toolshed/point.hpp>
 #include <pico_tree/kd_tree.hpp>
+#include <pico_tree/map_traits.hpp>
 #include <pico_tree/vector_traits.hpp>
 
 #include "benchmark.hpp"
 
-class BmPicoKdTree : public pico_tree::Benchmark {
- public:
-};
-
 template <typename PointX>
 using PicoCtSpace = std::reference_wrapper<std::vector<PointX>>;
 
 template <typename PointX>
 using PicoRtSpace = DynamicSpace<std::reference_wrapper<std::vector<PointX>>>;
 
+// A PicoCtSpace with its own PrefetchTraits.
+template <typename PointX, bool PrefetchNodes_, pico_tree::Size PointDistance_>
+struct PicoPfSpace : public PicoCtSpace<PointX> {
+  using PicoCtSpace<PointX>::reference_wrapper;
+};
+
+namespace pico_tree {
+
+template <typename PointX, bool PrefetchNodes_, Size PointDistance_>
+struct SpaceTraits<PicoPfSpace<PointX, PrefetchNodes_, PointDistance_>>
+    : public SpaceTraits<PicoCtSpace<PointX>> {
+  using SpaceType = PicoPfSpace<PointX, PrefetchNodes_, PointDistance_>;
+};
+
+template <typename PointX, bool PrefetchNodes_, Size PointDistance_>
+struct PrefetchTraits<PicoPfSpace<PointX, PrefetchNodes_, PointDistance_>> {
+  static bool constexpr kPrefetchNodes = PrefetchNodes_;
+  static Size constexpr kPrefetchPointDistance = PointDistance_;
+};
+
+}  // namespace pico_tree
+
 template <typename PointX>
 using PicoKdTreeCtSldMid = pico_tree::KdTree<PicoCtSpace<PointX>>;
 
+template <typename PointX, bool PrefetchNodes_, pico_tree::Size PointDistance_>
+using PicoKdTreePfSldMid =
+    pico_tree::KdTree<PicoPfSpace<PointX, PrefetchNodes_, PointDistance_>>;
+
 template <typename PointX>
 using PicoKdTreeRtSldMid = pico_tree::KdTree<PicoRtSpace<PointX>>;
 
+template <typename PointX>
+using PicoKdTreeCtLngMed = pico_tree::KdTree<
+    PicoCtSpace<PointX>,
+    pico_tree::L2Squared,
+    pico_tree::SplittingRule::kLongestMedian>;
+
+template <typename PointX>
+using PicoKdTreeCtSmpMed = pico_tree::KdTree<
+    PicoCtSpace<PointX>,
+    pico_tree::L2Squared,
+    pico_tree::SplittingRule::kSampledMedian>;
+
+template <typename PointX>
+using PicoKdTreeCtMorton = pico_tree::KdTree<
+    PicoCtSpace<PointX>,
+    pico_tree::L2Squared,
+    pico_tree::SplittingRule::kMorton>;
+
+template <typename PointX>
+using PicoKdTreeCtSah = pico_tree::KdTree<
+    PicoCtSpace<PointX>,
+    pico_tree::L2Squared,
+    pico_tree::SplittingRule::kSurfaceAreaHeuristic>;
+
+class BmPicoKdTree : public pico_tree::Benchmark {
+ protected:
+  // The prefetch benchmarks compare against KnnCtSldMid.
+  template <bool PrefetchNodes_, pico_tree::Size PointDistance_>
+  void KnnPfSldMid(benchmark::State& state) {
+    int max_leaf_size = state.range(0);
+    int knn_count = state.range(1);
+
+    PicoKdTreePfSldMid<PointX, PrefetchNodes_, PointDistance_> tree(
+        PicoPfSpace<PointX, PrefetchNodes_, PointDistance_>(points_tree_),
+        max_leaf_size);
+
+    for (auto _ : state) {
+      std::vector<pico_tree::Neighbor<Index, Scalar>> results;
+      std::size_t sum = 0;
+      for (auto const& p : points_test_) {
+        tree.SearchKnn(p, knn_count, results);
+        benchmark::DoNotOptimize(sum += results.size());
+      }
+    }
+  }
+};
+
 // ****************************************************************************
 // Building the tree
 // ****************************************************************************
@@ -30,6 +100,8 @@ BENCHMARK_DEFINE_F(BmPicoKdTree, BuildCtSldMid)(benchmark::State& state) {
 
   for (auto _ : state) {
     PicoKdTreeCtSldMid<PointX> tree(points_tree_, max_leaf_size);
+    state.counters["peak_memory"] =
+        static_cast<double>(tree.peak_build_memory());
   }
 }
 
@@ -42,6 +114,44 @@ BENCHMARK_DEFINE_F(BmPicoKdTree, BuildRtSldMid)(benchmark::State& state) {
   }
 }
 
+BENCHMARK_DEFINE_F(BmPicoKdTree, BuildCtLngMed)(benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+
+  for (auto _ : state) {
+    PicoKdTreeCtLngMed<PointX> tree(points_tree_, max_leaf_size);
+    state.counters["peak_memory"] =
+        static_cast<double>(tree.peak_build_memory());
+  }
+}
+
+BENCHMARK_DEFINE_F(BmPicoKdTree, BuildCtSmpMed)(benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+  pico_tree::SplittingRuleOptions options;
+  options.sample_size = static_cast<pico_tree::Size>(state.range(1));
+
+  for (auto _ : state) {
+    PicoKdTreeCtSmpMed<PointX> tree(points_tree_, max_leaf_size, options);
+  }
+}
+
+BENCHMARK_DEFINE_F(BmPicoKdTree, BuildCtMorton)(benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+
+  for (auto _ : state) {
+    PicoKdTreeCtMorton<PointX> tree(points_tree_, max_leaf_size);
+    state.counters["peak_memory"] =
+        static_cast<double>(tree.peak_build_memory());
+  }
+}
+
+BENCHMARK_DEFINE_F(BmPicoKdTree, BuildCtSah)(benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+
+  for (auto _ : state) {
+    PicoKdTreeCtSah<PointX> tree(points_tree_, max_leaf_size);
+  }
+}
+
 // Argument 1: Maximum leaf size.
 BENCHMARK_REGISTER_F(BmPicoKdTree, BuildCtSldMid)
     ->Unit(benchmark::kMillisecond)
@@ -53,6 +163,32 @@ BENCHMARK_REGISTER_F(BmPicoKdTree, BuildRtSldMid)
     ->Arg(1)
     ->DenseRange(6, 14, 2);
 
+BENCHMARK_REGISTER_F(BmPicoKdTree, BuildCtLngMed)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(1)
+    ->DenseRange(6, 14, 2);
+
+// Argument 1: Maximum leaf size.
+// Argument 2: Sample size.
+BENCHMARK_REGISTER_F(BmPicoKdTree, BuildCtSmpMed)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({1, 15})
+    ->Args({6, 15})
+    ->Args({10, 5})
+    ->Args({10, 15})
+    ->Args({10, 63})
+    ->Args({14, 15});
+
+BENCHMARK_REGISTER_F(BmPicoKdTree, BuildCtMorton)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(1)
+    ->DenseRange(6, 14, 2);
+
+BENCHMARK_REGISTER_F(BmPicoKdTree, BuildCtSah)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(1)
+    ->DenseRange(6, 14, 2);
+
 // ****************************************************************************
 // Knn
 // ****************************************************************************
@@ -100,6 +236,175 @@ BENCHMARK_REGISTER_F(BmPicoKdTree, KnnCtSldMid)
     ->Args({12, 12})
     ->Args({14, 12});
 
+// The run-time dimension benchmarks compare against KnnCtSldMid and should not
+// regress when code is specialized for a compile-time dimension.
+BENCHMARK_DEFINE_F(BmPicoKdTree, KnnRtSldMid)(benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+  int knn_count = state.range(1);
+
+  PicoKdTreeRtSldMid<PointX> tree(
+      PicoRtSpace<PointX>(points_tree_), max_leaf_size);
+
+  for (auto _ : state) {
+    std::vector<pico_tree::Neighbor<Index, Scalar>> results;
+    std::size_t sum = 0;
+    for (auto const& p : points_test_) {
+      tree.SearchKnn(p, knn_count, results);
+      benchmark::DoNotOptimize(sum += results.size());
+    }
+  }
+}
+
+BENCHMARK_REGISTER_F(BmPicoKdTree, KnnRtSldMid)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({6, 1})
+    ->Args({10, 1})
+    ->Args({14, 1})
+    ->Args({6, 8})
+    ->Args({10, 8})
+    ->Args({14, 8});
+
+// Queries with a run-time dimension for a tree with a compile-time dimension.
+BENCHMARK_DEFINE_F(BmPicoKdTree, KnnCtRtQuerySldMid)(benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+  int knn_count = state.range(1);
+
+  PicoKdTreeCtSldMid<PointX> tree(points_tree_, max_leaf_size);
+
+  for (auto _ : state) {
+    std::vector<pico_tree::Neighbor<Index, Scalar>> results;
+    std::size_t sum = 0;
+    for (auto const& p : points_test_) {
+      tree.SearchKnn(
+          pico_tree::PointMap<Scalar const, pico_tree::kDynamicSize>(
+              p.data(), p.size()),
+          knn_count,
+          results);
+      benchmark::DoNotOptimize(sum += results.size());
+    }
+  }
+}
+
+BENCHMARK_REGISTER_F(BmPicoKdTree, KnnCtRtQuerySldMid)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({6, 1})
+    ->Args({10, 1})
+    ->Args({14, 1})
+    ->Args({6, 8})
+    ->Args({10, 8})
+    ->Args({14, 8});
+
+BENCHMARK_DEFINE_F(BmPicoKdTree, KnnPfNodesSldMid)(benchmark::State& state) {
+  KnnPfSldMid<true, 0>(state);
+}
+
+BENCHMARK_DEFINE_F(BmPicoKdTree, KnnPfPointsSldMid)(benchmark::State& state) {
+  KnnPfSldMid<false, 4>(state);
+}
+
+BENCHMARK_DEFINE_F(BmPicoKdTree, KnnPfAllSldMid)(benchmark::State& state) {
+  KnnPfSldMid<true, 4>(state);
+}
+
+BENCHMARK_REGISTER_F(BmPicoKdTree, KnnPfNodesSldMid)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({6, 1})
+    ->Args({10, 1})
+    ->Args({14, 1})
+    ->Args({6, 8})
+    ->Args({10, 8})
+    ->Args({14, 8});
+
+BENCHMARK_REGISTER_F(BmPicoKdTree, KnnPfPointsSldMid)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({6, 1})
+    ->Args({10, 1})
+    ->Args({14, 1})
+    ->Args({6, 8})
+    ->Args({10, 8})
+    ->Args({14, 8});
+
+BENCHMARK_REGISTER_F(BmPicoKdTree, KnnPfAllSldMid)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({6, 1})
+    ->Args({10, 1})
+    ->Args({14, 1})
+    ->Args({6, 8})
+    ->Args({10, 8})
+    ->Args({14, 8});
+
+BENCHMARK_DEFINE_F(BmPicoKdTree, KnnPacketCtSldMid)(benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+  int knn_count = state.range(1);
+
+  PicoKdTreeCtSldMid<PointX> tree(points_tree_, max_leaf_size);
+
+  for (auto _ : state) {
+    std::vector<pico_tree::Neighbor<Index, Scalar>> results;
+    tree.SearchKnnPacket(
+        points_test_.begin(), points_test_.end(), knn_count, results);
+    benchmark::DoNotOptimize(results.data());
+  }
+}
+
+BENCHMARK_REGISTER_F(BmPicoKdTree, KnnPacketCtSldMid)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({6, 1})
+    ->Args({10, 1})
+    ->Args({14, 1})
+    ->Args({6, 8})
+    ->Args({10, 8})
+    ->Args({14, 8});
+
+BENCHMARK_DEFINE_F(BmPicoKdTree, KnnInterleavedCtSldMid)(
+    benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+  int knn_count = state.range(1);
+
+  PicoKdTreeCtSldMid<PointX> tree(points_tree_, max_leaf_size);
+
+  for (auto _ : state) {
+    std::vector<pico_tree::Neighbor<Index, Scalar>> results;
+    tree.SearchKnnInterleaved(
+        points_test_.begin(), points_test_.end(), knn_count, results);
+    benchmark::DoNotOptimize(results.data());
+  }
+}
+
+BENCHMARK_REGISTER_F(BmPicoKdTree, KnnInterleavedCtSldMid)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({6, 1})
+    ->Args({10, 1})
+    ->Args({14, 1})
+    ->Args({6, 8})
+    ->Args({10, 8})
+    ->Args({14, 8});
+
+BENCHMARK_DEFINE_F(BmPicoKdTree, KnnCtSah)(benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+  int knn_count = state.range(1);
+
+  PicoKdTreeCtSah<PointX> tree(points_tree_, max_leaf_size);
+
+  for (auto _ : state) {
+    std::vector<pico_tree::Neighbor<Index, Scalar>> results;
+    std::size_t sum = 0;
+    for (auto const& p : points_test_) {
+      tree.SearchKnn(p, knn_count, results);
+      benchmark::DoNotOptimize(sum += results.size());
+    }
+  }
+}
+
+BENCHMARK_REGISTER_F(BmPicoKdTree, KnnCtSah)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({6, 1})
+    ->Args({10, 1})
+    ->Args({14, 1})
+    ->Args({6, 8})
+    ->Args({10, 8})
+    ->Args({14, 8});
+
 // ****************************************************************************
 // Radius
 // ****************************************************************************
@@ -138,6 +443,51 @@ BENCHMARK_REGISTER_F(BmPicoKdTree, RadiusCtSldMid)
     ->Args({12, 30})
     ->Args({14, 30});
 
+BENCHMARK_DEFINE_F(BmPicoKdTree, RadiusPairsCtSldMid)(
+    benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+  Scalar radius = static_cast<Scalar>(state.range(1)) / Scalar(10.0);
+  Scalar squared = radius * radius;
+
+  PicoKdTreeCtSldMid<PointX> tree(points_tree_, max_leaf_size);
+
+  for (auto _ : state) {
+    std::vector<std::pair<Index, pico_tree::Neighbor<Index, Scalar>>> results;
+    tree.SearchRadiusPairs(squared, results);
+    benchmark::DoNotOptimize(results.size());
+  }
+}
+
+// Argument 1: Maximum leaf size.
+// Argument 2: Search radius (divided by 10.0).
+BENCHMARK_REGISTER_F(BmPicoKdTree, RadiusPairsCtSldMid)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({6, 15})
+    ->Args({8, 15})
+    ->Args({10, 15});
+
+BENCHMARK_DEFINE_F(BmPicoKdTree, AllRadiusCtSldMid)(benchmark::State& state) {
+  int max_leaf_size = state.range(0);
+  Scalar radius = static_cast<Scalar>(state.range(1)) / Scalar(10.0);
+  Scalar squared = radius * radius;
+
+  PicoKdTreeCtSldMid<PointX> tree(points_tree_, max_leaf_size);
+
+  for (auto _ : state) {
+    pico_tree::NeighborList<Index, Scalar> results;
+    tree.SearchAllRadius(squared, results);
+    benchmark::DoNotOptimize(results.indices.size());
+  }
+}
+
+// Argument 1: Maximum leaf size.
+// Argument 2: Search radius (divided by 10.0).
+BENCHMARK_REGISTER_F(BmPicoKdTree, AllRadiusCtSldMid)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({6, 15})
+    ->Args({8, 15})
+    ->Args({10, 15});
+
 // ****************************************************************************
 // Box
 // ****************************************************************************
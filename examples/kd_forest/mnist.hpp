@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <filesystem>
 #include <pico_toolshed/format/format_mnist.hpp>
 
@@ -24,24 +25,25 @@ std::vector<std::array<U, N>> Cast(std::vector<std::array<T, N>> const& i) {
   return c;
 }
 
-class Mnist {
+//! \brief The MNIST images with pixels of type Scalar_.
+template <typename Scalar_>
+class MnistDataset {
  private:
-  using Scalar = float;
   using ImageByte = std::array<std::byte, 28 * 28>;
-  using ImageFloat = std::array<Scalar, 28 * 28>;
+  using Image = std::array<Scalar_, 28 * 28>;
 
-  static std::vector<ImageFloat> ReadImages(std::string const& filename) {
+  static std::vector<Image> ReadImages(std::string const& filename) {
     if (!std::filesystem::exists(filename)) {
       throw std::runtime_error(filename + " doesn't exist.");
     }
 
     std::vector<ImageByte> images_u8;
     pico_tree::ReadMnistImages(filename, images_u8);
-    return Cast<Scalar>(images_u8);
+    return Cast<Scalar_>(images_u8);
   }
 
  public:
-  using PointType = ImageFloat;
+  using PointType = Image;
 
   static std::string const kDatasetName;
 
@@ -56,4 +58,10 @@ class Mnist {
   }
 };
 
-std::string const Mnist::kDatasetName = "mnist";
+template <typename Scalar_>
+std::string const MnistDataset<Scalar_>::kDatasetName = "mnist";
+
+// Pixels are converted to float for the KdForest, which rotates its points.
+using Mnist = MnistDataset<float>;
+// Pixels keep their original size. Distances are computed using int.
+using MnistU8 = MnistDataset<std::uint8_t>;
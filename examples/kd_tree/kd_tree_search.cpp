@@ -68,6 +68,17 @@ void SearchR3() {
       tree.SearchKnn(q, k, knn);
     }
   }
+
+  // Visiting at most this many leaf nodes bounds the query time. The search is
+  // exact when it finishes before reaching the limit.
+  pico_tree::MaxLeavesVisited max_leaves_visited{4};
+
+  {
+    ScopedTimer t("kd_tree bounded knn", run_count);
+    for (std::size_t i = 0; i < run_count; ++i) {
+      tree.SearchKnn(q, k, max_leaves_visited, knn);
+    }
+  }
 }
 
 // Search on the circle.
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "pico_tree/internal/kd_tree_builder.hpp"
+#include "pico_tree/internal/point_wrapper.hpp"
+#include "pico_tree/internal/search_visitor.hpp"
+#include "pico_tree/internal/space_wrapper.hpp"
+#include "pico_tree/metric.hpp"
+#include "pico_understory/internal/compact_kd_tree_data.hpp"
+#include "pico_understory/internal/compact_kd_tree_search.hpp"
+
+namespace pico_tree {
+
+//! \brief A CompactKdTree is a KdTree of which each node is stored in 8 bytes.
+//! \details The nodes of a KdTree take 32 bytes or more for a Euclidean space.
+//! The CompactKdTree is built like a KdTree, after which the nodes are encoded
+//! into a single array in depth-first order. A branch only stores the offset
+//! of its right child, and its split bounds are quantized using 11 bits each
+//! relative to the box of the branch. The quantization is conservative and
+//! searches are exact. Pruning is slightly less effective because the decoded
+//! bounds are looser than the original ones.
+//! <p/>
+//! Only Euclidean spaces with floating point coordinates and at most 1024
+//! dimensions are supported.
+//! \tparam Space_ Type of space.
+//! \tparam Metric_ Type of metric. Determines how distances are measured.
+//! \tparam SplittingRule_ The rule that determines how space is partitioned.
+//! \tparam Index_ Type of index.
+template <
+    typename Space_,
+    typename Metric_ = L2Squared,
+    SplittingRule SplittingRule_ = SplittingRule::kSlidingMidpoint,
+    typename Index_ = int>
+class CompactKdTree {
+  static_assert(
+      std::is_same_v<typename Metric_::SpaceTag, EuclideanSpaceTag>,
+      "METRIC_SPACE_TAG_NOT_EUCLIDEAN");
+
+  using SpaceWrapperType = internal::SpaceWrapper<Space_>;
+  using BuildKdTreeType = internal::BuildKdTree<
+      internal::KdTreeNodeEuclidean<
+          Index_,
+          typename SpaceWrapperType::ScalarType>,
+      SpaceWrapperType::Dim,
+      SplittingRule_>;
+  using KdTreeDataType = internal::CompactKdTreeData<
+      Index_,
+      typename SpaceWrapperType::ScalarType,
+      SpaceWrapperType::Dim>;
+
+ public:
+  //! \brief Size type.
+  using SizeType = Size;
+  //! \brief Index type.
+  using IndexType = Index_;
+  //! \brief Scalar type.
+  using ScalarType = typename SpaceWrapperType::ScalarType;
+  //! \brief CompactKdTree dimension. It equals pico_tree::kDynamicSize in case
+  //! Dim is only known at run-time.
+  static SizeType constexpr Dim = SpaceWrapperType::Dim;
+  //! \brief Point set or adaptor type.
+  using SpaceType = Space_;
+  //! \brief The metric used for various searches.
+  using MetricType = Metric_;
+  //! \brief Distance type.
+  using DistanceType = internal::MetricDistanceType<Metric_, ScalarType>;
+  //! \brief Neighbor type of various search resuls.
+  using NeighborType = Neighbor<IndexType, DistanceType>;
+
+  //! \brief Creates a CompactKdTree given \p space and \p max_leaf_size.
+  //! \see KdTree::KdTree
+  CompactKdTree(
+      SpaceType space,
+      SizeType max_leaf_size,
+      SplittingRuleOptions const& options = SplittingRuleOptions())
+      : space_(std::move(space)),
+        metric_(),
+        data_(KdTreeDataType::FromKdTreeData(BuildKdTreeType()(
+            SpaceWrapperType(space_), max_leaf_size, options))) {}
+
+  //! \brief Returns the nearest neighbor (or neighbors) of point \p x depending
+  //! on their selection by visitor \p visitor .
+  template <typename P, typename V>
+  inline void SearchNearest(P const& x, V& visitor) const {
+    internal::PointWrapper<P, Dim> p(x);
+    internal::SearchNearestCompact<
+        SpaceWrapperType,
+        Metric_,
+        internal::PointWrapper<P, Dim>,
+        V,
+        IndexType>(SpaceWrapperType(space_), metric_, data_, p, visitor)();
+  }
+
+  //! \brief Searches for the nearest neighbor of point \p x.
+  //! \see KdTree::SearchNn
+  template <typename P>
+  inline void SearchNn(P const& x, NeighborType& nn) const {
+    internal::SearchNn<NeighborType> v(nn);
+    SearchNearest(x, v);
+  }
+
+  //! \brief Searches for the approximate nearest neighbor of point \p x.
+  //! \see KdTree::SearchNn
+  template <typename P>
+  inline void SearchNn(
+      P const& x, DistanceType const e, NeighborType& nn) const {
+    internal::SearchApproximateNn<NeighborType> v(e, nn);
+    SearchNearest(x, v);
+  }
+
+  //! \brief Searches for the \p k nearest neighbors of point \p x and stores
+  //! the results in output vector \p knn.
+  //! \see KdTree::SearchKnn
+  template <typename P>
+  inline void SearchKnn(
+      P const& x, SizeType const k, std::vector<NeighborType>& knn) const {
+    knn.resize(std::min(k, SpaceWrapperType(space_).size()));
+    internal::SearchKnn<typename std::vector<NeighborType>::iterator> v(
+        knn.begin(), knn.end());
+    SearchNearest(x, v);
+  }
+
+  //! \brief Searches for the \p k approximate nearest neighbors of point \p x
+  //! and stores the results in output vector \p knn.
+  //! \see KdTree::SearchKnn
+  template <typename P>
+  inline void SearchKnn(
+      P const& x,
+      SizeType const k,
+      DistanceType const e,
+      std::vector<NeighborType>& knn) const {
+    knn.resize(std::min(k, SpaceWrapperType(space_).size()));
+    internal::SearchApproximateKnn<typename std::vector<NeighborType>::iterator>
+        v(e, knn.begin(), knn.end());
+    SearchNearest(x, v);
+  }
+
+  //! \brief Searches for all the neighbors of point \p x that are within radius
+  //! \p radius and stores the results in output vector \p n.
+  //! \see KdTree::SearchRadius
+  template <typename P>
+  inline void SearchRadius(
+      P const& x,
+      DistanceType const radius,
+      std::vector<NeighborType>& n,
+      bool const sort = false) const {
+    internal::SearchRadius<NeighborType> v(radius, n);
+    SearchNearest(x, v);
+
+    if (sort) {
+      v.Sort();
+    }
+  }
+
+  //! \brief Searches for all approximate neighbors of point \p x that are
+  //! within radius \p radius and stores the results in output vector \p n.
+  //! \see KdTree::SearchRadius
+  template <typename P>
+  inline void SearchRadius(
+      P const& x,
+      DistanceType const radius,
+      DistanceType const e,
+      std::vector<NeighborType>& n,
+      bool const sort = false) const {
+    internal::SearchApproximateRadius<NeighborType> v(e, radius, n);
+    SearchNearest(x, v);
+
+    if (sort) {
+      v.Sort();
+    }
+  }
+
+  //! \brief Point set used by the tree.
+  inline SpaceType const& points() const { return space_; }
+
+  //! \brief Metric used for search queries.
+  inline MetricType const& metric() const { return metric_; }
+
+  //! \brief Returns the number of nodes of the tree.
+  inline SizeType node_count() const { return data_.nodes.size(); }
+
+ private:
+  //! \brief Point set used for querying point data.
+  SpaceType space_;
+  //! \brief Metric used for comparing distances.
+  MetricType metric_;
+  //! \brief Data structure of the CompactKdTree.
+  KdTreeDataType data_;
+};
+
+template <typename Space_>
+CompactKdTree(Space_, Size) -> CompactKdTree<
+    Space_,
+    L2Squared,
+    SplittingRule::kSlidingMidpoint,
+    int>;
+
+}  // namespace pico_tree
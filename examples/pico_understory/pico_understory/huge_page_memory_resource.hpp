@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace pico_tree {
+
+//! \brief The kind of huge pages used by a HugePageMemoryResource.
+enum class HugePageMode {
+  //! \brief Transparent huge pages. The memory is aligned to the size of a huge
+  //! page and the kernel is advised to back it by huge pages. Depending on the
+  //! system configuration this happens immediately or in the background.
+  kTransparent,
+  //! \brief Explicit huge pages from the pool that is reserved by the system
+  //! administrator. When the pool is empty the transparent mode is used
+  //! instead.
+  kExplicit
+};
+
+//! \brief A memory resource that backs large allocations by 2 MB huge pages.
+//! \details Random access into multi GB arrays, such as the nodes, indices and
+//! points of a large KdTree, causes many TLB misses when the memory is
+//! backed by regular 4 KB pages. A single huge page covers the memory of 512
+//! regular ones.
+//! <p/>
+//! Allocations smaller than a huge page are forwarded to the upstream resource.
+//! Larger ones are rounded up to a whole number of huge pages. When huge pages
+//! are unavailable the memory is backed by regular pages. Only Linux is
+//! supported. On other platforms all allocations are forwarded to the upstream
+//! resource.
+//! <p/>
+//! The owned point copy of a KdTree can be placed in huge pages by storing the
+//! points in an std::pmr::vector that uses the same resource:
+//! \code{.cpp}
+//! pico_tree::HugePageMemoryResource resource;
+//! std::pmr::vector<Point3f> points(begin, end, &resource);
+//! pico_tree::KdTree<std::pmr::vector<Point3f>> tree(
+//!     std::move(points), max_leaf_size, &resource);
+//! \endcode
+class HugePageMemoryResource : public std::pmr::memory_resource {
+ public:
+  //! \brief Size of a huge page.
+  static std::size_t constexpr kHugePageSize = std::size_t(2) << 20;
+
+  //! \brief Creates a HugePageMemoryResource that forwards small allocations
+  //! to \p upstream.
+  explicit HugePageMemoryResource(
+      HugePageMode mode = HugePageMode::kTransparent,
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : mode_(mode), upstream_(upstream) {}
+
+  //! \brief Returns the kind of huge pages requested.
+  inline HugePageMode mode() const { return mode_; }
+
+ private:
+  static inline std::size_t RoundUp(std::size_t bytes) {
+    return (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  }
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+#if defined(__linux__)
+    if (bytes >= kHugePageSize) {
+      std::size_t const size = RoundUp(bytes);
+#if defined(MAP_HUGETLB)
+      if (mode_ == HugePageMode::kExplicit) {
+        void* memory = mmap(
+            nullptr,
+            size,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+            -1,
+            0);
+        if (memory != MAP_FAILED) {
+          return memory;
+        }
+      }
+#endif
+      return MapTransparent(size);
+    }
+#endif
+    return upstream_->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(
+      void* memory, std::size_t bytes, std::size_t alignment) override {
+#if defined(__linux__)
+    if (bytes >= kHugePageSize) {
+      munmap(memory, RoundUp(bytes));
+      return;
+    }
+#endif
+    upstream_->deallocate(memory, bytes, alignment);
+  }
+
+  bool do_is_equal(
+      std::pmr::memory_resource const& other) const noexcept override {
+    return this == &other;
+  }
+
+#if defined(__linux__)
+  //! \brief Maps \p size bytes aligned to a huge page and advises the kernel
+  //! to back them by transparent huge pages.
+  static void* MapTransparent(std::size_t size) {
+    // Mapping an extra huge page allows the start to be aligned. The unused
+    // head and tail are unmapped again.
+    std::size_t const mapped_size = size + kHugePageSize;
+    void* mapped = mmap(
+        nullptr,
+        mapped_size,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0);
+    if (mapped == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+
+    auto* begin = static_cast<std::byte*>(mapped);
+    auto* aligned = reinterpret_cast<std::byte*>(
+        RoundUp(reinterpret_cast<std::size_t>(begin)));
+    std::size_t const head = static_cast<std::size_t>(aligned - begin);
+    if (head > 0) {
+      munmap(begin, head);
+    }
+    std::size_t const tail = mapped_size - head - size;
+    if (tail > 0) {
+      munmap(aligned + size, tail);
+    }
+
+#if defined(MADV_HUGEPAGE)
+    // Failure means that transparent huge pages are disabled. The memory
+    // remains usable.
+    madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+    return aligned;
+  }
+#endif
+
+  HugePageMode mode_;
+  std::pmr::memory_resource* upstream_;
+};
+
+}  // namespace pico_tree
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "pico_tree/core.hpp"
+#include "pico_tree/internal/box.hpp"
+
+namespace pico_tree::internal {
+
+//! \brief An 8 byte KdTree node.
+//! \details A branch packs its split dimension, both split bounds and the
+//! offset of its right child into a single word. The left child of a branch
+//! always directly follows it. The split bounds are quantized relative to the
+//! box of the branch along the split dimension. A leaf stores its index range.
+//! <p/>
+//! Branch layout from the most to the least significant bit:
+//! \li 1 bit: leaf flag (0).
+//! \li 11 bits: quantized minimum of the right box.
+//! \li 11 bits: quantized maximum of the left box.
+//! \li 10 bits: split dimension.
+//! \li 31 bits: offset of the right child.
+//!
+//! Leaf layout from the most to the least significant bit:
+//! \li 1 bit: leaf flag (1).
+//! \li 31 bits: number of indices.
+//! \li 32 bits: begin of the index range.
+class CompactKdTreeNode {
+ public:
+  using WordType = std::uint64_t;
+
+  //! \brief Number of bits of a quantized split bound.
+  static int constexpr kBoundBits = 11;
+  //! \brief Number of bits of the split dimension.
+  static int constexpr kDimBits = 10;
+  //! \brief Number of bits of the offset of the right child.
+  static int constexpr kOffsetBits = 31;
+  //! \brief Maximum value of a quantized split bound. It represents the
+  //! maximum of the box of the branch.
+  static WordType constexpr kMaxBound = (WordType(1) << kBoundBits) - 1;
+  //! \brief Maximum supported spatial dimension.
+  static Size constexpr kMaxDim = Size(1) << kDimBits;
+  //! \brief Maximum supported number of nodes.
+  static Size constexpr kMaxNodes = Size(1) << kOffsetBits;
+
+  //! \brief Creates a branch.
+  static inline CompactKdTreeNode Branch(
+      Size split_dim, WordType left_max, WordType right_min, Size right) {
+    assert(split_dim < kMaxDim);
+    assert(right < kMaxNodes);
+    return CompactKdTreeNode(
+        (right_min << (kBoundBits + kDimBits + kOffsetBits)) |
+        (left_max << (kDimBits + kOffsetBits)) |
+        (static_cast<WordType>(split_dim) << kOffsetBits) |
+        static_cast<WordType>(right));
+  }
+
+  //! \brief Creates a leaf.
+  static inline CompactKdTreeNode Leaf(Size begin_idx, Size end_idx) {
+    assert(begin_idx <= end_idx);
+    assert(end_idx - begin_idx < (Size(1) << 31));
+    assert(begin_idx < (Size(1) << 32));
+    return CompactKdTreeNode(
+        kLeafFlag | (static_cast<WordType>(end_idx - begin_idx) << 32) |
+        static_cast<WordType>(begin_idx));
+  }
+
+  //! \brief Returns if the current node is a leaf.
+  inline bool IsLeaf() const { return (word_ & kLeafFlag) != 0; }
+
+  //! \brief Returns the split dimension of a branch.
+  inline Size split_dim() const {
+    return static_cast<Size>((word_ >> kOffsetBits) & Mask(kDimBits));
+  }
+
+  //! \brief Returns the quantized maximum of the left box of a branch.
+  inline WordType left_max() const {
+    return (word_ >> (kDimBits + kOffsetBits)) & kMaxBound;
+  }
+
+  //! \brief Returns the quantized minimum of the right box of a branch.
+  inline WordType right_min() const {
+    return (word_ >> (kBoundBits + kDimBits + kOffsetBits)) & kMaxBound;
+  }
+
+  //! \brief Returns the offset of the right child of a branch.
+  inline Size right() const {
+    return static_cast<Size>(word_ & Mask(kOffsetBits));
+  }
+
+  //! \brief Returns the begin of the index range of a leaf.
+  inline Size begin_idx() const {
+    return static_cast<Size>(word_ & Mask(32));
+  }
+
+  //! \brief Returns the end of the index range of a leaf.
+  inline Size end_idx() const {
+    return begin_idx() + static_cast<Size>((word_ >> 32) & Mask(31));
+  }
+
+  //! \brief Returns the coordinate represented by quantized bound \p q for a
+  //! box that ranges from \p min to \p max.
+  //! \details The result is non-decreasing in \p q. The end points are
+  //! represented exactly.
+  template <typename Scalar_>
+  static inline Scalar_ Dequantize(WordType q, Scalar_ min, Scalar_ max) {
+    if (q == 0) {
+      return min;
+    }
+    if (q == kMaxBound) {
+      return max;
+    }
+    return min + (max - min) * (static_cast<Scalar_>(q) *
+                                (Scalar_(1) / static_cast<Scalar_>(kMaxBound)));
+  }
+
+  //! \brief Returns the smallest quantized bound that represents a coordinate
+  //! of at least \p v.
+  template <typename Scalar_>
+  static inline WordType QuantizeUp(Scalar_ v, Scalar_ min, Scalar_ max) {
+    if (!(v < max)) {
+      return kMaxBound;
+    }
+    WordType q = Guess(v, min, max);
+    // The guess is corrected for rounding errors such that the bound is
+    // conservative.
+    while (q > 0 && Dequantize(q - 1, min, max) >= v) {
+      --q;
+    }
+    while (Dequantize(q, min, max) < v) {
+      ++q;
+    }
+    return q;
+  }
+
+  //! \brief Returns the largest quantized bound that represents a coordinate
+  //! of at most \p v.
+  template <typename Scalar_>
+  static inline WordType QuantizeDown(Scalar_ v, Scalar_ min, Scalar_ max) {
+    if (!(v > min)) {
+      return 0;
+    }
+    WordType q = Guess(v, min, max);
+    while (q < kMaxBound && Dequantize(q + 1, min, max) <= v) {
+      ++q;
+    }
+    while (Dequantize(q, min, max) > v) {
+      --q;
+    }
+    return q;
+  }
+
+ private:
+  static WordType constexpr kLeafFlag = WordType(1) << 63;
+
+  explicit CompactKdTreeNode(WordType word) : word_(word) {}
+
+  static inline constexpr WordType Mask(int bits) {
+    return (WordType(1) << bits) - 1;
+  }
+
+  template <typename Scalar_>
+  static inline WordType Guess(Scalar_ v, Scalar_ min, Scalar_ max) {
+    Scalar_ const t = (v - min) / (max - min) * static_cast<Scalar_>(kMaxBound);
+    if (!(t > Scalar_(0))) {
+      return 0;
+    }
+    if (!(t < static_cast<Scalar_>(kMaxBound))) {
+      return kMaxBound;
+    }
+    return static_cast<WordType>(t);
+  }
+
+  WordType word_;
+};
+
+//! \brief The data structure that represents a CompactKdTree.
+//! \details The nodes are stored in depth-first order in a single array.
+template <typename Index_, typename Scalar_, Size Dim_>
+class CompactKdTreeData {
+  static_assert(
+      std::is_floating_point_v<Scalar_>, "SCALAR_NOT_A_FLOATING_POINT_TYPE");
+
+ public:
+  using IndexType = Index_;
+  using ScalarType = Scalar_;
+  static Size constexpr Dim = Dim_;
+  using BoxType = Box<ScalarType, Dim>;
+  using NodeType = CompactKdTreeNode;
+
+  //! \brief Creates a CompactKdTreeData by encoding the nodes of \p data, a
+  //! KdTreeData for a Euclidean space.
+  template <typename KdTreeData_>
+  static CompactKdTreeData FromKdTreeData(KdTreeData_ const& data) {
+    assert(data.root_box.size() <= NodeType::kMaxDim);
+
+    CompactKdTreeData compact{
+        std::vector<IndexType>(data.indices.begin(), data.indices.end()),
+        data.root_box,
+        {}};
+    BoxType box = data.root_box;
+    compact.Encode(data.root_node, box);
+    return compact;
+  }
+
+  //! \brief Sorted indices that refer to points inside the space.
+  std::vector<IndexType> indices;
+  //! \brief Bounding box of the root node.
+  BoxType root_box;
+  //! \brief Nodes in depth-first order. The root node is the first one.
+  std::vector<NodeType> nodes;
+
+ private:
+  //! \brief Encodes the subtree of \p node. The split bounds are quantized
+  //! relative to \p box, the decoded box of \p node. Returns the offset of the
+  //! encoded node.
+  template <typename Node_>
+  Size Encode(Node_ const* const node, BoxType& box) {
+    Size const offset = nodes.size();
+    assert(offset < NodeType::kMaxNodes);
+
+    if (node->IsLeaf()) {
+      nodes.push_back(NodeType::Leaf(
+          static_cast<Size>(node->data.leaf.begin_idx),
+          static_cast<Size>(node->data.leaf.end_idx)));
+      return offset;
+    }
+
+    // A placeholder until the offset of the right child is known.
+    nodes.push_back(NodeType::Leaf(0, 0));
+    Size const split_dim = static_cast<Size>(node->data.branch.split_dim);
+    ScalarType const min = box.min(split_dim);
+    ScalarType const max = box.max(split_dim);
+    auto const left_max =
+        NodeType::QuantizeUp(node->data.branch.left_max, min, max);
+    auto const right_min =
+        NodeType::QuantizeDown(node->data.branch.right_min, min, max);
+
+    box.max(split_dim) = NodeType::Dequantize(left_max, min, max);
+    Encode(node->left, box);
+    box.max(split_dim) = max;
+    box.min(split_dim) = NodeType::Dequantize(right_min, min, max);
+    Size const right = Encode(node->right, box);
+    box.min(split_dim) = min;
+
+    nodes[offset] = NodeType::Branch(split_dim, left_max, right_min, right);
+    return offset;
+  }
+};
+
+}  // namespace pico_tree::internal
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+
+#include "pico_tree/core.hpp"
+#include "pico_tree/internal/point.hpp"
+#include "pico_tree/metric.hpp"
+#include "pico_understory/internal/compact_kd_tree_data.hpp"
+
+namespace pico_tree::internal {
+
+//! \brief This class provides a search nearest function for a CompactKdTree.
+//! \details The search is the same as that of SearchNearestEuclidean, except
+//! that the split bounds of each branch are decoded relative to the box of the
+//! branch. The box is updated while descending the tree. Decoded bounds are
+//! never tighter than the original ones and the search is exact.
+template <
+    typename SpaceWrapper_,
+    typename Metric_,
+    typename PointWrapper_,
+    typename Visitor_,
+    typename Index_>
+class SearchNearestCompact {
+ public:
+  using IndexType = Index_;
+  using ScalarType = typename SpaceWrapper_::ScalarType;
+  using DistanceType = MetricDistanceType<Metric_, ScalarType>;
+  using PointType = Point<DistanceType, SpaceWrapper_::Dim>;
+  using KdTreeDataType =
+      CompactKdTreeData<IndexType, ScalarType, SpaceWrapper_::Dim>;
+  //! \brief Node type supported by this SearchNearestCompact.
+  using NodeType = typename KdTreeDataType::NodeType;
+  using BoxType = typename KdTreeDataType::BoxType;
+
+  inline SearchNearestCompact(
+      SpaceWrapper_ space,
+      Metric_ metric,
+      KdTreeDataType const& data,
+      PointWrapper_ query,
+      Visitor_& visitor)
+      : space_(space),
+        metric_(metric),
+        indices_(data.indices),
+        nodes_(data.nodes),
+        query_(query),
+        node_box_offset_(PointType::FromSize(space_.sdim())),
+        node_box_(data.root_box),
+        visitor_(visitor) {}
+
+  //! \brief Search nearest neighbors starting from the root node.
+  inline void operator()() {
+    node_box_offset_.Fill(DistanceType(0.0));
+    SearchNearest(0, DistanceType(0.0));
+  }
+
+ private:
+  inline void SearchNearest(Size const offset, DistanceType node_box_distance) {
+    NodeType const node = nodes_[offset];
+    if (node.IsLeaf()) {
+      Size const end_idx = node.end_idx();
+      for (Size i = node.begin_idx(); i < end_idx; ++i) {
+        visitor_(
+            indices_[i],
+            metric_(query_.begin(), query_.end(), space_[indices_[i]]));
+      }
+    } else {
+      Size const split_dim = node.split_dim();
+      ScalarType const min = node_box_.min(split_dim);
+      ScalarType const max = node_box_.max(split_dim);
+      ScalarType const left_max =
+          NodeType::Dequantize(node.left_max(), min, max);
+      ScalarType const right_min =
+          NodeType::Dequantize(node.right_min(), min, max);
+      ScalarType const v = query_[split_dim];
+      Size const left = offset + 1;
+      Size const right = node.right();
+
+      // See SearchNearestEuclidean for the traversal order and the incremental
+      // node box distance.
+      if ((left_max + right_min - v - v) > 0) {
+        node_box_.max(split_dim) = left_max;
+        SearchNearest(left, node_box_distance);
+        node_box_.max(split_dim) = max;
+        node_box_.min(split_dim) = right_min;
+        SearchNearestSecond(
+            right, split_dim, metric_(right_min, v), node_box_distance);
+        node_box_.min(split_dim) = min;
+      } else {
+        node_box_.min(split_dim) = right_min;
+        SearchNearest(right, node_box_distance);
+        node_box_.min(split_dim) = min;
+        node_box_.max(split_dim) = left_max;
+        SearchNearestSecond(
+            left, split_dim, metric_(left_max, v), node_box_distance);
+        node_box_.max(split_dim) = max;
+      }
+    }
+  }
+
+  //! \brief Visits the second child of a branch when it is within the search
+  //! distance.
+  inline void SearchNearestSecond(
+      Size const offset,
+      Size const split_dim,
+      DistanceType const new_offset,
+      DistanceType node_box_distance) {
+    DistanceType const old_offset = node_box_offset_[split_dim];
+    node_box_distance = node_box_distance - old_offset + new_offset;
+
+    if (visitor_.max() >= node_box_distance) {
+      node_box_offset_[split_dim] = new_offset;
+      SearchNearest(offset, node_box_distance);
+      node_box_offset_[split_dim] = old_offset;
+    }
+  }
+
+  SpaceWrapper_ space_;
+  Metric_ metric_;
+  std::vector<IndexType> const& indices_;
+  std::vector<NodeType> const& nodes_;
+  PointWrapper_ query_;
+  PointType node_box_offset_;
+  //! \brief Decoded box of the current node.
+  BoxType node_box_;
+  Visitor_& visitor_;
+};
+
+}  // namespace pico_tree::internal
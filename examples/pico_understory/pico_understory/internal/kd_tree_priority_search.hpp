@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory_resource>
 #include <queue>
 #include <vector>
 
@@ -33,7 +34,7 @@ class PrioritySearchNearestEuclidean {
   inline PrioritySearchNearestEuclidean(
       SpaceWrapper_ space,
       Metric_ metric,
-      std::vector<IndexType> const& indices,
+      std::pmr::vector<IndexType> const& indices,
       PointWrapper_ query,
       Size max_leaves_visited,
       Visitor_& visitor)
@@ -128,7 +129,7 @@ class PrioritySearchNearestEuclidean {
 
   SpaceWrapper_ space_;
   Metric_ metric_;
-  std::vector<IndexType> const& indices_;
+  std::pmr::vector<IndexType> const& indices_;
   PointWrapper_ query_;
   Size max_leaves_visited_;
   // TODO This gets created every query. Solving this would require a different
@@ -3,7 +3,22 @@
 #include "pico_tree/internal/kd_tree_builder.hpp"
 #include "pico_understory/internal/rkd_tree_hh_data.hpp"
 
-namespace pico_tree::internal {
+namespace pico_tree {
+
+//! \brief Rules for choosing the orthogonal transformation of each tree of a
+//! KdForest.
+enum class RotationRule {
+  //! \brief Each tree uses a random Householder reflection.
+  kRandom,
+  //! \brief The i-th tree maps the i-th principal axis of the point set onto
+  //! the first coordinate axis. Combined with SplittingRule::kMaxVariance, the
+  //! root of each tree splits along a different principal axis, similar to a
+  //! PCA tree or an RP-tree with data dependent projections. Trees beyond the
+  //! spatial dimension repeat earlier axes.
+  kPrincipalAxis
+};
+
+namespace internal {
 
 template <typename Node_, Size Dim_, SplittingRule SplittingRule_>
 class BuildRKdTree {
@@ -12,7 +27,10 @@ class BuildRKdTree {
 
   template <typename SpaceWrapper_>
   std::vector<RKdTreeDataType> operator()(
-      SpaceWrapper_ space, Size max_leaf_size, Size forest_size) {
+      SpaceWrapper_ space,
+      Size max_leaf_size,
+      Size forest_size,
+      RotationRule rotation_rule = RotationRule::kRandom) {
     assert(space.size() > 0);
     assert(max_leaf_size > 0);
     assert(forest_size > 0);
@@ -20,10 +38,18 @@ class BuildRKdTree {
     using SpaceWrapperType = typename RKdTreeDataType::SpaceWrapperType;
     using BuildKdTreeType = BuildKdTree<Node_, Dim_, SplittingRule_>;
 
+    std::vector<typename RKdTreeDataType::RotationType> axes;
+    if (rotation_rule == RotationRule::kPrincipalAxis) {
+      axes = PrincipalAxes<typename RKdTreeDataType::ScalarType, Dim_>(
+          space, forest_size);
+    }
+
     std::vector<RKdTreeDataType> trees;
     trees.reserve(forest_size);
     for (std::size_t i = 0; i < forest_size; ++i) {
-      auto r = RKdTreeDataType::RandomRotation(space);
+      auto r = rotation_rule == RotationRule::kPrincipalAxis
+                   ? RKdTreeDataType::PrincipalAxisRotation(axes[i])
+                   : RKdTreeDataType::RandomRotation(space);
       auto s = RKdTreeDataType::RotateSpace(r, space);
       auto t = BuildKdTreeType()(SpaceWrapperType(s), max_leaf_size);
       trees.push_back({std::move(r), std::move(s), std::move(t)});
@@ -32,4 +58,6 @@ class BuildRKdTree {
   }
 };
 
-}  // namespace pico_tree::internal
+}  // namespace internal
+
+}  // namespace pico_tree
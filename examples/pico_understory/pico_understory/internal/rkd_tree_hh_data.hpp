@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <random>
+#include <vector>
 
 #include "pico_tree/internal/kd_tree_data.hpp"
 #include "pico_tree/internal/point.hpp"
@@ -27,6 +29,104 @@ inline Point<Scalar_, Dim_> RandomNormal(Size dim) {
   return v;
 }
 
+//! \brief Returns the first \p count principal axes of \p space. Axes beyond
+//! the spatial dimension of \p space repeat the earlier ones.
+//! \details The axes are estimated from a sample of the points using power
+//! iteration. Each following axis is kept orthogonal to the previous ones.
+//! Computations are done in double because the variance along the last axes
+//! can be many orders of magnitude smaller than along the first.
+template <typename Scalar_, Size Dim_, typename SpaceWrapper_>
+std::vector<Point<Scalar_, Dim_>> PrincipalAxes(
+    SpaceWrapper_ space, Size count) {
+  using VectorType = Point<double, Dim_>;
+
+  Size constexpr kSampleSize = 1000;
+  Size constexpr kIterationCount = 32;
+
+  Size const sdim = space.sdim();
+  Size const sample_count = std::min(space.size(), kSampleSize);
+  Size const stride = space.size() / sample_count;
+
+  // The centered sample.
+  std::vector<VectorType> sample(sample_count, VectorType::FromSize(sdim));
+  VectorType mean = VectorType::FromSize(sdim);
+  mean.Fill(0.0);
+  for (Size i = 0; i < sample_count; ++i) {
+    auto const x = space[i * stride];
+    for (Size j = 0; j < sdim; ++j) {
+      sample[i][j] = static_cast<double>(x[j]);
+      mean[j] += sample[i][j];
+    }
+  }
+  for (Size j = 0; j < sdim; ++j) {
+    mean[j] /= static_cast<double>(sample_count);
+  }
+  for (auto& x : sample) {
+    for (Size j = 0; j < sdim; ++j) {
+      x[j] -= mean[j];
+    }
+  }
+
+  // Gram-Schmidt against the previously found axes.
+  auto const orthogonalize = [sdim](auto const& axes, VectorType& v) {
+    for (auto const& a : axes) {
+      double dot = 0.0;
+      for (Size j = 0; j < sdim; ++j) {
+        dot += v[j] * a[j];
+      }
+      for (Size j = 0; j < sdim; ++j) {
+        v[j] -= dot * a[j];
+      }
+    }
+  };
+
+  std::vector<VectorType> axes;
+  axes.reserve(std::min(count, sdim));
+  VectorType next = VectorType::FromSize(sdim);
+  while (axes.size() < std::min(count, sdim)) {
+    VectorType axis = RandomNormal<double, Dim_>(sdim);
+    orthogonalize(axes, axis);
+    axis.Normalize();
+    for (Size iteration = 0; iteration < kIterationCount; ++iteration) {
+      // Multiplication with the covariance matrix without forming it.
+      next.Fill(0.0);
+      for (auto const& x : sample) {
+        double dot = 0.0;
+        for (Size j = 0; j < sdim; ++j) {
+          dot += x[j] * axis[j];
+        }
+        for (Size j = 0; j < sdim; ++j) {
+          next[j] += x[j] * dot;
+        }
+      }
+      orthogonalize(axes, next);
+      double norm = 0.0;
+      for (Size j = 0; j < sdim; ++j) {
+        norm += next[j] * next[j];
+      }
+      // The remaining variance is zero. The current axis is as good as any.
+      if (!(norm > 0.0)) {
+        break;
+      }
+      next.Normalize();
+      std::swap(axis, next);
+    }
+    axes.push_back(std::move(axis));
+  }
+
+  std::vector<Point<Scalar_, Dim_>> result;
+  result.reserve(count);
+  for (Size i = 0; i < count; ++i) {
+    auto const& a = axes[i % axes.size()];
+    result.push_back(Point<Scalar_, Dim_>::FromSize(sdim));
+    for (Size j = 0; j < sdim; ++j) {
+      result.back()[j] = static_cast<Scalar_>(a[j]);
+    }
+  }
+
+  return result;
+}
+
 // Rotating datasets is computationally expensive. It is quadratic in the
 // dimension of the space. Because we're only actually interested in obtaining a
 // random orthogonal basis, any orthogonal transformation matrix will do, such
@@ -49,6 +149,17 @@ class RKdTreeHhData {
     return RandomNormal<ScalarType, Dim_>(space.sdim());
   }
 
+  //! \brief Returns the Householder reflection that maps \p axis onto the
+  //! first coordinate axis. A splitting rule such as kMaxVariance will split
+  //! the rotated space along \p axis first.
+  static inline RotationType PrincipalAxisRotation(RotationType const& axis) {
+    // The sign is chosen to avoid cancellation when axis is close to e0.
+    RotationType v = axis;
+    v[0] += axis[0] < ScalarType(0) ? ScalarType(-1) : ScalarType(1);
+    v.Normalize();
+    return v;
+  }
+
   template <typename SpaceWrapper_>
   static inline SpaceType RotateSpace(
       RotationType const& rotation, SpaceWrapper_ space) {
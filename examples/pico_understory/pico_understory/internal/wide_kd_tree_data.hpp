@@ -0,0 +1,151 @@
+#pragma once
+
+#include <array>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "pico_tree/core.hpp"
+#include "pico_tree/internal/box.hpp"
+#include "pico_tree/internal/memory.hpp"
+
+namespace pico_tree::internal {
+
+//! \brief Child of a WideKdTreeNode. It is either another node or a leaf.
+template <typename Node_, typename Index_>
+struct WideKdTreeChild {
+  //! \brief Returns if the child is a leaf.
+  inline bool IsLeaf() const { return node == nullptr; }
+
+  //! \brief Child node. It equals nullptr for a leaf.
+  Node_* node;
+  //! \brief Begin of the index range of a leaf.
+  Index_ begin_idx;
+  //! \brief End of the index range of a leaf.
+  Index_ end_idx;
+};
+
+//! \brief KdTree node with \p Ways_ children for a Euclidean space.
+//! \details A node represents log2(Ways_) levels of a binary KdTree. The
+//! Ways_ - 1 split planes of those levels are stored in heap order: the
+//! children of split h are at 2h + 1 and 2h + 2. Heap positions of Ways_ - 1
+//! and above refer to the children of the node. The split planes of a node are
+//! stored next to each other such that a single node load brings in all of
+//! them.
+//! <p/>
+//! When a leaf of the binary tree is encountered before the last level of a
+//! node, its split dimension is set to kNoSplit and the search only continues
+//! into the left subtree of the position. The right subtree only contains
+//! empty leaves.
+template <typename Index_, typename Scalar_, Size Ways_>
+struct WideKdTreeNode {
+  static_assert(
+      Ways_ >= 2 && (Ways_ & (Ways_ - 1)) == 0, "WAYS_NOT_A_POWER_OF_TWO");
+
+  using IndexType = Index_;
+  using ScalarType = Scalar_;
+  using ChildType = WideKdTreeChild<WideKdTreeNode, Index_>;
+
+  //! \brief Number of children of a node.
+  static Size constexpr kWays = Ways_;
+  //! \brief Number of split planes of a node.
+  static Size constexpr kSplitCount = Ways_ - 1;
+  //! \brief Split dimension of a position that represents a binary leaf.
+  static int constexpr kNoSplit = -1;
+
+  //! \brief Split dimensions in heap order.
+  std::array<int, kSplitCount> split_dim;
+  //! \brief Maximum coordinate values of the left boxes in heap order.
+  std::array<ScalarType, kSplitCount> left_max;
+  //! \brief Minimum coordinate values of the right boxes in heap order.
+  std::array<ScalarType, kSplitCount> right_min;
+  //! \brief Children of the node.
+  std::array<ChildType, kWays> children;
+};
+
+//! \brief The data structure that represents a WideKdTree.
+template <typename Index_, typename Scalar_, Size Dim_, Size Ways_>
+class WideKdTreeData {
+ public:
+  using IndexType = Index_;
+  using ScalarType = Scalar_;
+  static Size constexpr Dim = Dim_;
+  using BoxType = Box<ScalarType, Dim>;
+  using NodeType = WideKdTreeNode<Index_, Scalar_, Ways_>;
+  using NodeAllocatorType = ChunkAllocator<NodeType, 256>;
+  using IndicesType = std::pmr::vector<IndexType>;
+
+  //! \brief Creates a WideKdTreeData by collapsing the nodes of \p data, a
+  //! KdTreeData for a Euclidean space. The indices of \p data are moved.
+  template <typename KdTreeData_>
+  static WideKdTreeData FromKdTreeData(KdTreeData_&& data) {
+    std::pmr::memory_resource* resource = data.allocator.resource();
+    WideKdTreeData wide{
+        std::move(data.indices),
+        data.root_box,
+        NodeAllocatorType(resource),
+        nullptr};
+    wide.root_node = wide.Collapse(data.root_node);
+    return wide;
+  }
+
+  //! \brief Sorted indices that refer to points inside the space.
+  IndicesType indices;
+  //! \brief Bounding box of the root node.
+  BoxType root_box;
+  //! \brief Memory allocator for tree nodes.
+  NodeAllocatorType allocator;
+  //! \brief Root of the WideKdTree.
+  NodeType* root_node;
+
+ private:
+  //! \brief Returns a node that represents the top levels of the binary
+  //! subtree of \p node.
+  template <typename Node_>
+  NodeType* Collapse(Node_ const* const node) {
+    NodeType* wide = allocator.Allocate();
+    Fill(*wide, node, 0);
+    return wide;
+  }
+
+  //! \brief Stores the binary subtree of \p node at heap position \p h of \p
+  //! wide.
+  template <typename Node_>
+  void Fill(NodeType& wide, Node_ const* const node, Size const h) {
+    if (h >= NodeType::kSplitCount) {
+      auto& child = wide.children[h - NodeType::kSplitCount];
+      if (node->IsLeaf()) {
+        child = {nullptr, node->data.leaf.begin_idx, node->data.leaf.end_idx};
+      } else {
+        child = {Collapse(node), 0, 0};
+      }
+    } else if (node->IsLeaf()) {
+      wide.split_dim[h] = NodeType::kNoSplit;
+      wide.left_max[h] = ScalarType(0);
+      wide.right_min[h] = ScalarType(0);
+      Fill(wide, node, 2 * h + 1);
+      FillEmpty(wide, 2 * h + 2);
+    } else {
+      wide.split_dim[h] = node->data.branch.split_dim;
+      wide.left_max[h] = node->data.branch.left_max;
+      wide.right_min[h] = node->data.branch.right_min;
+      Fill(wide, node->left, 2 * h + 1);
+      Fill(wide, node->right, 2 * h + 2);
+    }
+  }
+
+  //! \brief Stores empty leaves at heap position \p h of \p wide.
+  void FillEmpty(NodeType& wide, Size const h) {
+    if (h >= NodeType::kSplitCount) {
+      wide.children[h - NodeType::kSplitCount] = {nullptr, 0, 0};
+    } else {
+      wide.split_dim[h] = NodeType::kNoSplit;
+      wide.left_max[h] = ScalarType(0);
+      wide.right_min[h] = ScalarType(0);
+      FillEmpty(wide, 2 * h + 1);
+      FillEmpty(wide, 2 * h + 2);
+    }
+  }
+};
+
+}  // namespace pico_tree::internal
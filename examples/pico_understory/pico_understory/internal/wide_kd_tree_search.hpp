@@ -0,0 +1,120 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+
+#include "pico_tree/core.hpp"
+#include "pico_tree/internal/point.hpp"
+#include "pico_tree/metric.hpp"
+
+namespace pico_tree::internal {
+
+//! \brief This class provides a search nearest function for a WideKdTree.
+//! \details The search is the same as that of SearchNearestEuclidean. The
+//! split planes within a node are traversed by an unrolled recursion such that
+//! only the descent into another node costs a dependent load.
+template <
+    typename SpaceWrapper_,
+    typename Metric_,
+    typename PointWrapper_,
+    typename Visitor_,
+    typename Node_>
+class SearchNearestWide {
+ public:
+  using IndexType = typename Node_::IndexType;
+  using ScalarType = typename SpaceWrapper_::ScalarType;
+  using DistanceType = MetricDistanceType<Metric_, ScalarType>;
+  using PointType = Point<DistanceType, SpaceWrapper_::Dim>;
+  //! \brief Node type supported by this SearchNearestWide.
+  using NodeType = Node_;
+
+  inline SearchNearestWide(
+      SpaceWrapper_ space,
+      Metric_ metric,
+      std::pmr::vector<IndexType> const& indices,
+      PointWrapper_ query,
+      Visitor_& visitor)
+      : space_(space),
+        metric_(metric),
+        indices_(indices),
+        query_(query),
+        node_box_offset_(PointType::FromSize(space_.sdim())),
+        visitor_(visitor) {}
+
+  //! \brief Search nearest neighbors starting from \p node.
+  inline void operator()(NodeType const* const node) {
+    node_box_offset_.Fill(DistanceType(0.0));
+    SearchNearest<0>(*node, DistanceType(0.0));
+  }
+
+ private:
+  //! \brief Searches the subtree at heap position H of \p node.
+  template <Size H>
+  inline void SearchNearest(
+      NodeType const& node, DistanceType node_box_distance) {
+    if constexpr (H >= NodeType::kSplitCount) {
+      auto const& child = node.children[H - NodeType::kSplitCount];
+      if (child.IsLeaf()) {
+        for (IndexType i = child.begin_idx; i < child.end_idx; ++i) {
+          visitor_(
+              indices_[i],
+              metric_(query_.begin(), query_.end(), space_[indices_[i]]));
+        }
+      } else {
+        SearchNearest<0>(*child.node, node_box_distance);
+      }
+    } else {
+      int const split_dim = node.split_dim[H];
+      if (split_dim == NodeType::kNoSplit) {
+        SearchNearest<2 * H + 1>(node, node_box_distance);
+        return;
+      }
+
+      ScalarType const v = query_[split_dim];
+      ScalarType const left_max = node.left_max[H];
+      ScalarType const right_min = node.right_min[H];
+
+      // See SearchNearestEuclidean for the traversal order and the incremental
+      // node box distance.
+      if ((left_max + right_min - v - v) > 0) {
+        SearchNearest<2 * H + 1>(node, node_box_distance);
+        DistanceType const new_offset = metric_(right_min, v);
+        if (UpdateDistance(split_dim, new_offset, node_box_distance)) {
+          DistanceType const old_offset = node_box_offset_[split_dim];
+          node_box_offset_[split_dim] = new_offset;
+          SearchNearest<2 * H + 2>(node, node_box_distance);
+          node_box_offset_[split_dim] = old_offset;
+        }
+      } else {
+        SearchNearest<2 * H + 2>(node, node_box_distance);
+        DistanceType const new_offset = metric_(left_max, v);
+        if (UpdateDistance(split_dim, new_offset, node_box_distance)) {
+          DistanceType const old_offset = node_box_offset_[split_dim];
+          node_box_offset_[split_dim] = new_offset;
+          SearchNearest<2 * H + 1>(node, node_box_distance);
+          node_box_offset_[split_dim] = old_offset;
+        }
+      }
+    }
+  }
+
+  //! \brief Updates \p node_box_distance to the distance of the second child
+  //! of a split and returns true if that child is within the search distance.
+  inline bool UpdateDistance(
+      int const split_dim,
+      DistanceType const new_offset,
+      DistanceType& node_box_distance) const {
+    node_box_distance =
+        node_box_distance - node_box_offset_[split_dim] + new_offset;
+    return visitor_.max() >= node_box_distance;
+  }
+
+  SpaceWrapper_ space_;
+  Metric_ metric_;
+  std::pmr::vector<IndexType> const& indices_;
+  PointWrapper_ query_;
+  PointType node_box_offset_;
+  Visitor_& visitor_;
+};
+
+}  // namespace pico_tree::internal
@@ -39,11 +39,20 @@ class KdForest {
   //! \brief Neighbor type of various search resuls.
   using NeighborType = Neighbor<IndexType, ScalarType>;
 
-  KdForest(SpaceType space, SizeType max_leaf_size, SizeType forest_size)
+  //! \brief Creates a KdForest of \p forest_size trees. The orthogonal
+  //! transformation of each tree is chosen by \p rotation_rule.
+  KdForest(
+      SpaceType space,
+      SizeType max_leaf_size,
+      SizeType forest_size,
+      RotationRule rotation_rule = RotationRule::kRandom)
       : space_(std::move(space)),
         metric_(),
         data_(BuildRKdTreeType()(
-            SpaceWrapperType(space_), max_leaf_size, forest_size)) {}
+            SpaceWrapperType(space_),
+            max_leaf_size,
+            forest_size,
+            rotation_rule)) {}
 
   //! \brief The KdForest cannot be copied.
   //! \details The KdForest uses pointers to nodes and copying pointers is not
@@ -125,9 +134,13 @@ template <
     SplittingRule SplittingRule_ = SplittingRule::kSlidingMidpoint,
     typename Index_ = int,
     typename Space_>
-auto MakeKdForest(Space_&& space, Size max_leaf_size, Size forest_size) {
+auto MakeKdForest(
+    Space_&& space,
+    Size max_leaf_size,
+    Size forest_size,
+    RotationRule rotation_rule = RotationRule::kRandom) {
   return KdForest<std::decay_t<Space_>, Metric_, SplittingRule_, Index_>(
-      std::forward<Space_>(space), max_leaf_size, forest_size);
+      std::forward<Space_>(space), max_leaf_size, forest_size, rotation_rule);
 }
 
 }  // namespace pico_tree
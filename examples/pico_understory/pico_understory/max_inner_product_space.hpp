@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "pico_tree/core.hpp"
+#include "pico_tree/internal/point.hpp"
+#include "pico_tree/internal/point_wrapper.hpp"
+#include "pico_tree/internal/space_wrapper.hpp"
+#include "pico_tree/map_traits.hpp"
+#include "pico_tree/metric.hpp"
+#include "pico_understory/internal/matrix_space.hpp"
+#include "pico_understory/internal/point_traits.hpp"
+
+namespace pico_tree {
+
+//! \brief A MaxInnerProductSpace reduces maximum inner product search (MIPS) to
+//! a nearest neighbor search using the L2Squared metric.
+//! \details Each point x is augmented with a single coordinate:
+//! x' = (x, sqrt(M^2 - |x|^2)), where M is the largest norm of all points. A
+//! query q is augmented with a zero: q' = (q, 0). Then:
+//! |q' - x'|^2 = |q|^2 + M^2 - 2 q.x
+//! such that the nearest neighbors of q' are the points with the largest inner
+//! product with q. Queries should be augmented using Query(). Distances can be
+//! converted back to inner products using InnerProduct().
+//!
+//! Y. Bachrach et al., Speeding up the Xbox recommender system using a
+//! Euclidean transformation for inner-product spaces, In RecSys, pp. 257–264,
+//! 2014.
+template <typename Scalar_, Size Dim_>
+class MaxInnerProductSpace {
+ public:
+  using ScalarType = Scalar_;
+  using SizeType = Size;
+  //! \brief Spatial dimension of the augmented points.
+  static SizeType constexpr Dim =
+      Dim_ == kDynamicSize ? kDynamicSize : Dim_ + 1;
+  //! \brief Type of an augmented query.
+  using PointType = internal::Point<ScalarType, Dim>;
+
+  //! \brief Creates a MaxInnerProductSpace by augmenting all points of \p
+  //! space.
+  template <typename Space_>
+  explicit MaxInnerProductSpace(Space_ const& space)
+      : points_(
+            internal::SpaceWrapper<Space_>(space).size(),
+            internal::SpaceWrapper<Space_>(space).sdim() + 1) {
+    static_assert(
+        std::is_same_v<
+            typename internal::SpaceWrapper<Space_>::ScalarType,
+            ScalarType>,
+        "SPACE_SCALAR_TYPE_DOES_NOT_EQUAL_SCALAR_TYPE");
+    static_assert(
+        internal::SpaceWrapper<Space_>::Dim == Dim_,
+        "SPACE_DIM_DOES_NOT_EQUAL_MAX_INNER_PRODUCT_SPACE_DIM");
+
+    internal::SpaceWrapper<Space_> input(space);
+    SizeType const input_sdim = input.sdim();
+
+    std::vector<ScalarType> squared_norms(size());
+    max_squared_norm_ = ScalarType(0.0);
+    for (SizeType i = 0; i < size(); ++i) {
+      ScalarType const* x = input[i];
+      squared_norms[i] = internal::Dot(x, x + input_sdim, x);
+      max_squared_norm_ = std::max(max_squared_norm_, squared_norms[i]);
+    }
+
+    for (SizeType i = 0; i < size(); ++i) {
+      ScalarType const* x = input[i];
+      ScalarType* y = points_.data(i);
+      std::copy(x, x + input_sdim, y);
+      // Rounding may result in a slightly negative difference.
+      y[input_sdim] = std::sqrt(
+          std::max(max_squared_norm_ - squared_norms[i], ScalarType(0.0)));
+    }
+  }
+
+  //! \brief Returns the augmented version of query point \p x.
+  template <typename P>
+  PointType Query(P const& x) const {
+    internal::PointWrapper<P> p(x);
+    PointType q = PointType::FromSize(sdim());
+    std::copy(p.begin(), p.end(), q.data());
+    q[sdim() - 1] = ScalarType(0.0);
+    return q;
+  }
+
+  //! \brief Returns the inner product between query point \p x and a point
+  //! given the L2Squared \p distance between their augmented versions.
+  //! \details The conversion suffers from cancellation when the inner product
+  //! is small compared to the norms of the points. Use internal::Dot() to
+  //! recompute it exactly.
+  template <typename P>
+  ScalarType InnerProduct(P const& x, ScalarType const distance) const {
+    internal::PointWrapper<P> p(x);
+    ScalarType const squared_norm =
+        internal::Dot(p.begin(), p.end(), p.begin());
+    return (squared_norm + max_squared_norm_ - distance) / ScalarType(2.0);
+  }
+
+  //! \brief Returns the augmented point at index \p i.
+  inline PointMap<ScalarType const, Dim> operator[](SizeType i) const {
+    return points_[i];
+  }
+
+  //! \brief Returns the largest squared norm of the original points.
+  inline ScalarType max_squared_norm() const { return max_squared_norm_; }
+
+  //! \brief Returns the number of points.
+  inline SizeType size() const { return points_.size(); }
+
+  //! \brief Returns the spatial dimension of the augmented points.
+  inline SizeType sdim() const { return points_.sdim(); }
+
+ private:
+  ScalarType max_squared_norm_;
+  internal::MatrixSpace<ScalarType, Dim> points_;
+};
+
+template <typename Scalar_, Size Dim_>
+struct SpaceTraits<MaxInnerProductSpace<Scalar_, Dim_>> {
+  using SpaceType = MaxInnerProductSpace<Scalar_, Dim_>;
+  using PointType =
+      PointMap<typename SpaceType::ScalarType const, SpaceType::Dim>;
+  using ScalarType = typename SpaceType::ScalarType;
+  using SizeType = typename SpaceType::SizeType;
+  static SizeType constexpr Dim = SpaceType::Dim;
+
+  template <typename Index_>
+  inline static PointType PointAt(SpaceType const& space, Index_ idx) {
+    return space[static_cast<SizeType>(idx)];
+  }
+
+  inline static SizeType size(SpaceType const& space) { return space.size(); }
+
+  inline static SizeType sdim(SpaceType const& space) { return space.sdim(); }
+};
+
+}  // namespace pico_tree
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <fstream>
+#include <memory_resource>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "pico_tree/core.hpp"
+
+//! \file numa.hpp
+//! \brief Utilities for placing data on the nodes of a NUMA system.
+//! \details Only Linux is supported. The system calls are used directly such
+//! that there is no dependency on libnuma. On other platforms there is a single
+//! node and memory is allocated as usual.
+
+namespace pico_tree {
+
+//! \brief Returns the number of NUMA nodes of the system.
+inline Size NumaNodeCount() {
+#if defined(__linux__)
+  // The file contains a range of node ids like "0" or "0-1".
+  std::ifstream stream("/sys/devices/system/node/possible");
+  std::string range;
+  if (stream >> range) {
+    auto const last = range.find_last_of("-,");
+    return static_cast<Size>(
+               std::stoul(
+                   last == std::string::npos ? range
+                                             : range.substr(last + 1))) +
+           1;
+  }
+#endif
+  return 1;
+}
+
+namespace internal {
+
+//! \brief Returns the CPUs of NUMA node \p node.
+inline std::vector<Size> ReadNodeCpus([[maybe_unused]] Size node) {
+  std::vector<Size> cpus;
+#if defined(__linux__)
+  // The file contains ranges of cpu ids like "0-3,8-11". It is empty for a
+  // node without cpus.
+  std::ifstream stream(
+      "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  std::string list;
+  if (!(stream >> list)) {
+    return cpus;
+  }
+  std::istringstream ranges(list);
+  std::string range;
+  while (std::getline(ranges, range, ',')) {
+    auto const dash = range.find('-');
+    auto const first = static_cast<Size>(std::stoul(range.substr(0, dash)));
+    auto const last =
+        dash == std::string::npos
+            ? first
+            : static_cast<Size>(std::stoul(range.substr(dash + 1)));
+    for (Size cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+#endif
+  return cpus;
+}
+
+//! \brief Returns the NUMA node of each CPU of the system.
+inline std::vector<Size> ReadCpuNodes() {
+  std::vector<Size> cpu_nodes;
+  Size const node_count = NumaNodeCount();
+  for (Size node = 0; node < node_count; ++node) {
+    for (Size const cpu : ReadNodeCpus(node)) {
+      if (cpu_nodes.size() <= cpu) {
+        cpu_nodes.resize(cpu + 1, 0);
+      }
+      cpu_nodes[cpu] = node;
+    }
+  }
+  return cpu_nodes;
+}
+
+}  // namespace internal
+
+//! \brief Returns the NUMA node of the CPU that the calling thread runs on.
+//! \details The node of each CPU is read once. After that, the CPU is obtained
+//! with sched_getcpu(), which usually doesn't enter the kernel, such that it
+//! can be called per query.
+inline Size CurrentNumaNode() {
+#if defined(__linux__)
+  static std::vector<Size> const cpu_nodes = internal::ReadCpuNodes();
+  int const cpu = sched_getcpu();
+  if (cpu >= 0 && static_cast<Size>(cpu) < cpu_nodes.size()) {
+    return cpu_nodes[static_cast<Size>(cpu)];
+  }
+#endif
+  return 0;
+}
+
+//! \brief Runs the calling thread on the CPUs of NUMA node \p node for as long
+//! as the object exists.
+//! \details The operating system places a page on the node of the thread that
+//! touches it first. Memory that is first written while the binding exists,
+//! such as a copy of a point set, ends up on the node. The previous affinity
+//! of the thread is restored on destruction. The thread is left where it is
+//! when the node has no CPUs or when its CPUs are not available to the
+//! process.
+class ScopedNumaNodeAffinity {
+ public:
+  //! \brief Binds the calling thread to the CPUs of NUMA node \p node.
+  explicit ScopedNumaNodeAffinity([[maybe_unused]] Size node) {
+#if defined(__linux__)
+    std::vector<Size> const cpus = internal::ReadNodeCpus(node);
+    if (cpus.empty() ||
+        sched_getaffinity(0, sizeof(previous_), &previous_) != 0) {
+      return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (Size const cpu : cpus) {
+      if (cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &set);
+      }
+    }
+    bound_ = sched_setaffinity(0, sizeof(set), &set) == 0;
+#endif
+  }
+
+  ScopedNumaNodeAffinity(ScopedNumaNodeAffinity const&) = delete;
+  ScopedNumaNodeAffinity& operator=(ScopedNumaNodeAffinity const&) = delete;
+
+  //! \brief Restores the previous affinity of the calling thread.
+  ~ScopedNumaNodeAffinity() {
+#if defined(__linux__)
+    if (bound_) {
+      sched_setaffinity(0, sizeof(previous_), &previous_);
+    }
+#endif
+  }
+
+  //! \brief Returns true if the thread runs on the CPUs of the node.
+  inline bool bound() const { return bound_; }
+
+ private:
+#if defined(__linux__)
+  cpu_set_t previous_;
+#endif
+  bool bound_ = false;
+};
+
+//! \brief A memory resource that prefers to place its memory on a single NUMA
+//! node.
+//! \details Each allocation is mapped separately and rounded up to a whole
+//! number of pages. The resource is meant for a small number of large
+//! allocations, such as the indices and nodes of a KdTree. When the memory of
+//! the node runs out, or when the system doesn't support NUMA, the memory is
+//! placed as usual.
+class NumaMemoryResource : public std::pmr::memory_resource {
+ public:
+  //! \brief Creates a NumaMemoryResource for NUMA node \p node.
+  explicit NumaMemoryResource(Size node) : node_(node) {}
+
+  //! \brief Returns the NUMA node of the memory.
+  inline Size node() const { return node_; }
+
+ private:
+  void* do_allocate(
+      std::size_t bytes, [[maybe_unused]] std::size_t alignment) override {
+#if defined(__linux__)
+    // Mapped memory is page aligned.
+    bytes = bytes > 0 ? bytes : 1;
+    void* memory = mmap(
+        nullptr,
+        bytes,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0);
+    if (memory == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+#if defined(SYS_mbind)
+    // The policy is applied when pages are first touched. Failure of the call
+    // is not an error.
+    int constexpr kMpolPreferred = 1;
+    std::size_t constexpr kBits = sizeof(unsigned long) * CHAR_BIT;
+    std::vector<unsigned long> mask(node_ / kBits + 1, 0);
+    mask[node_ / kBits] = 1UL << (node_ % kBits);
+    syscall(
+        SYS_mbind,
+        memory,
+        bytes,
+        kMpolPreferred,
+        mask.data(),
+        mask.size() * kBits + 1,
+        0);
+#endif
+    return memory;
+#else
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+#endif
+  }
+
+  void do_deallocate(
+      void* memory,
+      std::size_t bytes,
+      [[maybe_unused]] std::size_t alignment) override {
+#if defined(__linux__)
+    munmap(memory, bytes > 0 ? bytes : 1);
+#else
+    std::pmr::new_delete_resource()->deallocate(memory, bytes, alignment);
+#endif
+  }
+
+  bool do_is_equal(
+      std::pmr::memory_resource const& other) const noexcept override {
+    return this == &other;
+  }
+
+  Size node_;
+};
+
+}  // namespace pico_tree
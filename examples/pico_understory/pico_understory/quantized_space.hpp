@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "pico_tree/core.hpp"
+#include "pico_tree/internal/point.hpp"
+#include "pico_tree/internal/point_wrapper.hpp"
+#include "pico_tree/internal/space_wrapper.hpp"
+#include "pico_tree/map_traits.hpp"
+#include "pico_tree/metric.hpp"
+#include "pico_understory/internal/matrix_space.hpp"
+#include "pico_understory/internal/point_traits.hpp"
+
+namespace pico_tree {
+
+//! \brief A QuantizedSpace stores each coordinate of a point set as a single
+//! std::uint8_t code. It takes a quarter of the memory of a float point set.
+//! \details Coordinates are quantized as: code = round((x - offset) / scale).
+//! The offset of each dimension equals its minimum. The scale is shared by all
+//! dimensions such that distances between codes remain proportional to those
+//! between the original points. For the L2Squared metric this means that:
+//! distance(x, y) ~= scale^2 * distance(code(x), code(y)).
+//!
+//! A KdTree over a QuantizedSpace computes its distances using int. Queries
+//! should be quantized using Encode(). The precision lost by quantization can
+//! be recovered by searching for a few more neighbors than needed and
+//! re-ranking those using the original points. See Rerank().
+template <typename Scalar_, Size Dim_>
+class QuantizedSpace {
+ public:
+  //! \brief Type of a quantized coordinate.
+  using ScalarType = std::uint8_t;
+  //! \brief Type of an original coordinate.
+  using DecodedScalarType = Scalar_;
+  using SizeType = Size;
+  static SizeType constexpr Dim = Dim_;
+  //! \brief Type of a quantized point.
+  using PointType = internal::Point<ScalarType, Dim_>;
+  //! \brief Type of a decoded point.
+  using DecodedPointType = internal::Point<DecodedScalarType, Dim_>;
+
+  //! \brief Creates a QuantizedSpace by quantizing all points of \p space.
+  template <typename Space_>
+  explicit QuantizedSpace(Space_ const& space)
+      : offset_(DecodedPointType::FromSize(
+            internal::SpaceWrapper<Space_>(space).sdim())),
+        codes_(
+            internal::SpaceWrapper<Space_>(space).size(),
+            internal::SpaceWrapper<Space_>(space).sdim()) {
+    static_assert(
+        std::is_same_v<
+            typename internal::SpaceWrapper<Space_>::ScalarType,
+            DecodedScalarType>,
+        "SPACE_SCALAR_TYPE_DOES_NOT_EQUAL_DECODED_SCALAR_TYPE");
+    static_assert(
+        internal::SpaceWrapper<Space_>::Dim == Dim_,
+        "SPACE_DIM_DOES_NOT_EQUAL_QUANTIZED_SPACE_DIM");
+
+    internal::SpaceWrapper<Space_> points(space);
+    auto const box = points.ComputeBoundingBox();
+
+    DecodedScalarType max_delta;
+    SizeType max_dim;
+    box.LongestAxis(max_dim, max_delta);
+    // A space where all points are equal has a range of zero.
+    scale_ = max_delta > DecodedScalarType(0.0)
+                 ? max_delta / DecodedScalarType(kMaxCode)
+                 : DecodedScalarType(1.0);
+    std::copy(box.min(), box.min() + sdim(), offset_.data());
+
+    for (SizeType i = 0; i < size(); ++i) {
+      Encode(points[i], codes_.data(i));
+    }
+  }
+
+  //! \brief Returns the quantized version of point \p x. Coordinates outside
+  //! of the range of the QuantizedSpace are clamped to it.
+  template <typename P>
+  PointType Encode(P const& x) const {
+    PointType code = PointType::FromSize(sdim());
+    Encode(internal::PointWrapper<P>(x).begin(), code.data());
+    return code;
+  }
+
+  //! \brief Returns the approximation of the original point at index \p i.
+  DecodedPointType Decode(SizeType i) const {
+    DecodedPointType x = DecodedPointType::FromSize(sdim());
+    ScalarType const* code = codes_.data(i);
+    for (SizeType j = 0; j < sdim(); ++j) {
+      x[j] = static_cast<DecodedScalarType>(code[j]) * scale_ + offset_[j];
+    }
+    return x;
+  }
+
+  //! \brief Returns the quantized point at index \p i.
+  inline PointMap<ScalarType const, Dim_> operator[](SizeType i) const {
+    return codes_[i];
+  }
+
+  //! \brief Returns the size of a single quantization step.
+  inline DecodedScalarType scale() const { return scale_; }
+
+  //! \brief Returns the number of points.
+  inline SizeType size() const { return codes_.size(); }
+
+  //! \brief Returns the spatial dimension of the points.
+  inline SizeType sdim() const { return codes_.sdim(); }
+
+ private:
+  static int constexpr kMaxCode = std::numeric_limits<ScalarType>::max();
+
+  inline void Encode(DecodedScalarType const* x, ScalarType* code) const {
+    for (SizeType j = 0; j < sdim(); ++j) {
+      DecodedScalarType const c = std::round((x[j] - offset_[j]) / scale_);
+      code[j] = static_cast<ScalarType>(std::clamp(
+          c, DecodedScalarType(0.0), static_cast<DecodedScalarType>(kMaxCode)));
+    }
+  }
+
+  DecodedScalarType scale_;
+  DecodedPointType offset_;
+  internal::MatrixSpace<ScalarType, Dim_> codes_;
+};
+
+template <typename Scalar_, Size Dim_>
+struct SpaceTraits<QuantizedSpace<Scalar_, Dim_>> {
+  using SpaceType = QuantizedSpace<Scalar_, Dim_>;
+  using PointType = PointMap<typename SpaceType::ScalarType const, Dim_>;
+  using ScalarType = typename SpaceType::ScalarType;
+  using SizeType = typename SpaceType::SizeType;
+  static SizeType constexpr Dim = SpaceType::Dim;
+
+  template <typename Index_>
+  inline static PointType PointAt(SpaceType const& space, Index_ idx) {
+    return space[static_cast<SizeType>(idx)];
+  }
+
+  inline static SizeType size(SpaceType const& space) { return space.size(); }
+
+  inline static SizeType sdim(SpaceType const& space) { return space.sdim(); }
+};
+
+//! \brief Re-ranks the \p candidates of query point \p x using the exact
+//! distances between \p x and the original \p points. The \p k closest
+//! candidates are stored in \p knn, sorted from closest to farthest.
+//! \details The candidates are typically the result of a search using a
+//! QuantizedSpace, which is only approximate. The more candidates there are,
+//! the more likely it becomes that \p knn contains the true nearest neighbors.
+template <
+    typename Space_,
+    typename P,
+    typename Index_,
+    typename CandidateDistance_,
+    typename Distance_,
+    typename Metric_ = L2Squared>
+void Rerank(
+    Space_ const& points,
+    P const& x,
+    std::vector<Neighbor<Index_, CandidateDistance_>> const& candidates,
+    Size const k,
+    std::vector<Neighbor<Index_, Distance_>>& knn,
+    Metric_ const& metric = Metric_()) {
+  internal::SpaceWrapper<Space_> space(points);
+  internal::PointWrapper<P> p(x);
+
+  knn.clear();
+  knn.reserve(candidates.size());
+  for (auto const& c : candidates) {
+    knn.push_back(
+        {c.index,
+         static_cast<Distance_>(metric(p.begin(), p.end(), space[c.index]))});
+  }
+
+  auto const middle = knn.begin() + std::min(k, knn.size());
+  std::partial_sort(knn.begin(), middle, knn.end());
+  knn.erase(middle, knn.end());
+}
+
+}  // namespace pico_tree
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "pico_tree/core.hpp"
+#include "pico_understory/numa.hpp"
+
+namespace pico_tree {
+
+//! \brief A ReplicatedKdTree keeps a copy of a KdTree on each NUMA node of the
+//! system. Queries are answered by the replica of the NUMA node of the calling
+//! thread.
+//! \details Querying a tree that resides in the memory of another NUMA node is
+//! significantly slower than querying one in local memory. The tree is built
+//! once and then cloned for each node. The indices and nodes of each replica
+//! are allocated from a memory resource of that node.
+//! <p/>
+//! Whether the points get replicated depends on the SpaceType of the KdTree.
+//! A space that is stored by value is copied for each replica, while an
+//! std::reference_wrapper<SpaceType> shares the points between all replicas.
+//! Copied points are placed by the first-touch policy of the operating system.
+//! When a replica is created per NUMA node, the calling thread is bound to the
+//! node while it copies that node's replica, such that its points are local.
+//! Replicas that are created for given memory resources are copied on the
+//! calling thread and their points end up on the node of that thread.
+//! \tparam KdTree_ Type of KdTree.
+template <typename KdTree_>
+class ReplicatedKdTree {
+ public:
+  //! \brief Size type.
+  using SizeType = Size;
+  //! \brief Type of the replicated KdTree.
+  using KdTreeType = KdTree_;
+
+  //! \brief Creates a replica of \p tree for each NUMA node of the system.
+  explicit ReplicatedKdTree(KdTreeType const& tree) {
+    SizeType const node_count = NumaNodeCount();
+    resources_.reserve(node_count);
+    for (SizeType i = 0; i < node_count; ++i) {
+      resources_.push_back(std::make_unique<NumaMemoryResource>(i));
+    }
+    Replicate(tree);
+  }
+
+  //! \brief Creates a replica of \p tree for each memory resource in \p
+  //! resources. Replica i is used by threads that run on NUMA node i modulo
+  //! the number of replicas. The resources should outlive the
+  //! ReplicatedKdTree.
+  ReplicatedKdTree(
+      KdTreeType const& tree,
+      std::vector<std::pmr::memory_resource*> const& resources) {
+    replicas_.reserve(resources.size());
+    for (auto resource : resources) {
+      replicas_.emplace_back(tree, resource);
+    }
+  }
+
+  //! \brief Returns the replica of the NUMA node of the calling thread.
+  inline KdTreeType const& replica() const {
+    return replicas_[CurrentNumaNode() % replicas_.size()];
+  }
+
+  //! \brief Returns the replica at index \p i.
+  inline KdTreeType const& replica(SizeType i) const { return replicas_[i]; }
+
+  //! \brief Returns the number of replicas.
+  inline SizeType size() const { return replicas_.size(); }
+
+  //! \copydoc KdTree::SearchNearest
+  template <typename... Args_>
+  inline void SearchNearest(Args_&&... args) const {
+    replica().SearchNearest(std::forward<Args_>(args)...);
+  }
+
+  //! \copydoc KdTree::SearchNn
+  template <typename... Args_>
+  inline void SearchNn(Args_&&... args) const {
+    replica().SearchNn(std::forward<Args_>(args)...);
+  }
+
+  //! \copydoc KdTree::SearchKnn
+  template <typename... Args_>
+  inline void SearchKnn(Args_&&... args) const {
+    replica().SearchKnn(std::forward<Args_>(args)...);
+  }
+
+  //! \copydoc KdTree::SearchRadius
+  template <typename... Args_>
+  inline void SearchRadius(Args_&&... args) const {
+    replica().SearchRadius(std::forward<Args_>(args)...);
+  }
+
+  //! \copydoc KdTree::SearchBox
+  template <typename... Args_>
+  inline void SearchBox(Args_&&... args) const {
+    replica().SearchBox(std::forward<Args_>(args)...);
+  }
+
+ private:
+  inline void Replicate(KdTreeType const& tree) {
+    replicas_.reserve(resources_.size());
+    for (auto const& resource : resources_) {
+      // The points of the copy are first touched on the node of the resource.
+      ScopedNumaNodeAffinity affinity(resource->node());
+      replicas_.emplace_back(tree, resource.get());
+    }
+  }
+
+  // The resources are declared first such that they are destroyed last.
+  std::vector<std::unique_ptr<NumaMemoryResource>> resources_;
+  std::vector<KdTreeType> replicas_;
+};
+
+}  // namespace pico_tree
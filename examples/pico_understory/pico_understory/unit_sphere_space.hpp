@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "pico_tree/core.hpp"
+#include "pico_tree/internal/point.hpp"
+#include "pico_tree/internal/point_wrapper.hpp"
+#include "pico_tree/internal/space_wrapper.hpp"
+#include "pico_tree/map_traits.hpp"
+#include "pico_understory/internal/matrix_space.hpp"
+#include "pico_understory/internal/point_traits.hpp"
+
+namespace pico_tree {
+
+//! \brief A UnitSphereSpace stores geographic points as unit vectors in Earth
+//! centered, Earth fixed (ECEF) coordinates.
+//! \details Each point (latitude, longitude), given in radians, is stored as:
+//! (cos(lat) cos(lon), cos(lat) sin(lon), sin(lat))
+//! The squared chord length between two unit vectors equals 4 hav(a), where a
+//! is their central angle. A KdTree over a UnitSphereSpace using the L2Squared
+//! metric performs exact great-circle searches with tight Euclidean node box
+//! bounds. There is no longitude wrap around and a single tree serves the
+//! entire sphere.
+//! <p/>
+//! Queries should be converted using Query(). Distances can be converted to
+//! and from central angles using Angle() and ChordSquared().
+//! \see Haversine
+template <typename Scalar_>
+class UnitSphereSpace {
+ public:
+  using ScalarType = Scalar_;
+  using SizeType = Size;
+  //! \brief Spatial dimension of the unit vectors.
+  static SizeType constexpr Dim = 3;
+  //! \brief Type of a converted query.
+  using PointType = internal::Point<ScalarType, Dim>;
+
+  //! \brief Creates a UnitSphereSpace by converting all (latitude, longitude)
+  //! points of \p space.
+  template <typename Space_>
+  explicit UnitSphereSpace(Space_ const& space)
+      : points_(internal::SpaceWrapper<Space_>(space).size(), Dim) {
+    static_assert(
+        std::is_same_v<
+            typename internal::SpaceWrapper<Space_>::ScalarType,
+            ScalarType>,
+        "SPACE_SCALAR_TYPE_DOES_NOT_EQUAL_SCALAR_TYPE");
+    static_assert(
+        internal::SpaceWrapper<Space_>::Dim == 2,
+        "SPACE_DIM_MUST_BE_2_FOR_LATITUDE_AND_LONGITUDE");
+
+    internal::SpaceWrapper<Space_> input(space);
+    for (SizeType i = 0; i < size(); ++i) {
+      ToUnitVector(input[i], points_.data(i));
+    }
+  }
+
+  //! \brief Returns the unit vector of query point \p x, given as (latitude,
+  //! longitude).
+  template <typename P>
+  PointType Query(P const& x) const {
+    PointType q = PointType::FromSize(Dim);
+    ToUnitVector(internal::PointWrapper<P>(x).begin(), q.data());
+    return q;
+  }
+
+  //! \brief Returns the central angle given the squared chord length \p
+  //! distance between two unit vectors.
+  static ScalarType Angle(ScalarType const distance) {
+    // Rounding may result in a chord slightly longer than the diameter.
+    return ScalarType(2.0) *
+           std::asin(std::min(
+               std::sqrt(distance) / ScalarType(2.0), ScalarType(1.0)));
+  }
+
+  //! \brief Returns the squared chord length given the central angle \p angle.
+  //! \details It converts a search radius along the sphere to a radius for the
+  //! L2Squared metric.
+  static ScalarType ChordSquared(ScalarType const angle) {
+    ScalarType const chord =
+        ScalarType(2.0) * std::sin(angle / ScalarType(2.0));
+    return chord * chord;
+  }
+
+  //! \brief Returns the unit vector at index \p i.
+  inline PointMap<ScalarType const, Dim> operator[](SizeType i) const {
+    return points_[i];
+  }
+
+  //! \brief Returns the number of points.
+  inline SizeType size() const { return points_.size(); }
+
+  //! \brief Returns the spatial dimension of the unit vectors.
+  inline SizeType sdim() const { return Dim; }
+
+ private:
+  //! \brief Stores the unit vector of \p x in \p y.
+  static void ToUnitVector(ScalarType const* x, ScalarType* y) {
+    ScalarType const cos_lat = std::cos(x[0]);
+    y[0] = cos_lat * std::cos(x[1]);
+    y[1] = cos_lat * std::sin(x[1]);
+    y[2] = std::sin(x[0]);
+  }
+
+  internal::MatrixSpace<ScalarType, Dim> points_;
+};
+
+template <typename Scalar_>
+struct SpaceTraits<UnitSphereSpace<Scalar_>> {
+  using SpaceType = UnitSphereSpace<Scalar_>;
+  using PointType = PointMap<typename SpaceType::ScalarType const, 3>;
+  using ScalarType = typename SpaceType::ScalarType;
+  using SizeType = typename SpaceType::SizeType;
+  static SizeType constexpr Dim = SpaceType::Dim;
+
+  template <typename Index_>
+  inline static PointType PointAt(SpaceType const& space, Index_ idx) {
+    return space[static_cast<SizeType>(idx)];
+  }
+
+  inline static SizeType size(SpaceType const& space) { return space.size(); }
+
+  inline static SizeType sdim(SpaceType const& space) { return space.sdim(); }
+};
+
+}  // namespace pico_tree
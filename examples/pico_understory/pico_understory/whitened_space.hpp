@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "pico_tree/core.hpp"
+#include "pico_tree/internal/point.hpp"
+#include "pico_tree/internal/point_wrapper.hpp"
+#include "pico_tree/internal/space_wrapper.hpp"
+#include "pico_tree/map_traits.hpp"
+#include "pico_understory/internal/matrix_space.hpp"
+#include "pico_understory/internal/point_traits.hpp"
+
+namespace pico_tree {
+
+//! \brief A WhitenedSpace stores a point set transformed such that L2Squared
+//! distances between its points equal squared Mahalanobis distances between
+//! the original points.
+//! \details Given the covariance matrix S = L L^T, with L its Cholesky factor,
+//! each point x is stored as L^-1 x. Then:
+//! (x - y)^T S^-1 (x - y) = |L^-1 x - L^-1 y|^2
+//! A KdTree over a WhitenedSpace using the L2Squared metric performs exact
+//! Mahalanobis searches. Queries should be transformed using Query().
+//! <p/>
+//! For a diagonal covariance matrix the DiagonalMahalanobis metric can be used
+//! without transforming the points.
+template <typename Scalar_, Size Dim_>
+class WhitenedSpace {
+ public:
+  using ScalarType = Scalar_;
+  using SizeType = Size;
+  static SizeType constexpr Dim = Dim_;
+  //! \brief Type of a transformed query.
+  using PointType = internal::Point<ScalarType, Dim_>;
+
+  //! \brief Creates a WhitenedSpace by transforming all points of \p space
+  //! using the sample covariance matrix of the points.
+  template <typename Space_>
+  explicit WhitenedSpace(Space_ const& space)
+      : WhitenedSpace(space, Covariance(space)) {}
+
+  //! \brief Creates a WhitenedSpace by transforming all points of \p space
+  //! using \p covariance. The covariance matrix is stored in row-major order
+  //! and should be symmetric positive definite.
+  template <typename Space_>
+  WhitenedSpace(Space_ const& space, std::vector<ScalarType> const& covariance)
+      : cholesky_(Cholesky(
+            covariance, internal::SpaceWrapper<Space_>(space).sdim())),
+        points_(
+            internal::SpaceWrapper<Space_>(space).size(),
+            internal::SpaceWrapper<Space_>(space).sdim()) {
+    static_assert(
+        std::is_same_v<
+            typename internal::SpaceWrapper<Space_>::ScalarType,
+            ScalarType>,
+        "SPACE_SCALAR_TYPE_DOES_NOT_EQUAL_SCALAR_TYPE");
+    static_assert(
+        internal::SpaceWrapper<Space_>::Dim == Dim_,
+        "SPACE_DIM_DOES_NOT_EQUAL_WHITENED_SPACE_DIM");
+
+    internal::SpaceWrapper<Space_> input(space);
+    for (SizeType i = 0; i < size(); ++i) {
+      Whiten(input[i], points_.data(i));
+    }
+  }
+
+  //! \brief Returns the transformed version of query point \p x.
+  template <typename P>
+  PointType Query(P const& x) const {
+    PointType q = PointType::FromSize(sdim());
+    Whiten(internal::PointWrapper<P>(x).begin(), q.data());
+    return q;
+  }
+
+  //! \brief Returns the transformed point at index \p i.
+  inline PointMap<ScalarType const, Dim_> operator[](SizeType i) const {
+    return points_[i];
+  }
+
+  //! \brief Returns the number of points.
+  inline SizeType size() const { return points_.size(); }
+
+  //! \brief Returns the spatial dimension of the points.
+  inline SizeType sdim() const { return points_.sdim(); }
+
+ private:
+  //! \brief Returns the sample covariance matrix of \p space in row-major
+  //! order.
+  template <typename Space_>
+  static std::vector<ScalarType> Covariance(Space_ const& space) {
+    internal::SpaceWrapper<Space_> input(space);
+    SizeType const sdim = input.sdim();
+    SizeType const n = input.size();
+    assert(n > 1);
+
+    std::vector<ScalarType> mean(sdim, ScalarType(0.0));
+    for (SizeType i = 0; i < n; ++i) {
+      for (SizeType j = 0; j < sdim; ++j) {
+        mean[j] += input[i][j];
+      }
+    }
+    for (auto& m : mean) {
+      m /= static_cast<ScalarType>(n);
+    }
+
+    std::vector<ScalarType> covariance(sdim * sdim, ScalarType(0.0));
+    for (SizeType i = 0; i < n; ++i) {
+      ScalarType const* x = input[i];
+      for (SizeType r = 0; r < sdim; ++r) {
+        for (SizeType c = 0; c <= r; ++c) {
+          covariance[r * sdim + c] += (x[r] - mean[r]) * (x[c] - mean[c]);
+        }
+      }
+    }
+    for (SizeType r = 0; r < sdim; ++r) {
+      for (SizeType c = 0; c <= r; ++c) {
+        covariance[r * sdim + c] /= static_cast<ScalarType>(n - 1);
+        covariance[c * sdim + r] = covariance[r * sdim + c];
+      }
+    }
+    return covariance;
+  }
+
+  //! \brief Returns the lower triangular Cholesky factor of \p covariance in
+  //! row-major order.
+  static std::vector<ScalarType> Cholesky(
+      std::vector<ScalarType> const& covariance, SizeType const sdim) {
+    assert(covariance.size() == sdim * sdim);
+    std::vector<ScalarType> l(sdim * sdim, ScalarType(0.0));
+    for (SizeType r = 0; r < sdim; ++r) {
+      for (SizeType c = 0; c <= r; ++c) {
+        ScalarType sum = covariance[r * sdim + c];
+        for (SizeType k = 0; k < c; ++k) {
+          sum -= l[r * sdim + k] * l[c * sdim + k];
+        }
+        if (r == c) {
+          assert(sum > ScalarType(0.0));
+          l[r * sdim + r] = std::sqrt(sum);
+        } else {
+          l[r * sdim + c] = sum / l[c * sdim + c];
+        }
+      }
+    }
+    return l;
+  }
+
+  //! \brief Stores L^-1 \p x in \p y by forward substitution.
+  inline void Whiten(ScalarType const* x, ScalarType* y) const {
+    SizeType const n = sdim();
+    for (SizeType r = 0; r < n; ++r) {
+      ScalarType sum = x[r];
+      for (SizeType c = 0; c < r; ++c) {
+        sum -= cholesky_[r * n + c] * y[c];
+      }
+      y[r] = sum / cholesky_[r * n + r];
+    }
+  }
+
+  //! \brief Cholesky factor of the covariance matrix in row-major order.
+  std::vector<ScalarType> cholesky_;
+  internal::MatrixSpace<ScalarType, Dim_> points_;
+};
+
+template <typename Scalar_, Size Dim_>
+struct SpaceTraits<WhitenedSpace<Scalar_, Dim_>> {
+  using SpaceType = WhitenedSpace<Scalar_, Dim_>;
+  using PointType = PointMap<typename SpaceType::ScalarType const, Dim_>;
+  using ScalarType = typename SpaceType::ScalarType;
+  using SizeType = typename SpaceType::SizeType;
+  static SizeType constexpr Dim = SpaceType::Dim;
+
+  template <typename Index_>
+  inline static PointType PointAt(SpaceType const& space, Index_ idx) {
+    return space[static_cast<SizeType>(idx)];
+  }
+
+  inline static SizeType size(SpaceType const& space) { return space.size(); }
+
+  inline static SizeType sdim(SpaceType const& space) { return space.sdim(); }
+};
+
+}  // namespace pico_tree
@@ -0,0 +1,217 @@
+#pragma once
+
+#include "pico_tree/internal/kd_tree_builder.hpp"
+#include "pico_tree/internal/point_wrapper.hpp"
+#include "pico_tree/internal/search_visitor.hpp"
+#include "pico_tree/internal/space_wrapper.hpp"
+#include "pico_tree/metric.hpp"
+#include "pico_understory/internal/wide_kd_tree_data.hpp"
+#include "pico_understory/internal/wide_kd_tree_search.hpp"
+
+namespace pico_tree {
+
+//! \brief A WideKdTree is a KdTree of which each node has \p Ways_ children.
+//! \details The WideKdTree is built like a KdTree, after which every
+//! log2(Ways_) levels of the binary tree are collapsed into a single node. The
+//! split planes of a node are stored together, such that a descent costs a
+//! single dependent load per log2(Ways_) levels instead of one per level. The
+//! search visits points in the same order as that of a KdTree.
+//! <p/>
+//! Only Euclidean spaces are supported.
+//! \tparam Space_ Type of space.
+//! \tparam Metric_ Type of metric. Determines how distances are measured.
+//! \tparam SplittingRule_ The rule that determines how space is partitioned.
+//! \tparam Index_ Type of index.
+//! \tparam Ways_ Number of children of a node. It should be a power of two.
+template <
+    typename Space_,
+    typename Metric_ = L2Squared,
+    SplittingRule SplittingRule_ = SplittingRule::kSlidingMidpoint,
+    typename Index_ = int,
+    Size Ways_ = 4>
+class WideKdTree {
+  static_assert(
+      std::is_same_v<typename Metric_::SpaceTag, EuclideanSpaceTag>,
+      "METRIC_SPACE_TAG_NOT_EUCLIDEAN");
+
+  using SpaceWrapperType = internal::SpaceWrapper<Space_>;
+  using BuildKdTreeType = internal::BuildKdTree<
+      internal::KdTreeNodeEuclidean<
+          Index_,
+          typename SpaceWrapperType::ScalarType>,
+      SpaceWrapperType::Dim,
+      SplittingRule_>;
+  using KdTreeDataType = internal::WideKdTreeData<
+      Index_,
+      typename SpaceWrapperType::ScalarType,
+      SpaceWrapperType::Dim,
+      Ways_>;
+  using NodeType = typename KdTreeDataType::NodeType;
+
+ public:
+  //! \brief Size type.
+  using SizeType = Size;
+  //! \brief Index type.
+  using IndexType = Index_;
+  //! \brief Scalar type.
+  using ScalarType = typename SpaceWrapperType::ScalarType;
+  //! \brief WideKdTree dimension. It equals pico_tree::kDynamicSize in case
+  //! Dim is only known at run-time.
+  static SizeType constexpr Dim = SpaceWrapperType::Dim;
+  //! \brief Point set or adaptor type.
+  using SpaceType = Space_;
+  //! \brief The metric used for various searches.
+  using MetricType = Metric_;
+  //! \brief Distance type.
+  using DistanceType = internal::MetricDistanceType<Metric_, ScalarType>;
+  //! \brief Neighbor type of various search resuls.
+  using NeighborType = Neighbor<IndexType, DistanceType>;
+
+  //! \brief Number of children of a node.
+  static SizeType constexpr kWays = Ways_;
+
+  //! \brief Creates a WideKdTree given \p space and \p max_leaf_size. The
+  //! indices and nodes of the tree are allocated from \p resource.
+  //! \see KdTree::KdTree
+  WideKdTree(
+      SpaceType space,
+      SizeType max_leaf_size,
+      SplittingRuleOptions const& options = SplittingRuleOptions(),
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : space_(std::move(space)),
+        metric_(),
+        data_(KdTreeDataType::FromKdTreeData(BuildKdTreeType()(
+            SpaceWrapperType(space_), max_leaf_size, options, resource))) {}
+
+  //! \brief The WideKdTree cannot be copied.
+  //! \details The WideKdTree uses pointers to nodes and copying pointers is
+  //! not the same as creating a deep copy.
+  WideKdTree(WideKdTree const&) = delete;
+
+  //! \brief Move constructor of the WideKdTree.
+  WideKdTree(WideKdTree&&) = default;
+
+  //! \brief WideKdTree copy assignment.
+  WideKdTree& operator=(WideKdTree const& other) = delete;
+
+  //! \brief WideKdTree move assignment.
+  WideKdTree& operator=(WideKdTree&& other) = default;
+
+  //! \brief Returns the nearest neighbor (or neighbors) of point \p x depending
+  //! on their selection by visitor \p visitor .
+  template <typename P, typename V>
+  inline void SearchNearest(P const& x, V& visitor) const {
+    internal::PointWrapper<P, Dim> p(x);
+    internal::SearchNearestWide<
+        SpaceWrapperType,
+        Metric_,
+        internal::PointWrapper<P, Dim>,
+        V,
+        NodeType>(SpaceWrapperType(space_), metric_, data_.indices, p, visitor)(
+        data_.root_node);
+  }
+
+  //! \brief Searches for the nearest neighbor of point \p x.
+  //! \see KdTree::SearchNn
+  template <typename P>
+  inline void SearchNn(P const& x, NeighborType& nn) const {
+    internal::SearchNn<NeighborType> v(nn);
+    SearchNearest(x, v);
+  }
+
+  //! \brief Searches for the approximate nearest neighbor of point \p x.
+  //! \see KdTree::SearchNn
+  template <typename P>
+  inline void SearchNn(
+      P const& x, DistanceType const e, NeighborType& nn) const {
+    internal::SearchApproximateNn<NeighborType> v(e, nn);
+    SearchNearest(x, v);
+  }
+
+  //! \brief Searches for the \p k nearest neighbors of point \p x and stores
+  //! the results in output vector \p knn.
+  //! \see KdTree::SearchKnn
+  template <typename P>
+  inline void SearchKnn(
+      P const& x, SizeType const k, std::vector<NeighborType>& knn) const {
+    knn.resize(std::min(k, SpaceWrapperType(space_).size()));
+    internal::SearchKnn<typename std::vector<NeighborType>::iterator> v(
+        knn.begin(), knn.end());
+    SearchNearest(x, v);
+  }
+
+  //! \brief Searches for the \p k approximate nearest neighbors of point \p x
+  //! and stores the results in output vector \p knn.
+  //! \see KdTree::SearchKnn
+  template <typename P>
+  inline void SearchKnn(
+      P const& x,
+      SizeType const k,
+      DistanceType const e,
+      std::vector<NeighborType>& knn) const {
+    knn.resize(std::min(k, SpaceWrapperType(space_).size()));
+    internal::SearchApproximateKnn<typename std::vector<NeighborType>::iterator>
+        v(e, knn.begin(), knn.end());
+    SearchNearest(x, v);
+  }
+
+  //! \brief Searches for all the neighbors of point \p x that are within radius
+  //! \p radius and stores the results in output vector \p n.
+  //! \see KdTree::SearchRadius
+  template <typename P>
+  inline void SearchRadius(
+      P const& x,
+      DistanceType const radius,
+      std::vector<NeighborType>& n,
+      bool const sort = false) const {
+    internal::SearchRadius<NeighborType> v(radius, n);
+    SearchNearest(x, v);
+
+    if (sort) {
+      v.Sort();
+    }
+  }
+
+  //! \brief Searches for all approximate neighbors of point \p x that are
+  //! within radius \p radius and stores the results in output vector \p n.
+  //! \see KdTree::SearchRadius
+  template <typename P>
+  inline void SearchRadius(
+      P const& x,
+      DistanceType const radius,
+      DistanceType const e,
+      std::vector<NeighborType>& n,
+      bool const sort = false) const {
+    internal::SearchApproximateRadius<NeighborType> v(e, radius, n);
+    SearchNearest(x, v);
+
+    if (sort) {
+      v.Sort();
+    }
+  }
+
+  //! \brief Point set used by the tree.
+  inline SpaceType const& points() const { return space_; }
+
+  //! \brief Metric used for search queries.
+  inline MetricType const& metric() const { return metric_; }
+
+  //! \brief Returns the memory resource of the indices and nodes.
+  inline std::pmr::memory_resource* resource() const {
+    return data_.allocator.resource();
+  }
+
+ private:
+  //! \brief Point set used for querying point data.
+  SpaceType space_;
+  //! \brief Metric used for comparing distances.
+  MetricType metric_;
+  //! \brief Data structure of the WideKdTree.
+  KdTreeDataType data_;
+};
+
+template <typename Space_>
+WideKdTree(Space_, Size)
+    -> WideKdTree<Space_, L2Squared, SplittingRule::kSlidingMidpoint, int, 4>;
+
+}  // namespace pico_tree
@@ -5,7 +5,10 @@
 //! \file core.hpp
 //! \brief Contains various common utilities.
 
+#include <chrono>
+#include <limits>
 #include <type_traits>
+#include <vector>
 
 namespace pico_tree {
 
@@ -53,4 +56,72 @@ constexpr bool operator<(
   return lhs.distance < rhs.distance;
 }
 
+//! \brief A NeighborList stores the neighbors of each point of a point set in
+//! compressed sparse row (CSR) format.
+//! \details The neighbors of point i are stored at positions [offsets[i],
+//! offsets[i + 1]) of indices and distances. The list uses three allocations,
+//! of which the sizes are known once the number of neighbors is known.
+template <typename Index_, typename Scalar_>
+struct NeighborList {
+  //! \brief Index type.
+  using IndexType = Index_;
+  //! \brief Distance type.
+  using ScalarType = Scalar_;
+
+  //! \brief Returns the number of points.
+  inline Size size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+  //! \brief Begin of the neighbors of each point, followed by the total number
+  //! of neighbors.
+  std::vector<Size> offsets;
+  //! \brief Point indices of the neighbors.
+  std::vector<IndexType> indices;
+  //! \brief Distances of the neighbors with respect to their point.
+  std::vector<ScalarType> distances;
+};
+
+//! \brief NodeSummaries stores a summary of the points of each node of a
+//! KdTree, such as the set of labels of those points.
+//! \details The summaries are stored in depth-first pre-order: the left child
+//! of the node at position i is stored at position i + 1 and its right child
+//! at position right[i]. They are created using KdTree::Summarize() and are
+//! only valid for the tree that created them.
+template <typename Summary_>
+struct NodeSummaries {
+  //! \brief Summary type.
+  using SummaryType = Summary_;
+
+  //! \brief Summary of each node.
+  std::vector<SummaryType> summaries;
+  //! \brief Position of the right child of each node. It is zero for a leaf.
+  std::vector<Size> right;
+};
+
+//! \brief Limits the number of leaf nodes that a best bin first search is
+//! allowed to visit.
+//! \details The limit has a type of its own such that it can't be mistaken for
+//! the error ratio of an approximate search, which may also be an integer.
+//! \code{.cpp}
+//! tree.SearchKnn(p, k, MaxLeavesVisited{16}, knn);
+//! \endcode
+struct MaxLeavesVisited {
+  //! \brief Maximum number of leaf nodes that may be visited.
+  Size value = std::numeric_limits<Size>::max();
+};
+
+//! \brief Limits the amount of work a nearest neighbor search is allowed to
+//! do. A search that runs out of budget returns the best result found so far.
+//! \details Both limits are unbounded by default. The deadline is compared
+//! against the current time once every few distance evaluations, so a search
+//! may run slightly past it.
+struct SearchBudget {
+  //! \brief Clock used for the deadline.
+  using ClockType = std::chrono::steady_clock;
+
+  //! \brief Maximum number of distances that may be calculated.
+  Size max_distance_evaluations = std::numeric_limits<Size>::max();
+  //! \brief Point in time after which no more distances are calculated.
+  ClockType::time_point deadline = ClockType::time_point::max();
+};
+
 }  // namespace pico_tree
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <limits>
+#include <memory_resource>
 #include <vector>
 
 #include "pico_tree/core.hpp"
@@ -75,14 +77,12 @@ class BoxBase {
 
   //! \brief Updates the min and/or max vectors of this box so that it can fit
   //! input point \p x.
+  //! \details The loop has no branches such that it is fully unrolled into
+  //! min and max instructions when the dimension is known at compile-time.
   constexpr void Fit(ScalarType const* x) {
     for (SizeType i = 0; i < derived().size(); ++i) {
-      if (x[i] < min(i)) {
-        min(i) = x[i];
-      }
-      if (x[i] > max(i)) {
-        max(i) = x[i];
-      }
+      min(i) = std::min(min(i), x[i]);
+      max(i) = std::max(max(i), x[i]);
     }
   }
 
@@ -91,13 +91,8 @@ class BoxBase {
   template <typename OtherDerived>
   constexpr void Fit(BoxBase<OtherDerived> const& x) {
     for (SizeType i = 0; i < derived().size(); ++i) {
-      if (x.min(i) < min(i)) {
-        min(i) = x.min(i);
-      }
-
-      if (x.max(i) > max(i)) {
-        max(i) = x.max(i);
-      }
+      min(i) = std::min(min(i), x.min(i));
+      max(i) = std::max(max(i), x.max(i));
     }
   }
 
@@ -152,7 +147,7 @@ struct BoxStorage<Scalar_, kDynamicSize> {
   constexpr Scalar_ const* max() const noexcept { return coords.data() + size; }
   constexpr Scalar_* max() noexcept { return coords.data() + size; }
 
-  std::vector<Scalar_> coords;
+  std::pmr::vector<Scalar_> coords;
   Size size;
 };
 
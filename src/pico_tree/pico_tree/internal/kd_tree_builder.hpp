@@ -1,8 +1,16 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory_resource>
 #include <numeric>
+#include <random>
+#include <type_traits>
 #include <vector>
 
 #include "pico_tree/internal/box.hpp"
@@ -17,7 +25,8 @@ enum class SplittingRule {
   //! box longest side. This rule is also known as the standard split rule.
   //! \details This rule builds a tree in O(n log n) time on average. It's
   //! generally slower compared to kSlidingMidpoint but results in a
-  //! balanced KdTree.
+  //! balanced KdTree. For integral and floating point coordinates the median
+  //! is selected using a radix select.
   kLongestMedian,
   //! \brief Splits a node's box halfway the dimension of its longest side. The
   //! first dimension is chosen if multiple sides share being the longest. This
@@ -41,11 +50,306 @@ enum class SplittingRule {
   //! The tree is build in O(n log n) time and results in a tree that is both
   //! faster to build and generally faster to query as compared to
   //! kLongestMedian.
-  kSlidingMidpoint
+  kSlidingMidpoint,
+  //! \brief Splits a node where the expected cost of a nearest neighbor query
+  //! is lowest. It is the KdTree equivalent of the Surface Area Heuristic
+  //! (SAH) used to build bounding volume hierarchies.
+  //! \details The probability that the search ball of a query reaches a node
+  //! is modeled by the volume of the node's box grown by the diameter of the
+  //! ball. The cost of a node is that probability times its number of points.
+  //! Grown volumes are dominated by their surface areas when the ball is small
+  //! and by their volumes when it is large. The ball's diameter is estimated by
+  //! the average spacing between the points of the node being split.
+  //!
+  //! Candidate splits are the boundaries of a fixed number of equally sized
+  //! bins along each dimension. Compared to kSlidingMidpoint, this rule adapts
+  //! better to point sets with large variations in density, such as LiDAR
+  //! scans with a dense ground plane. Building takes O(n d log n) time.
+  //!
+  //! The rule pays off when queries are as dense as the points they search,
+  //! such as queries taken from the scan itself. For 2 million LiDAR-like
+  //! points and queries on the ground plane, knn queries were about 20% faster
+  //! than with kSlidingMidpoint, for a build that was about 2.7 times slower.
+  //! Queries that are far away from the points, such as those hovering above
+  //! the ground, were about 25% slower. Weighting the cost of a split by
+  //! sample queries instead of a uniform distribution made queries slower
+  //! still, so kSlidingMidpoint remains the default.
+  kSurfaceAreaHeuristic,
+  //! \brief Splits a node at the mean of the dimension with the largest
+  //! variance. The mean and variance are estimated from a small sample of the
+  //! node's points.
+  //! \details The longest side of a node's box is decided by its most extreme
+  //! points. For high dimensional data, such as image or feature descriptors,
+  //! the dimension with the largest variance often separates the bulk of the
+  //! points much better. This is the splitting rule used by the randomized
+  //! kd-trees of FLANN. Empty sub-nodes are avoided as for kSlidingMidpoint.
+  kMaxVariance,
+  //! \brief Splits a node at the median of the dimension with the largest
+  //! spread. The spread and median are estimated from a small sample of the
+  //! node's points.
+  //! \details Unlike kLongestMedian, no partial sort of all points is
+  //! required and outliers that happen to lie outside the sample do not
+  //! influence the choice of dimension. Empty sub-nodes are avoided as for
+  //! kSlidingMidpoint.
+  kMaxSpreadSample,
+  //! \brief Splits a node's box along its longest side at the median of a
+  //! small random sample of the node's points.
+  //! \details Only partitioning the points of a node visits all of them. This
+  //! makes it the fastest rule to build a tree with, at the cost of less
+  //! balanced trees. It is meant for trees that are built often and queried
+  //! little, such as a tree per frame of a sensor. The size of the sample is
+  //! set by SplittingRuleOptions::sample_size. Empty sub-nodes are avoided as
+  //! for kSlidingMidpoint.
+  kSampledMedian,
+  //! \brief Builds a KdTree from the Morton codes of its points, similar to
+  //! how a linear bounding volume hierarchy (LBVH) is built.
+  //! \details The points are quantized to a grid of cubic cells and sorted by
+  //! the Morton (Z-order) code of their cell using a radix sort. Each node
+  //! splits where the highest bit in which the codes of its points differ
+  //! changes from 0 to 1. That bit corresponds to a plane halfway the node's
+  //! cell and the dimensions are cycled through per level. The boxes of the
+  //! nodes are fitted to their points afterwards, as for the other rules.
+  //!
+  //! Apart from sorting, building takes linear time and it is the fastest of
+  //! all rules. The sort runs in parallel when compiled with OpenMP. Each split
+  //! halves the smallest grid aligned cube that contains the points of a node.
+  //! It resembles kMidpoint without the empty nodes, but it can't adapt the
+  //! split dimension to the shape of the points. Only the first 64 dimensions
+  //! are encoded. Points that share a code are split at their median along the
+  //! longest side of their bounding box.
+  kMorton
+};
+
+//! \brief Tunable parameters of the splitting rules. Rules ignore the
+//! parameters that don't apply to them.
+struct SplittingRuleOptions {
+  //! \brief The number of points sampled per node by
+  //! SplittingRule::kSampledMedian. Larger samples result in better balanced
+  //! trees but take longer to build.
+  Size sample_size = 15;
 };
 
 namespace internal {
 
+//! \brief Partitions the indices in the range [ \p begin, \p end ) such that
+//! those of points with a coordinate smaller than \p split_val in dimension \p
+//! split_dim come first. The partition point is stored in \p split.
+//! \details If it happens that either all points are on the left side or right
+//! side, one point slides to the other side and we split on the first right
+//! value instead of \p split_val. In these two cases the split value is
+//! unknown and a partial sort is required to obtain it, but also to rearrange
+//! all other indices such that they are on their corresponding left or right
+//! side.
+template <typename SpaceWrapper_, typename RandomAccessIterator_>
+inline void PartitionSliding(
+    SpaceWrapper_ const& space,
+    RandomAccessIterator_ begin,
+    RandomAccessIterator_ end,
+    Size const split_dim,
+    RandomAccessIterator_& split,
+    typename SpaceWrapper_::ScalarType& split_val) {
+  // Everything smaller than split_val goes left, the rest right.
+  auto const comp = [&space, &split_dim, &split_val](auto const index) -> bool {
+    return space[index][split_dim] < split_val;
+  };
+
+  split = std::partition(begin, end, comp);
+
+  auto const less = [&space, &split_dim](
+                        auto const index_a, auto const index_b) -> bool {
+    return space[index_a][split_dim] < space[index_b][split_dim];
+  };
+
+  if (split == end) {
+    split--;
+    std::nth_element(begin, split, end, less);
+    split_val = space[*split][split_dim];
+  } else if (split == begin) {
+    split++;
+    std::nth_element(begin, split, end, less);
+    split_val = space[*split][split_dim];
+  }
+}
+
+//! \brief True if ToRadixKey() supports scalar type \p Scalar_.
+template <typename Scalar_>
+inline constexpr bool kHasRadixKey =
+    (std::is_integral_v<Scalar_> && !std::is_same_v<Scalar_, bool>) ||
+    (std::is_floating_point_v<Scalar_> &&
+     std::numeric_limits<Scalar_>::is_iec559 &&
+     (sizeof(Scalar_) == 4 || sizeof(Scalar_) == 8));
+
+//! \brief Maps a scalar to an unsigned integer such that the order of the
+//! integers equals that of the scalars.
+//! \details For floating point values the sign bit is flipped for positive
+//! values and all bits are flipped for negative ones. Adding zero turns -0
+//! into +0 such that both map to the same key.
+template <typename Scalar_>
+inline auto ToRadixKey(Scalar_ const x) {
+  if constexpr (std::is_floating_point_v<Scalar_>) {
+    static_assert(
+        kHasRadixKey<Scalar_>, "SCALAR_TYPE_NOT_SUPPORTED_BY_RADIX_SELECT");
+    using KeyType = std::
+        conditional_t<sizeof(Scalar_) == 4, std::uint32_t, std::uint64_t>;
+    KeyType constexpr kSignBit = KeyType(1) << (sizeof(KeyType) * 8 - 1);
+    KeyType key;
+    Scalar_ const y = x + Scalar_(0);
+    std::memcpy(&key, &y, sizeof(KeyType));
+    return (key & kSignBit) ? static_cast<KeyType>(~key) : (key | kSignBit);
+  } else {
+    using KeyType = std::make_unsigned_t<Scalar_>;
+    if constexpr (std::is_signed_v<Scalar_>) {
+      KeyType constexpr kSignBit = KeyType(1) << (sizeof(KeyType) * 8 - 1);
+      return static_cast<KeyType>(static_cast<KeyType>(x) ^ kSignBit);
+    } else {
+      return static_cast<KeyType>(x);
+    }
+  }
+}
+
+//! \brief Selects the nth point along a dimension using std::nth_element.
+//! \see RadixSelect
+template <typename SpaceWrapper_>
+class NthElementSelect {
+ public:
+  explicit NthElementSelect(SpaceWrapper_ space) : space_{space} {}
+
+  template <typename RandomAccessIterator_>
+  inline void operator()(
+      RandomAccessIterator_ begin,
+      RandomAccessIterator_ nth,
+      RandomAccessIterator_ end,
+      Size const dim) const {
+    std::nth_element(
+        begin,
+        nth,
+        end,
+        [this, &dim](auto const index_a, auto const index_b) -> bool {
+          return space_[index_a][dim] < space_[index_b][dim];
+        });
+  }
+
+  //! \brief Returns the size in bytes of the scratch memory. There is none.
+  inline Size memory_usage() const { return 0; }
+
+ private:
+  SpaceWrapper_ space_;
+};
+
+//! \brief Rearranges the indices in the range [ \p begin, \p end ) such that
+//! the one at \p nth is the index of the point that would be there if the
+//! range was sorted by the coordinates of dimension \p dim. All indices of
+//! points with a smaller coordinate come before it and those with a larger
+//! one after it.
+//! \details This is the equivalent of std::nth_element, implemented as a most
+//! significant digit radix select. The coordinates are gathered once into a
+//! contiguous buffer of keys, which avoids the random memory access of
+//! comparing points through their indices at each step of std::nth_element.
+//! Each pass over the buffer is branch free and it shrinks to the keys that
+//! share the digits of the selected one.
+template <typename SpaceWrapper_>
+class RadixSelect {
+  using ScalarType = typename SpaceWrapper_::ScalarType;
+  using KeyType = decltype(ToRadixKey(std::declval<ScalarType>()));
+
+ public:
+  explicit RadixSelect(SpaceWrapper_ space) : space_{space} {}
+
+  template <typename RandomAccessIterator_>
+  inline void operator()(
+      RandomAccessIterator_ begin,
+      RandomAccessIterator_ nth,
+      RandomAccessIterator_ end,
+      Size const dim) const {
+    auto const count = static_cast<Size>(end - begin);
+    // The histograms and gather pass don't pay off for small ranges.
+    if (count < kMinCount) {
+      NthElementSelect<SpaceWrapper_>{space_}(begin, nth, end, dim);
+      return;
+    }
+
+    point_keys_.resize(count);
+    keys_.resize(count);
+    for (Size i = 0; i < count; ++i) {
+      KeyType const key =
+          ToRadixKey(space_[begin[static_cast<std::ptrdiff_t>(i)]][dim]);
+      point_keys_[i] = key;
+      keys_[i] = key;
+    }
+
+    // The key of the nth point is determined one digit at a time.
+    Size rank = static_cast<Size>(nth - begin);
+    Size remaining = count;
+    KeyType nth_key = 0;
+    std::array<Size, kRadix> histogram;
+    for (int shift = kKeyBits - kDigitBits; shift >= 0;
+         shift -= kDigitBits) {
+      histogram.fill(0);
+      for (Size i = 0; i < remaining; ++i) {
+        ++histogram[Digit(keys_[i], shift)];
+      }
+
+      Size digit = 0;
+      while (rank >= histogram[digit]) {
+        rank -= histogram[digit];
+        ++digit;
+      }
+      nth_key |= static_cast<KeyType>(static_cast<KeyType>(digit) << shift);
+
+      if (histogram[digit] == remaining) {
+        continue;
+      }
+      Size selected = 0;
+      for (Size i = 0; i < remaining; ++i) {
+        keys_[selected] = keys_[i];
+        selected += Digit(keys_[i], shift) == digit;
+      }
+      remaining = selected;
+    }
+
+    // Three-way partition of the indices around the nth key. The keys of the
+    // points are swapped along with their indices.
+    Size less = 0;
+    Size i = 0;
+    Size greater = count;
+    while (i < greater) {
+      if (point_keys_[i] < nth_key) {
+        std::swap(point_keys_[i], point_keys_[less]);
+        std::iter_swap(begin + i, begin + less);
+        ++less;
+        ++i;
+      } else if (point_keys_[i] > nth_key) {
+        --greater;
+        std::swap(point_keys_[i], point_keys_[greater]);
+        std::iter_swap(begin + i, begin + greater);
+      } else {
+        ++i;
+      }
+    }
+  }
+
+  //! \brief Returns the size in bytes of the scratch memory. It is the largest
+  //! range selected from so far.
+  inline Size memory_usage() const {
+    return (point_keys_.capacity() + keys_.capacity()) * sizeof(KeyType);
+  }
+
+ private:
+  static Size constexpr kMinCount = 4096;
+  static int constexpr kDigitBits = 8;
+  static Size constexpr kRadix = Size(1) << kDigitBits;
+  static int constexpr kKeyBits = static_cast<int>(sizeof(KeyType) * 8);
+
+  static inline Size Digit(KeyType const key, int const shift) {
+    return static_cast<Size>(key >> shift) & (kRadix - 1);
+  }
+
+  SpaceWrapper_ space_;
+  // Buffers are reused between calls to avoid an allocation per node.
+  mutable std::vector<KeyType> point_keys_;
+  mutable std::vector<KeyType> keys_;
+};
+
 //! \copydoc SplittingRule::kLongestMedian
 template <typename SpaceWrapper_>
 class SplitterLongestMedian {
@@ -54,7 +358,7 @@ class SplitterLongestMedian {
   using BoxType = Box<ScalarType, SpaceWrapper_::Dim>;
 
  public:
-  SplitterLongestMedian(SpaceWrapper_ space) : space_{space} {}
+  SplitterLongestMedian(SpaceWrapper_ space) : space_{space}, select_{space} {}
 
   template <typename RandomAccessIterator_>
   inline void operator()(
@@ -71,19 +375,22 @@ class SplitterLongestMedian {
 
     split = begin + (end - begin) / 2;
 
-    std::nth_element(
-        begin,
-        split,
-        end,
-        [this, &split_dim](auto const index_a, auto const index_b) -> bool {
-          return space_[index_a][split_dim] < space_[index_b][split_dim];
-        });
-
+    select_(begin, split, end, split_dim);
     split_val = space_[*split][split_dim];
   }
 
+  //! \brief Returns the size in bytes of the scratch memory.
+  inline SizeType memory_usage() const { return select_.memory_usage(); }
+
  private:
+  // Scalar types without a radix key fall back to std::nth_element.
+  using SelectType = std::conditional_t<
+      kHasRadixKey<ScalarType>,
+      RadixSelect<SpaceWrapper_>,
+      NthElementSelect<SpaceWrapper_>>;
+
   SpaceWrapper_ space_;
+  SelectType select_;
 };
 
 //! \copydoc SplittingRule::kMidpoint
@@ -108,7 +415,7 @@ class SplitterMidpoint {
       ScalarType& split_val) const {
     ScalarType max_delta;
     box.LongestAxis(split_dim, max_delta);
-    split_val = max_delta * ScalarType(0.5) + box.min(split_dim);
+    split_val = max_delta / ScalarType(2.0) + box.min(split_dim);
 
     // Everything smaller than split_val goes left, the rest right.
     auto const comp = [this, &split_dim, &split_val](auto const index) -> bool {
@@ -146,44 +453,314 @@ class SplitterSlidingMidpoint {
     box.LongestAxis(split_dim, max_delta);
     split_val = max_delta / ScalarType(2.0) + box.min(split_dim);
 
-    // Everything smaller than split_val goes left, the rest right.
-    auto const comp = [this, &split_dim, &split_val](auto const index) -> bool {
-      return space_[index][split_dim] < split_val;
-    };
+    PartitionSliding(space_, begin, end, split_dim, split, split_val);
+  }
 
-    split = std::partition(begin, end, comp);
+ private:
+  SpaceWrapper_ space_;
+};
+
+//! \copydoc SplittingRule::kSurfaceAreaHeuristic
+template <typename SpaceWrapper_>
+class SplitterSurfaceAreaHeuristic {
+  using ScalarType = typename SpaceWrapper_::ScalarType;
+  using SizeType = Size;
+  using BoxType = Box<ScalarType, SpaceWrapper_::Dim>;
+
+ public:
+  SplitterSurfaceAreaHeuristic(SpaceWrapper_ space) : space_{space} {}
+
+  template <typename RandomAccessIterator_>
+  inline void operator()(
+      typename std::iterator_traits<
+          RandomAccessIterator_>::value_type const,  // depth
+      RandomAccessIterator_ begin,
+      RandomAccessIterator_ end,
+      BoxType const& box,
+      RandomAccessIterator_& split,
+      SizeType& split_dim,
+      ScalarType& split_val) const {
+    auto const count = static_cast<double>(end - begin);
+
+    // The average spacing between points is the side of the cube that has the
+    // volume of the box divided by the number of points. Flat sides are
+    // ignored.
+    double log_volume = 0.0;
+    SizeType sdim_non_flat = 0;
+    for (SizeType i = 0; i < space_.sdim(); ++i) {
+      double const side = static_cast<double>(box.max(i) - box.min(i));
+      if (side > 0.0) {
+        log_volume += std::log(side);
+        ++sdim_non_flat;
+      }
+    }
+
+    double best_cost = std::numeric_limits<double>::max();
+    double const spacing =
+        sdim_non_flat > 0
+            ? std::exp(
+                  (log_volume - std::log(count)) /
+                  static_cast<double>(sdim_non_flat))
+            : 0.0;
+
+    std::array<SizeType, kBinCount> bins;
+    for (SizeType i = 0; i < space_.sdim(); ++i) {
+      double const side = static_cast<double>(box.max(i) - box.min(i));
+      if (!(side > 0.0)) {
+        continue;
+      }
+
+      bins.fill(0);
+      double const bins_per_unit = static_cast<double>(kBinCount) / side;
+      for (auto it = begin; it < end; ++it) {
+        double const offset =
+            static_cast<double>(space_[*it][i] - box.min(i)) * bins_per_unit;
+        ++bins[std::min(
+            static_cast<SizeType>(std::max(offset, 0.0)), kBinCount - 1)];
+      }
+
+      // The volumes of the grown boxes of the parent and both children only
+      // differ in dimension i. The other dimensions are a shared factor that
+      // is divided out.
+      double count_left = 0.0;
+      for (SizeType b = 1; b < kBinCount; ++b) {
+        count_left += static_cast<double>(bins[b - 1]);
+        double const count_right = count - count_left;
+        if (count_left == 0.0 || count_right == 0.0) {
+          continue;
+        }
+
+        double const side_left =
+            side * static_cast<double>(b) / static_cast<double>(kBinCount);
+        double const cost = (count_left * (side_left + spacing) +
+                             count_right * (side - side_left + spacing)) /
+                            (side + spacing);
+
+        if (cost < best_cost) {
+          best_cost = cost;
+          split_dim = i;
+          split_val = static_cast<ScalarType>(
+              static_cast<double>(box.min(i)) + side_left);
+        }
+      }
+    }
+
+    // All points fell into a single bin for each dimension. This only happens
+    // for a few extreme outliers. Splitting halfway the longest side isolates
+    // them.
+    if (best_cost == std::numeric_limits<double>::max()) {
+      ScalarType max_delta;
+      box.LongestAxis(split_dim, max_delta);
+      split_val = max_delta / ScalarType(2.0) + box.min(split_dim);
+    }
+
+    // Rounding of the split value may still result in an empty side.
+    PartitionSliding(space_, begin, end, split_dim, split, split_val);
+  }
+
+ private:
+  //! \brief The number of candidate splits per dimension equals kBinCount - 1.
+  static SizeType constexpr kBinCount = 32;
+
+  SpaceWrapper_ space_;
+};
+
+//! \brief Calls \p f for a sample of at most \p sample_size indices that are
+//! spread evenly over the range [ \p begin, \p end ).
+template <typename RandomAccessIterator_, typename UnaryFunction_>
+inline void ForEachSample(
+    RandomAccessIterator_ begin,
+    RandomAccessIterator_ end,
+    Size const sample_size,
+    UnaryFunction_ f) {
+  auto const count = static_cast<Size>(end - begin);
+  Size const sample_count = std::min(count, sample_size);
+  Size const stride = count / sample_count;
+  for (Size i = 0; i < sample_count; ++i) {
+    f(begin[static_cast<std::ptrdiff_t>(i * stride)]);
+  }
+}
+
+//! \copydoc SplittingRule::kMaxVariance
+template <typename SpaceWrapper_>
+class SplitterMaxVariance {
+  using ScalarType = typename SpaceWrapper_::ScalarType;
+  using SizeType = Size;
+  using BoxType = Box<ScalarType, SpaceWrapper_::Dim>;
+
+ public:
+  SplitterMaxVariance(SpaceWrapper_ space)
+      : space_{space}, sum_(space_.sdim()), sum_squared_(space_.sdim()) {}
+
+  template <typename RandomAccessIterator_>
+  inline void operator()(
+      typename std::iterator_traits<
+          RandomAccessIterator_>::value_type const,  // depth
+      RandomAccessIterator_ begin,
+      RandomAccessIterator_ end,
+      BoxType const& box,
+      RandomAccessIterator_& split,
+      SizeType& split_dim,
+      ScalarType& split_val) const {
+    // Sums are accumulated in double. Integral coordinates would overflow and
+    // float loses too much precision when the mean is large.
+    std::fill(sum_.begin(), sum_.end(), 0.0);
+    std::fill(sum_squared_.begin(), sum_squared_.end(), 0.0);
+    double count = 0.0;
+    ForEachSample(begin, end, kSampleSize, [this, &count](auto const index) {
+      auto const p = space_[index];
+      for (SizeType i = 0; i < space_.sdim(); ++i) {
+        double const v = static_cast<double>(p[i]);
+        sum_[i] += v;
+        sum_squared_[i] += v * v;
+      }
+      count += 1.0;
+    });
+
+    double max_variance = 0.0;
+    for (SizeType i = 0; i < space_.sdim(); ++i) {
+      double const mean = sum_[i] / count;
+      double const variance = sum_squared_[i] / count - mean * mean;
+      if (variance > max_variance) {
+        max_variance = variance;
+        split_dim = i;
+        split_val = static_cast<ScalarType>(mean);
+      }
+    }
+
+    // All sampled points are equal. The points outside the sample may still
+    // differ.
+    if (!(max_variance > 0.0)) {
+      ScalarType max_delta;
+      box.LongestAxis(split_dim, max_delta);
+      split_val = max_delta / ScalarType(2.0) + box.min(split_dim);
+    }
+
+    PartitionSliding(space_, begin, end, split_dim, split, split_val);
+  }
+
+ private:
+  //! \brief The maximum number of points used to estimate the variance.
+  static SizeType constexpr kSampleSize = 100;
+
+  SpaceWrapper_ space_;
+  // The sums are reused to avoid an allocation per node.
+  mutable std::vector<double> sum_;
+  mutable std::vector<double> sum_squared_;
+};
+
+//! \copydoc SplittingRule::kMaxSpreadSample
+template <typename SpaceWrapper_>
+class SplitterMaxSpreadSample {
+  using ScalarType = typename SpaceWrapper_::ScalarType;
+  using SizeType = Size;
+  using BoxType = Box<ScalarType, SpaceWrapper_::Dim>;
+
+ public:
+  SplitterMaxSpreadSample(SpaceWrapper_ space)
+      : space_{space}, sample_box_(space_.sdim()) {
+    values_.reserve(kSampleSize);
+  }
 
-    // If it happens that either all points are on the left side or right
-    // side, one point slides to the other side and we split on the first
-    // right value instead of the middle split. In these two cases the split
-    // value is unknown and a partial sort is required to obtain it, but also
-    // to rearrange all other indices such that they are on their
-    // corresponding left or right side.
-    if (split == end) {
-      split--;
-      std::nth_element(
-          begin,
-          split,
-          end,
-          [this, &split_dim](auto const index_a, auto const index_b) -> bool {
-            return space_[index_a][split_dim] < space_[index_b][split_dim];
-          });
-      split_val = space_[*split][split_dim];
-    } else if (split == begin) {
-      split++;
-      std::nth_element(
-          begin,
-          split,
-          end,
-          [this, &split_dim](auto const index_a, auto const index_b) -> bool {
-            return space_[index_a][split_dim] < space_[index_b][split_dim];
-          });
-      split_val = space_[*split][split_dim];
+  template <typename RandomAccessIterator_>
+  inline void operator()(
+      typename std::iterator_traits<
+          RandomAccessIterator_>::value_type const,  // depth
+      RandomAccessIterator_ begin,
+      RandomAccessIterator_ end,
+      BoxType const& box,
+      RandomAccessIterator_& split,
+      SizeType& split_dim,
+      ScalarType& split_val) const {
+    sample_box_.FillInverseMax();
+    ForEachSample(begin, end, kSampleSize, [this](auto const index) {
+      sample_box_.Fit(space_[index]);
+    });
+
+    ScalarType max_delta;
+    sample_box_.LongestAxis(split_dim, max_delta);
+
+    if (max_delta > ScalarType(0)) {
+      values_.clear();
+      ForEachSample(begin, end, kSampleSize, [this, &split_dim](auto const i) {
+        values_.push_back(space_[i][split_dim]);
+      });
+      auto const median = values_.begin() + values_.size() / 2;
+      std::nth_element(values_.begin(), median, values_.end());
+      split_val = *median;
+    } else {
+      // All sampled points are equal. The points outside the sample may still
+      // differ.
+      box.LongestAxis(split_dim, max_delta);
+      split_val = max_delta / ScalarType(2.0) + box.min(split_dim);
     }
+
+    PartitionSliding(space_, begin, end, split_dim, split, split_val);
   }
 
  private:
+  //! \brief The maximum number of points used to estimate the spread.
+  static SizeType constexpr kSampleSize = 100;
+
   SpaceWrapper_ space_;
+  // The sample is reused to avoid an allocation per node.
+  mutable BoxType sample_box_;
+  mutable std::vector<ScalarType> values_;
+};
+
+//! \copydoc SplittingRule::kSampledMedian
+template <typename SpaceWrapper_>
+class SplitterSampledMedian {
+  using ScalarType = typename SpaceWrapper_::ScalarType;
+  using SizeType = Size;
+  using BoxType = Box<ScalarType, SpaceWrapper_::Dim>;
+
+ public:
+  SplitterSampledMedian(
+      SpaceWrapper_ space, SplittingRuleOptions const& options)
+      : space_{space},
+        sample_size_{std::max(options.sample_size, SizeType(1))},
+        // A fixed seed makes builds reproducible.
+        random_engine_{} {
+    values_.reserve(sample_size_);
+  }
+
+  template <typename RandomAccessIterator_>
+  inline void operator()(
+      typename std::iterator_traits<
+          RandomAccessIterator_>::value_type const,  // depth
+      RandomAccessIterator_ begin,
+      RandomAccessIterator_ end,
+      BoxType const& box,
+      RandomAccessIterator_& split,
+      SizeType& split_dim,
+      ScalarType& split_val) const {
+    ScalarType max_delta;
+    box.LongestAxis(split_dim, max_delta);
+
+    // Points are sampled with replacement.
+    auto const count = static_cast<SizeType>(end - begin);
+    std::uniform_int_distribution<SizeType> distribution(0, count - 1);
+    values_.clear();
+    for (SizeType i = 0; i < sample_size_; ++i) {
+      auto const j = static_cast<std::ptrdiff_t>(distribution(random_engine_));
+      values_.push_back(space_[begin[j]][split_dim]);
+    }
+
+    auto const median = values_.begin() + values_.size() / 2;
+    std::nth_element(values_.begin(), median, values_.end());
+    split_val = *median;
+
+    PartitionSliding(space_, begin, end, split_dim, split, split_val);
+  }
+
+ private:
+  SpaceWrapper_ space_;
+  SizeType sample_size_;
+  // The state is modified by each split and reused to avoid an allocation per
+  // node.
+  mutable std::minstd_rand random_engine_;
+  mutable std::vector<ScalarType> values_;
 };
 
 template <SplittingRule Rule_>
@@ -207,6 +784,79 @@ struct SplittingRuleTraits<SplittingRule::kSlidingMidpoint> {
   using SplitterType = SplitterSlidingMidpoint<SpaceWrapper_>;
 };
 
+template <>
+struct SplittingRuleTraits<SplittingRule::kSurfaceAreaHeuristic> {
+  template <typename SpaceWrapper_>
+  using SplitterType = SplitterSurfaceAreaHeuristic<SpaceWrapper_>;
+};
+
+template <>
+struct SplittingRuleTraits<SplittingRule::kMaxVariance> {
+  template <typename SpaceWrapper_>
+  using SplitterType = SplitterMaxVariance<SpaceWrapper_>;
+};
+
+template <>
+struct SplittingRuleTraits<SplittingRule::kMaxSpreadSample> {
+  template <typename SpaceWrapper_>
+  using SplitterType = SplitterMaxSpreadSample<SpaceWrapper_>;
+};
+
+template <>
+struct SplittingRuleTraits<SplittingRule::kSampledMedian> {
+  template <typename SpaceWrapper_>
+  using SplitterType = SplitterSampledMedian<SpaceWrapper_>;
+};
+
+//! \brief True if \p T reports the size of its scratch memory through a
+//! memory_usage() method.
+template <typename T, typename = void>
+inline constexpr bool kHasMemoryUsage = false;
+
+template <typename T>
+inline constexpr bool kHasMemoryUsage<
+    T,
+    std::void_t<decltype(std::declval<T const&>().memory_usage())>> = true;
+
+//! \brief Returns the number of nodes of the trees that split each range of
+//! more than \p max_leaf_size indices in half, for roots that contain \p count
+//! and \p count + 1 indices. These are the exact node counts of
+//! SplittingRule::kLongestMedian.
+//! \details Both halves of a range differ in size by at most one. The node
+//! counts for ranges of size k and k + 1 are computed together from those of
+//! sizes k / 2 and k / 2 + 1. This takes O(log n) time.
+inline std::array<Size, 2> MedianNodeCount(
+    Size const count, Size const max_leaf_size) {
+  if (count + 1 <= max_leaf_size) {
+    return {1, 1};
+  }
+
+  Size const half = count / 2;
+  auto const [a, b] = MedianNodeCount(half, max_leaf_size);
+  Size const node_count =
+      count <= max_leaf_size ? 1 : (count % 2 == 0 ? 1 + 2 * a : 1 + a + b);
+  Size const next_node_count = count % 2 == 0 ? 1 + a + b : 1 + 2 * b;
+  return {node_count, next_node_count};
+}
+
+//! \brief Returns the number of nodes to reserve memory for when building a
+//! tree of \p count points.
+//! \details The node count is exact for SplittingRule::kLongestMedian. The
+//! leaves of the other rules are not all equally full. On average they contain
+//! about two thirds of \p max_leaf_size points. The estimate is based on that
+//! average and it never exceeds the node count of a tree with a single point
+//! per leaf.
+template <SplittingRule SplittingRule_>
+inline Size ReservedNodeCount(Size const count, Size const max_leaf_size) {
+  if constexpr (SplittingRule_ == SplittingRule::kLongestMedian) {
+    return MedianNodeCount(count, max_leaf_size)[0];
+  } else {
+    Size const leaf_count =
+        (count * 3 + max_leaf_size * 2 - 1) / (max_leaf_size * 2);
+    return std::min(leaf_count, count) * 2 - 1;
+  }
+}
+
 //! \brief This class provides the build algorithm of the KdTree. How the
 //! KdTree will be build depends on the Splitter template argument.
 template <
@@ -225,17 +875,19 @@ class BuildKdTreeImpl {
   using KdTreeDataType = KdTreeData_;
   using NodeType = typename KdTreeDataType::NodeType;
   using NodeAllocatorType = typename KdTreeDataType::NodeAllocatorType;
+  using IndicesType = typename KdTreeDataType::IndicesType;
 
   BuildKdTreeImpl(
       SpaceType const& space,
       SizeType const max_leaf_size,
-      std::vector<IndexType>& indices,
+      SplittingRuleOptions const& options,
+      IndicesType& indices,
       NodeAllocatorType& allocator)
       : space_(space),
         max_leaf_size_(
-            static_cast<typename std::vector<IndexType>::difference_type>(
+            static_cast<typename IndicesType::difference_type>(
                 max_leaf_size)),
-        splitter_(space_),
+        splitter_(MakeSplitter(space_, options)),
         indices_(indices),
         allocator_(allocator) {}
 
@@ -245,6 +897,16 @@ class BuildKdTreeImpl {
     return SplitIndices(0, indices_.begin(), indices_.end(), box);
   }
 
+  //! \brief Returns the largest size in bytes of the scratch memory used
+  //! during the build.
+  inline SizeType peak_scratch_memory() const {
+    if constexpr (kHasMemoryUsage<SplitterType>) {
+      return splitter_.memory_usage();
+    } else {
+      return 0;
+    }
+  }
+
  private:
   //! \brief Creates a tree node for a range of indices, splits the range in
   //! two and recursively does the same for each sub set of indices until the
@@ -277,8 +939,10 @@ class BuildKdTreeImpl {
     } else {
       // split equals end for the left branch and begin for the right branch.
       RandomAccessIterator_ split;
-      SizeType split_dim;
-      ScalarType split_val;
+      // Initialized because the compiler can't always prove that a splitter
+      // assigns them.
+      SizeType split_dim = 0;
+      ScalarType split_val = ScalarType(0);
       splitter_(depth, begin, end, box, split, split_dim, split_val);
 
       BoxType right = box;
@@ -300,6 +964,20 @@ class BuildKdTreeImpl {
     return node;
   }
 
+  //! \brief Creates the splitter. Only the splitters of rules that have
+  //! tunable parameters take \p options.
+  static SplitterType MakeSplitter(
+      SpaceType const& space, SplittingRuleOptions const& options) {
+    if constexpr (std::is_constructible_v<
+                      SplitterType,
+                      SpaceType,
+                      SplittingRuleOptions const&>) {
+      return SplitterType(space, options);
+    } else {
+      return SplitterType(space);
+    }
+  }
+
   template <typename RandomAccessIterator_>
   inline void ComputeBoundingBox(
       RandomAccessIterator_ begin,
@@ -312,12 +990,287 @@ class BuildKdTreeImpl {
   }
 
   SpaceType const& space_;
-  typename std::vector<IndexType>::difference_type const max_leaf_size_;
+  typename IndicesType::difference_type const max_leaf_size_;
   SplitterType splitter_;
-  std::vector<IndexType>& indices_;
+  IndicesType& indices_;
   NodeAllocatorType& allocator_;
 };
 
+//! \brief This class provides the build algorithm of a KdTree for
+//! SplittingRule::kMorton.
+template <typename SpaceWrapper_, typename KdTreeData_>
+class BuildKdTreeMortonImpl {
+ public:
+  using IndexType = typename KdTreeData_::IndexType;
+  using ScalarType = typename KdTreeData_::ScalarType;
+  using SizeType = Size;
+  using SpaceType = SpaceWrapper_;
+  using BoxType = Box<ScalarType, KdTreeData_::Dim>;
+  using KdTreeDataType = KdTreeData_;
+  using NodeType = typename KdTreeDataType::NodeType;
+  using NodeAllocatorType = typename KdTreeDataType::NodeAllocatorType;
+  using IndicesType = typename KdTreeDataType::IndicesType;
+  using CodeType = std::uint64_t;
+
+  BuildKdTreeMortonImpl(
+      SpaceType const& space,
+      SizeType const max_leaf_size,
+      SplittingRuleOptions const&,  // options
+      IndicesType& indices,
+      NodeAllocatorType& allocator)
+      : space_(space),
+        max_leaf_size_(max_leaf_size),
+        indices_(indices),
+        allocator_(allocator),
+        peak_scratch_memory_(0) {}
+
+  //! \brief Creates the full set of nodes for a KdTree.
+  inline NodeType* operator()(BoxType const& root_box) {
+    SortByCode(root_box);
+    BoxType box(root_box);
+    return SplitIndices(0, indices_.size(), box);
+  }
+
+  //! \brief Returns the largest size in bytes of the scratch memory used
+  //! during the build. It is reached while sorting the codes.
+  inline SizeType peak_scratch_memory() const { return peak_scratch_memory_; }
+
+ private:
+  static int constexpr kCodeBits = static_cast<int>(sizeof(CodeType) * 8);
+  static int constexpr kMaxBitsPerDim = 32;
+  static int constexpr kDigitBits = 11;
+  static SizeType constexpr kRadix = SizeType(1) << kDigitBits;
+  //! \brief Blocks of codes that are sorted in parallel have at least this
+  //! size, such that counting its digits outweighs clearing and summing its
+  //! histogram.
+  static SizeType constexpr kMinBlockSize = SizeType(1) << 16;
+  //! \brief The maximum number of blocks of codes that are sorted in parallel.
+  static SizeType constexpr kMaxBlockCount = 64;
+
+  //! \brief Computes the Morton code of each point and sorts the indices by
+  //! them.
+  inline void SortByCode(BoxType const& root_box) {
+    coded_dim_ = std::min(space_.sdim(), static_cast<SizeType>(kCodeBits));
+    bits_per_dim_ = std::min(
+        kCodeBits / static_cast<int>(coded_dim_), kMaxBitsPerDim);
+
+    // All cells are cubes. Their size is based on the longest side of the
+    // root box.
+    ScalarType max_delta;
+    SizeType max_dim;
+    root_box.LongestAxis(max_dim, max_delta);
+    double const max_cell =
+        static_cast<double>((std::uint64_t(1) << bits_per_dim_) - 1);
+    double const scale = max_delta > ScalarType(0)
+                             ? max_cell / static_cast<double>(max_delta)
+                             : 0.0;
+
+    // The bits of all dimensions are interleaved, from most to least
+    // significant. Spreading the bits of a cell coordinate is done a byte at a
+    // time using a lookup table.
+    SizeType const stride = coded_dim_;
+    std::array<CodeType, 256> spread;
+    for (SizeType byte = 0; byte < 256; ++byte) {
+      spread[byte] = 0;
+      for (SizeType b = 0; b < 8 && b * stride < SizeType(kCodeBits); ++b) {
+        spread[byte] |= static_cast<CodeType>((byte >> b) & 1) << (b * stride);
+      }
+    }
+
+    // TODO Remove when MSVC++ has default support for OpenMP 3.0+.
+    using SSize = std::ptrdiff_t;
+
+    SizeType const count = indices_.size();
+    SizeType const byte_count = (static_cast<SizeType>(bits_per_dim_) + 7) / 8;
+    codes_.resize(count);
+    // The bits that are set in all codes and those set in any code. A digit of
+    // which these bits are the same is the same for all codes.
+    CodeType all_bits = ~CodeType(0);
+    CodeType any_bits = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(& : all_bits) \
+    reduction(| : any_bits)
+#endif
+    for (SSize t = 0; t < static_cast<SSize>(count); ++t) {
+      auto const i = static_cast<SizeType>(t);
+      auto const p = space_[indices_[i]];
+      CodeType code = 0;
+      for (SizeType j = 0; j < coded_dim_; ++j) {
+        double const c = static_cast<double>(p[j] - root_box.min(j)) * scale;
+        auto const cell =
+            static_cast<std::uint32_t>(std::clamp(c, 0.0, max_cell));
+        for (SizeType k = 0; k < byte_count; ++k) {
+          code |= spread[(cell >> (k * 8)) & 0xFF]
+                  << (k * 8 * stride + (stride - 1 - j));
+        }
+      }
+      codes_[i] = code;
+      all_bits &= code;
+      any_bits |= code;
+    }
+
+    // Least significant digit radix sort of the codes and indices. The codes
+    // are divided into consecutive blocks that are counted and scattered in
+    // parallel when compiled with OpenMP. A block writes the codes of a digit
+    // after those of the same digit in the blocks before it, which keeps the
+    // sort stable.
+#ifdef _OPENMP
+    SizeType const block_count =
+        std::clamp(count / kMinBlockSize, SizeType(1), kMaxBlockCount);
+#else
+    SizeType const block_count = 1;
+#endif
+    int const code_bits = bits_per_dim_ * static_cast<int>(coded_dim_);
+    int const pass_count = (code_bits + kDigitBits - 1) / kDigitBits;
+    std::vector<std::array<SizeType, kRadix>> histograms(block_count);
+
+    std::vector<CodeType> codes_tmp(count);
+    // Both index buffers share the memory resource of the tree such that
+    // they can be swapped.
+    IndicesType indices_tmp(count, indices_.get_allocator());
+    peak_scratch_memory_ =
+        (codes_.capacity() + codes_tmp.capacity()) * sizeof(CodeType) +
+        indices_tmp.capacity() * sizeof(IndexType) +
+        histograms.capacity() * sizeof(std::array<SizeType, kRadix>);
+    auto const block_begin = [&count, &block_count](SizeType const b) {
+      return count / block_count * b + std::min(b, count % block_count);
+    };
+    for (int pass = 0; pass < pass_count; ++pass) {
+      int const shift = pass * kDigitBits;
+      // The digit is the same for all codes. Nothing changes.
+      if (Digit(all_bits, shift) == Digit(any_bits, shift)) {
+        continue;
+      }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+      for (SSize t = 0; t < static_cast<SSize>(block_count); ++t) {
+        auto const b = static_cast<SizeType>(t);
+        auto& histogram = histograms[b];
+        histogram.fill(0);
+        for (SizeType i = block_begin(b); i < block_begin(b + 1); ++i) {
+          ++histogram[Digit(codes_[i], shift)];
+        }
+      }
+
+      SizeType offset = 0;
+      for (SizeType d = 0; d < kRadix; ++d) {
+        for (auto& histogram : histograms) {
+          SizeType const c = histogram[d];
+          histogram[d] = offset;
+          offset += c;
+        }
+      }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+      for (SSize t = 0; t < static_cast<SSize>(block_count); ++t) {
+        auto const b = static_cast<SizeType>(t);
+        auto& histogram = histograms[b];
+        for (SizeType i = block_begin(b); i < block_begin(b + 1); ++i) {
+          SizeType const j = histogram[Digit(codes_[i], shift)]++;
+          codes_tmp[j] = codes_[i];
+          indices_tmp[j] = indices_[i];
+        }
+      }
+      std::swap(codes_, codes_tmp);
+      std::swap(indices_, indices_tmp);
+    }
+  }
+
+  static inline SizeType Digit(CodeType const code, int const shift) {
+    return static_cast<SizeType>(code >> shift) & (kRadix - 1);
+  }
+
+  //! \brief Returns the position of the most significant bit that is set.
+  static inline int HighestBit(CodeType code) {
+    int bit = -1;
+    while (code != 0) {
+      code >>= 1;
+      ++bit;
+    }
+    return bit;
+  }
+
+  //! \brief Creates a tree node for the range of indices [ \p begin, \p end ).
+  //! \details The box of each node is fitted to its points while unwinding
+  //! the recursion, just like BuildKdTreeImpl does.
+  inline NodeType* SplitIndices(
+      SizeType const begin, SizeType const end, BoxType& box) {
+    NodeType* node = allocator_.Allocate();
+    if ((end - begin) <= max_leaf_size_) {
+      node->data.leaf.begin_idx = static_cast<IndexType>(begin);
+      node->data.leaf.end_idx = static_cast<IndexType>(end);
+      node->left = nullptr;
+      node->right = nullptr;
+      ComputeBoundingBox(begin, end, box);
+    } else {
+      SizeType split;
+      SizeType split_dim;
+
+      // The codes are sorted, so the first and last code differ in the
+      // highest bit that any of them do.
+      CodeType const diff = codes_[begin] ^ codes_[end - 1];
+      if (diff != 0) {
+        int const bit = HighestBit(diff);
+        CodeType const mask = CodeType(1) << bit;
+        split = static_cast<SizeType>(
+            std::partition_point(
+                codes_.begin() + static_cast<std::ptrdiff_t>(begin),
+                codes_.begin() + static_cast<std::ptrdiff_t>(end),
+                [mask](CodeType const code) { return (code & mask) == 0; }) -
+            codes_.begin());
+        split_dim = static_cast<SizeType>(
+                        bits_per_dim_ * static_cast<int>(coded_dim_) - 1 -
+                        bit) %
+                    coded_dim_;
+      } else {
+        // All points share the same cell. The codes remain valid because
+        // they are equal.
+        ComputeBoundingBox(begin, end, box);
+        ScalarType max_delta;
+        box.LongestAxis(split_dim, max_delta);
+        split = begin + (end - begin) / 2;
+        std::nth_element(
+            indices_.begin() + static_cast<std::ptrdiff_t>(begin),
+            indices_.begin() + static_cast<std::ptrdiff_t>(split),
+            indices_.begin() + static_cast<std::ptrdiff_t>(end),
+            [this, &split_dim](auto const index_a, auto const index_b) {
+              return space_[index_a][split_dim] < space_[index_b][split_dim];
+            });
+      }
+
+      BoxType right = box;
+      node->left = SplitIndices(begin, split, box);
+      node->right = SplitIndices(split, end, right);
+      node->SetBranch(box, right, split_dim);
+      box.Fit(right);
+    }
+
+    return node;
+  }
+
+  inline void ComputeBoundingBox(
+      SizeType const begin, SizeType const end, BoxType& box) const {
+    box.FillInverseMax();
+    for (SizeType i = begin; i < end; ++i) {
+      box.Fit(space_[indices_[i]]);
+    }
+  }
+
+  SpaceType const& space_;
+  SizeType const max_leaf_size_;
+  IndicesType& indices_;
+  NodeAllocatorType& allocator_;
+  //! \brief Morton codes of the points in the order of indices_.
+  std::vector<CodeType> codes_;
+  SizeType coded_dim_;
+  int bits_per_dim_;
+  SizeType peak_scratch_memory_;
+};
+
 //! \brief KdTree meta information depending on the SpaceTag_ template argument.
 template <typename SpaceTag_>
 struct KdTreeSpaceTagTraits;
@@ -347,29 +1300,49 @@ class BuildKdTree {
   using KdTreeDataType = KdTreeData<Node_, Dim_>;
 
   //! \brief Construct a KdTree given \p points , \p max_leaf_size and
-  //! SplitterType.
+  //! SplitterType. The indices and nodes of the tree are allocated from \p
+  //! resource.
   template <typename SpaceWrapper_>
-  KdTreeDataType operator()(SpaceWrapper_ space, Size max_leaf_size) {
+  KdTreeDataType operator()(
+      SpaceWrapper_ space,
+      Size max_leaf_size,
+      SplittingRuleOptions const& options = SplittingRuleOptions(),
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
     static_assert(
         std::is_same_v<ScalarType, typename SpaceWrapper_::ScalarType>);
     static_assert(Dim_ == SpaceWrapper_::Dim);
     assert(space.size() > 0);
     assert(max_leaf_size > 0);
 
-    using BuildKdTreeImplType =
-        BuildKdTreeImpl<SpaceWrapper_, SplittingRule_, KdTreeDataType>;
+    using BuildKdTreeImplType = std::conditional_t<
+        SplittingRule_ == SplittingRule::kMorton,
+        BuildKdTreeMortonImpl<SpaceWrapper_, KdTreeDataType>,
+        BuildKdTreeImpl<SpaceWrapper_, SplittingRule_, KdTreeDataType>>;
     using NodeAllocatorType = typename KdTreeDataType::NodeAllocatorType;
+    using IndicesType = typename KdTreeDataType::IndicesType;
     using BoxType = Box<ScalarType, Dim_>;
 
-    std::vector<IndexType> indices(space.size());
+    IndicesType indices(space.size(), resource);
     std::iota(indices.begin(), indices.end(), 0);
     BoxType root_box = space.ComputeBoundingBox();
-    NodeAllocatorType allocator;
-    Node_* root_node =
-        BuildKdTreeImplType{space, max_leaf_size, indices, allocator}(root_box);
+    // The memory of (nearly) all nodes is allocated at once.
+    NodeAllocatorType allocator(
+        ReservedNodeCount<SplittingRule_>(space.size(), max_leaf_size),
+        resource);
+    BuildKdTreeImplType build{
+        space, max_leaf_size, options, indices, allocator};
+    Node_* root_node = build(root_box);
+
+    Size const peak_build_memory =
+        indices.capacity() * sizeof(IndexType) +
+        allocator.capacity() * sizeof(Node_) + build.peak_scratch_memory();
 
     return KdTreeDataType{
-        std::move(indices), root_box, std::move(allocator), root_node};
+        std::move(indices),
+        root_box,
+        std::move(allocator),
+        root_node,
+        peak_build_memory};
   }
 };
 
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <memory_resource>
+#include <vector>
+
 #include "pico_tree/core.hpp"
 #include "pico_tree/internal/memory.hpp"
 #include "pico_tree/internal/stream.hpp"
@@ -7,6 +10,8 @@
 namespace pico_tree::internal {
 
 //! \brief The data structure that represents a KdTree.
+//! \details The indices and nodes are allocated from a single
+//! std::pmr::memory_resource.
 template <typename Node_, Size Dim_>
 class KdTreeData {
  public:
@@ -16,17 +21,38 @@ class KdTreeData {
   using BoxType = internal::Box<ScalarType, Dim>;
   using NodeType = Node_;
   using NodeAllocatorType = ChunkAllocator<NodeType, 256>;
+  using IndicesType = std::pmr::vector<IndexType>;
 
-  static KdTreeData Load(internal::Stream& stream) {
+  static KdTreeData Load(
+      internal::Stream& stream, std::pmr::memory_resource* resource) {
     typename BoxType::SizeType sdim;
     stream.Read(sdim);
 
-    KdTreeData kd_tree_data{{}, BoxType(sdim), NodeAllocatorType(), nullptr};
+    KdTreeData kd_tree_data{
+        IndicesType(resource),
+        BoxType(sdim),
+        NodeAllocatorType(resource),
+        nullptr,
+        0};
     kd_tree_data.Read(stream);
 
     return kd_tree_data;
   }
 
+  //! \brief Returns a deep copy of this KdTreeData of which the indices and
+  //! nodes are allocated from \p resource. The nodes of the copy are
+  //! allocated using a single allocation.
+  KdTreeData Clone(std::pmr::memory_resource* resource) const {
+    KdTreeData copy{
+        IndicesType(indices, resource),
+        root_box,
+        NodeAllocatorType(CountNodes(root_node), resource),
+        nullptr,
+        peak_build_memory};
+    copy.root_node = copy.CopyNode(root_node);
+    return copy;
+  }
+
   static void Save(KdTreeData const& data, internal::Stream& stream) {
     // Write sdim.
     stream.Write(data.root_box.size());
@@ -34,15 +60,37 @@ class KdTreeData {
   }
 
   //! \brief Sorted indices that refer to points inside points_.
-  std::vector<IndexType> indices;
+  IndicesType indices;
   //! \brief Bounding box of the root node.
   BoxType root_box;
   //! \brief Memory allocator for tree nodes.
   NodeAllocatorType allocator;
   //! \brief Root of the KdTree.
   NodeType* root_node;
+  //! \brief Peak memory in bytes used while building the KdTree. It is zero
+  //! when the KdTree was loaded from a stream.
+  Size peak_build_memory;
 
  private:
+  //! \brief Returns the number of nodes of the subtree of \p node.
+  static Size CountNodes(NodeType const* const node) {
+    if (node->IsLeaf()) {
+      return 1;
+    }
+    return 1 + CountNodes(node->left) + CountNodes(node->right);
+  }
+
+  //! \brief Recursively copies \p node and its descendants.
+  inline NodeType* CopyNode(NodeType const* const node) {
+    NodeType* copy = allocator.Allocate();
+    *copy = *node;
+    if (!node->IsLeaf()) {
+      copy->left = CopyNode(node->left);
+      copy->right = CopyNode(node->right);
+    }
+    return copy;
+  }
+
   //! \brief Recursively reads the Node and its descendants.
   inline NodeType* ReadNode(internal::Stream& stream) {
     NodeType* node = allocator.Allocate();
@@ -1,14 +1,68 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <memory_resource>
+#include <queue>
+#include <utility>
 #include <vector>
 
+#include "pico_tree/core.hpp"
 #include "pico_tree/internal/box.hpp"
 #include "pico_tree/internal/kd_tree_node.hpp"
 #include "pico_tree/internal/point.hpp"
+#include "pico_tree/internal/prefetch.hpp"
 #include "pico_tree/metric.hpp"
+#include "pico_tree/prefetch_traits.hpp"
 
 namespace pico_tree::internal {
 
+//! \brief Index filter that accepts every point. It is the default filter of
+//! the nearest neighbor searches and gets optimized away by the compiler.
+struct AcceptAll {
+  template <typename Index_>
+  constexpr bool operator()(Index_) const {
+    return true;
+  }
+};
+
+//! \brief Node filter that accepts every node. It is the default node filter of
+//! the nearest neighbor searches and gets optimized away by the compiler.
+//! \details A node filter is called with the position of a node in depth-first
+//! pre-order before the search descends into it. Left() and Right() return the
+//! positions of the children of a node.
+struct AcceptAllNodes {
+  constexpr bool operator()(Size) const { return true; }
+
+  constexpr Size Left(Size) const { return 0; }
+
+  constexpr Size Right(Size) const { return 0; }
+};
+
+//! \brief Node filter that only accepts the nodes of which the summary is
+//! accepted by a predicate.
+template <typename Summary_, typename Predicate_>
+class AcceptSummaries {
+ public:
+  inline AcceptSummaries(
+      NodeSummaries<Summary_> const& summaries, Predicate_ predicate)
+      : summaries_(summaries), predicate_(predicate) {}
+
+  inline bool operator()(Size const node) const {
+    return predicate_(summaries_.summaries[node]);
+  }
+
+  inline Size Left(Size const node) const { return node + 1; }
+
+  inline Size Right(Size const node) const { return summaries_.right[node]; }
+
+ private:
+  NodeSummaries<Summary_> const& summaries_;
+  Predicate_ predicate_;
+};
+
 //! \brief This class provides a search nearest function for Euclidean spaces.
 //! \details S. Arya and D. M. Mount, Algorithms for fast vector quantization,
 //! In IEEE Data Compression Conference, pp. 381–390, March 1993.
@@ -20,49 +74,86 @@ template <
     typename Metric_,
     typename PointWrapper_,
     typename Visitor_,
-    typename Index_>
+    typename Index_,
+    typename Filter_ = AcceptAll,
+    typename NodeFilter_ = AcceptAllNodes>
 class SearchNearestEuclidean {
  public:
   using IndexType = Index_;
   using ScalarType = typename SpaceWrapper_::ScalarType;
-  using PointType = Point<ScalarType, SpaceWrapper_::Dim>;
+  using DistanceType = MetricDistanceType<Metric_, ScalarType>;
+  using PointType = Point<DistanceType, SpaceWrapper_::Dim>;
   //! \brief Node type supported by this SearchNearestEuclidean.
   using NodeType = KdTreeNodeEuclidean<IndexType, ScalarType>;
+  using PrefetchTraitsType =
+      PrefetchTraits<typename SpaceWrapper_::SpaceType>;
 
   inline SearchNearestEuclidean(
       SpaceWrapper_ space,
       Metric_ metric,
-      std::vector<IndexType> const& indices,
+      std::pmr::vector<IndexType> const& indices,
       PointWrapper_ query,
-      Visitor_& visitor)
+      Visitor_& visitor,
+      Filter_ filter = Filter_(),
+      NodeFilter_ node_filter = NodeFilter_())
       : space_(space),
         metric_(metric),
         indices_(indices),
         query_(query),
         node_box_offset_(PointType::FromSize(space_.sdim())),
-        visitor_(visitor) {}
+        visitor_(visitor),
+        filter_(filter),
+        node_filter_(node_filter) {}
 
   //! \brief Search nearest neighbors starting from \p node.
   inline void operator()(NodeType const* const node) {
-    node_box_offset_.Fill(ScalarType(0.0));
-    SearchNearest(node, ScalarType(0.0));
+    node_box_offset_.Fill(DistanceType(0.0));
+    SearchNearest(node, 0, DistanceType(0.0));
   }
 
  private:
+  static IndexType constexpr kPrefetchPointDistance =
+      static_cast<IndexType>(PrefetchTraitsType::kPrefetchPointDistance);
+
   inline void SearchNearest(
-      NodeType const* const node, ScalarType node_box_distance) {
+      NodeType const* const node,
+      Size const node_pos,
+      DistanceType node_box_distance) {
+    // Subtrees of which the summary can't match are skipped as a whole.
+    if (!node_filter_(node_pos)) {
+      return;
+    }
+
     if (node->IsLeaf()) {
-      for (IndexType i = node->data.leaf.begin_idx; i < node->data.leaf.end_idx;
-           ++i) {
-        visitor_(
-            indices_[i],
-            metric_(query_.begin(), query_.end(), space_[indices_[i]]));
+      IndexType const begin_idx = node->data.leaf.begin_idx;
+      IndexType const end_idx = node->data.leaf.end_idx;
+      if constexpr (kPrefetchPointDistance > 0) {
+        for (IndexType i = begin_idx;
+             i < std::min(begin_idx + kPrefetchPointDistance, end_idx);
+             ++i) {
+          Prefetch(space_[indices_[i]]);
+        }
+      }
+
+      for (IndexType i = begin_idx; i < end_idx; ++i) {
+        if constexpr (kPrefetchPointDistance > 0) {
+          if (i + kPrefetchPointDistance < end_idx) {
+            Prefetch(space_[indices_[i + kPrefetchPointDistance]]);
+          }
+        }
+        // The filter is evaluated before the distance so that rejected points
+        // don't cost a distance calculation.
+        if (filter_(indices_[i])) {
+          visitor_(
+              indices_[i],
+              metric_(query_.begin(), query_.end(), space_[indices_[i]]));
+        }
       }
     } else {
       // Go left or right and then check if we should still go down the other
       // side based on the current minimum distance.
       ScalarType const v = query_[node->data.branch.split_dim];
-      ScalarType new_offset;
+      DistanceType new_offset;
       NodeType const* node_1st;
       NodeType const* node_2nd;
 
@@ -73,24 +164,42 @@ class SearchNearestEuclidean {
       // If left_max - v > 0, this means that the query is inside the left node,
       // if right_min - v < 0 it's inside the right one. For the area in between
       // we just pick the closest one by summing them.
+      Size pos_1st;
+      Size pos_2nd;
       if ((node->data.branch.left_max + node->data.branch.right_min - v - v) >
           0) {
         node_1st = node->left;
         node_2nd = node->right;
-        new_offset = metric_(node->data.branch.right_min, v);
+        pos_1st = node_filter_.Left(node_pos);
+        pos_2nd = node_filter_.Right(node_pos);
+        new_offset = CoordinateDistance(
+            metric_,
+            node->data.branch.right_min,
+            v,
+            node->data.branch.split_dim);
       } else {
         node_1st = node->right;
         node_2nd = node->left;
-        new_offset = metric_(node->data.branch.left_max, v);
+        pos_1st = node_filter_.Right(node_pos);
+        pos_2nd = node_filter_.Left(node_pos);
+        new_offset = CoordinateDistance(
+            metric_,
+            node->data.branch.left_max,
+            v,
+            node->data.branch.split_dim);
+      }
+
+      if constexpr (PrefetchTraitsType::kPrefetchNodes) {
+        Prefetch(node_2nd);
       }
 
       // The distance and offset for node_1st is the same as that of its parent.
-      SearchNearest(node_1st, node_box_distance);
+      SearchNearest(node_1st, pos_1st, node_box_distance);
 
       // Calculate the distance to node_2nd.
       // NOTE: This method only works with Lp norms to which the exponent is not
       // applied.
-      ScalarType const old_offset =
+      DistanceType const old_offset =
           node_box_offset_[node->data.branch.split_dim];
       node_box_distance = node_box_distance - old_offset + new_offset;
 
@@ -99,7 +208,7 @@ class SearchNearestEuclidean {
       // split value we determine if we should go into the neighboring node.
       if (visitor_.max() >= node_box_distance) {
         node_box_offset_[node->data.branch.split_dim] = new_offset;
-        SearchNearest(node_2nd, node_box_distance);
+        SearchNearest(node_2nd, pos_2nd, node_box_distance);
         node_box_offset_[node->data.branch.split_dim] = old_offset;
       }
     }
@@ -107,10 +216,12 @@ class SearchNearestEuclidean {
 
   SpaceWrapper_ space_;
   Metric_ metric_;
-  std::vector<IndexType> const& indices_;
+  std::pmr::vector<IndexType> const& indices_;
   PointWrapper_ query_;
   PointType node_box_offset_;
   Visitor_& visitor_;
+  Filter_ filter_;
+  NodeFilter_ node_filter_;
 };
 
 //! \brief This class provides a search nearest function for topological spaces.
@@ -119,77 +230,125 @@ template <
     typename Metric_,
     typename PointWrapper_,
     typename Visitor_,
-    typename Index_>
+    typename Index_,
+    typename Filter_ = AcceptAll,
+    typename NodeFilter_ = AcceptAllNodes>
 class SearchNearestTopological {
  public:
   using IndexType = Index_;
   using ScalarType = typename SpaceWrapper_::ScalarType;
-  using PointType = Point<ScalarType, SpaceWrapper_::Dim>;
+  using DistanceType = MetricDistanceType<Metric_, ScalarType>;
+  using PointType = Point<DistanceType, SpaceWrapper_::Dim>;
   //! \brief Node type supported by this SearchNearestTopological.
   using NodeType = KdTreeNodeTopological<IndexType, ScalarType>;
+  using PrefetchTraitsType =
+      PrefetchTraits<typename SpaceWrapper_::SpaceType>;
 
   inline SearchNearestTopological(
       SpaceWrapper_ space,
       Metric_ metric,
-      std::vector<IndexType> const& indices,
+      std::pmr::vector<IndexType> const& indices,
       PointWrapper_ query,
-      Visitor_& visitor)
+      Visitor_& visitor,
+      Filter_ filter = Filter_(),
+      NodeFilter_ node_filter = NodeFilter_())
       : space_(space),
         metric_(metric),
         indices_(indices),
         query_(query),
         node_box_offset_(PointType::FromSize(space_.sdim())),
-        visitor_(visitor) {}
+        visitor_(visitor),
+        filter_(filter),
+        node_filter_(node_filter) {}
 
   //! \brief Search nearest neighbors starting from \p node.
   inline void operator()(NodeType const* const node) {
-    node_box_offset_.Fill(ScalarType(0.0));
-    SearchNearest(node, ScalarType(0.0));
+    node_box_offset_.Fill(DistanceType(0.0));
+    SearchNearest(node, 0, DistanceType(0.0));
   }
 
  private:
+  static IndexType constexpr kPrefetchPointDistance =
+      static_cast<IndexType>(PrefetchTraitsType::kPrefetchPointDistance);
+
   inline void SearchNearest(
-      NodeType const* const node, ScalarType node_box_distance) {
+      NodeType const* const node,
+      Size const node_pos,
+      DistanceType node_box_distance) {
+    // Subtrees of which the summary can't match are skipped as a whole.
+    if (!node_filter_(node_pos)) {
+      return;
+    }
+
     if (node->IsLeaf()) {
-      for (IndexType i = node->data.leaf.begin_idx; i < node->data.leaf.end_idx;
-           ++i) {
-        visitor_(
-            indices_[i],
-            metric_(query_.begin(), query_.end(), space_[indices_[i]]));
+      IndexType const begin_idx = node->data.leaf.begin_idx;
+      IndexType const end_idx = node->data.leaf.end_idx;
+      if constexpr (kPrefetchPointDistance > 0) {
+        for (IndexType i = begin_idx;
+             i < std::min(begin_idx + kPrefetchPointDistance, end_idx);
+             ++i) {
+          Prefetch(space_[indices_[i]]);
+        }
+      }
+
+      for (IndexType i = begin_idx; i < end_idx; ++i) {
+        if constexpr (kPrefetchPointDistance > 0) {
+          if (i + kPrefetchPointDistance < end_idx) {
+            Prefetch(space_[indices_[i + kPrefetchPointDistance]]);
+          }
+        }
+        // The filter is evaluated before the distance so that rejected points
+        // don't cost a distance calculation.
+        if (filter_(indices_[i])) {
+          visitor_(
+              indices_[i],
+              metric_(query_.begin(), query_.end(), space_[indices_[i]]));
+        }
       }
     } else {
       // Go left or right and then check if we should still go down the other
       // side based on the current minimum distance.
       ScalarType const v = query_[node->data.branch.split_dim];
       // Determine the distance to the boxes of the children of this node.
-      ScalarType const d1 = metric_(
+      DistanceType const d1 = metric_(
           v,
           node->data.branch.left_min,
           node->data.branch.left_max,
           node->data.branch.split_dim);
-      ScalarType const d2 = metric_(
+      DistanceType const d2 = metric_(
           v,
           node->data.branch.right_min,
           node->data.branch.right_max,
           node->data.branch.split_dim);
       NodeType const* node_1st;
       NodeType const* node_2nd;
-      ScalarType new_offset;
+      DistanceType new_offset;
+
+      Size pos_1st;
+      Size pos_2nd;
 
       // Visit the closest child/box first.
       if (d1 < d2) {
         node_1st = node->left;
         node_2nd = node->right;
+        pos_1st = node_filter_.Left(node_pos);
+        pos_2nd = node_filter_.Right(node_pos);
         new_offset = d2;
       } else {
         node_1st = node->right;
         node_2nd = node->left;
+        pos_1st = node_filter_.Right(node_pos);
+        pos_2nd = node_filter_.Left(node_pos);
         new_offset = d1;
       }
 
-      SearchNearest(node_1st, node_box_distance);
+      if constexpr (PrefetchTraitsType::kPrefetchNodes) {
+        Prefetch(node_2nd);
+      }
 
-      ScalarType const old_offset =
+      SearchNearest(node_1st, pos_1st, node_box_distance);
+
+      DistanceType const old_offset =
           node_box_offset_[node->data.branch.split_dim];
       node_box_distance = node_box_distance - old_offset + new_offset;
 
@@ -198,7 +357,7 @@ class SearchNearestTopological {
       // split value we determine if we should go into the neighboring node.
       if (visitor_.max() >= node_box_distance) {
         node_box_offset_[node->data.branch.split_dim] = new_offset;
-        SearchNearest(node_2nd, node_box_distance);
+        SearchNearest(node_2nd, pos_2nd, node_box_distance);
         node_box_offset_[node->data.branch.split_dim] = old_offset;
       }
     }
@@ -206,12 +365,1050 @@ class SearchNearestTopological {
 
   SpaceWrapper_ space_;
   Metric_ metric_;
-  std::vector<IndexType> const& indices_;
+  std::pmr::vector<IndexType> const& indices_;
+  PointWrapper_ query_;
+  PointType node_box_offset_;
+  Visitor_& visitor_;
+  Filter_ filter_;
+  NodeFilter_ node_filter_;
+};
+
+//! \brief This class provides a search nearest function for a packet of
+//! queries in a Euclidean space.
+//! \details The queries of a packet traverse the tree together, such that
+//! nearby queries share the loads of nodes and points. Each query keeps its own
+//! node box offsets, node box distance and visitor. A bit mask tracks the
+//! queries that are active in a subtree. The split tests of a branch are
+//! evaluated for all queries at once using coordinates stored per dimension.
+//! <p/>
+//! At a branch, the child that is closest to most active queries is visited
+//! first. For each query the search is exactly that of SearchNearestEuclidean.
+template <
+    typename SpaceWrapper_,
+    typename Metric_,
+    typename Visitor_,
+    typename Index_,
+    Size PacketSize_>
+class SearchNearestEuclideanPacket {
+  static_assert(
+      PacketSize_ > 0 && PacketSize_ <= 32, "PACKET_SIZE_NOT_IN_RANGE_1_32");
+
+ public:
+  using IndexType = Index_;
+  using ScalarType = typename SpaceWrapper_::ScalarType;
+  using DistanceType = MetricDistanceType<Metric_, ScalarType>;
+  //! \brief Node type supported by this SearchNearestEuclideanPacket.
+  using NodeType = KdTreeNodeEuclidean<IndexType, ScalarType>;
+  //! \brief Maximum number of queries of a packet.
+  static Size constexpr kPacketSize = PacketSize_;
+
+  inline SearchNearestEuclideanPacket(
+      SpaceWrapper_ space,
+      Metric_ metric,
+      std::pmr::vector<IndexType> const& indices)
+      : space_(space),
+        metric_(metric),
+        indices_(indices),
+        coords_(space_.sdim() * kPacketSize),
+        node_box_offsets_(space_.sdim() * kPacketSize) {}
+
+  //! \brief Search nearest neighbors starting from \p node for the \p count
+  //! queries in \p queries. The results of query i are reported to visitor
+  //! \p visitors[i].
+  inline void operator()(
+      NodeType const* const node,
+      ScalarType const* const* queries,
+      Visitor_* visitors,
+      Size const count) {
+    assert(count > 0 && count <= kPacketSize);
+    Size const sdim = space_.sdim();
+    for (Size q = 0; q < kPacketSize; ++q) {
+      // Unused lanes copy the first query so their split tests remain valid.
+      queries_[q] = queries[q < count ? q : 0];
+      for (Size d = 0; d < sdim; ++d) {
+        coords_[d * kPacketSize + q] = queries_[q][d];
+      }
+    }
+    std::fill(
+        node_box_offsets_.begin(), node_box_offsets_.end(), DistanceType(0.0));
+    visitors_ = visitors;
+
+    DistancesType node_box_distances;
+    node_box_distances.fill(DistanceType(0.0));
+    MaskType const mask = ~MaskType(0) >> (32 - count);
+    SearchNearest(node, mask, node_box_distances);
+  }
+
+ private:
+  using MaskType = std::uint32_t;
+  using DistancesType = std::array<DistanceType, kPacketSize>;
+
+  inline void SearchNearest(
+      NodeType const* const node,
+      MaskType const mask,
+      DistancesType const& node_box_distances) {
+    if (node->IsLeaf()) {
+      Size const sdim = space_.sdim();
+      for (IndexType i = node->data.leaf.begin_idx; i < node->data.leaf.end_idx;
+           ++i) {
+        IndexType const index = indices_[i];
+        ScalarType const* const p = space_[index];
+        for (MaskType m = mask; m != 0; m &= m - 1) {
+          Size const q = static_cast<Size>(CountTrailingZeros(m));
+          visitors_[q](
+              index, metric_(queries_[q], queries_[q] + sdim, p));
+        }
+      }
+    } else {
+      Size const split_dim =
+          static_cast<Size>(node->data.branch.split_dim);
+      ScalarType const left_max = node->data.branch.left_max;
+      ScalarType const right_min = node->data.branch.right_min;
+      ScalarType const* const v = coords_.data() + split_dim * kPacketSize;
+
+      // The split tests of all queries. They don't depend on the mask such
+      // that the loop can be vectorized.
+      MaskType left_first = 0;
+      DistancesType new_offsets;
+      for (Size q = 0; q < kPacketSize; ++q) {
+        bool const left = (left_max + right_min - v[q] - v[q]) > 0;
+        left_first |= MaskType(left) << q;
+        new_offsets[q] = CoordinateDistance(
+            metric_,
+            left ? right_min : left_max,
+            v[q],
+            static_cast<int>(split_dim));
+      }
+      left_first &= mask;
+      MaskType const right_first = mask & ~left_first;
+
+      // A query only visits its second child after its first one, such that
+      // its search distance is as small as possible. The first child of the
+      // minority of queries is visited a second time, after their first child.
+      if (PopCount(left_first) >= PopCount(right_first)) {
+        SearchChild(
+            node->left, split_dim, left_first, 0, new_offsets,
+            node_box_distances);
+        SearchChild(
+            node->right, split_dim, right_first, left_first, new_offsets,
+            node_box_distances);
+        SearchChild(
+            node->left, split_dim, 0, right_first, new_offsets,
+            node_box_distances);
+      } else {
+        SearchChild(
+            node->right, split_dim, right_first, 0, new_offsets,
+            node_box_distances);
+        SearchChild(
+            node->left, split_dim, left_first, right_first, new_offsets,
+            node_box_distances);
+        SearchChild(
+            node->right, split_dim, 0, left_first, new_offsets,
+            node_box_distances);
+      }
+    }
+  }
+
+  //! \brief Visits \p child for the queries in \p near, for which it is the
+  //! first child, and for the queries in \p far that are within their search
+  //! distance of it.
+  inline void SearchChild(
+      NodeType const* const child,
+      Size const split_dim,
+      MaskType const near,
+      MaskType const far,
+      DistancesType const& new_offsets,
+      DistancesType const& node_box_distances) {
+    DistanceType* const offsets =
+        node_box_offsets_.data() + split_dim * kPacketSize;
+    MaskType mask = near;
+    DistancesType child_distances = node_box_distances;
+    DistancesType old_offsets;
+    MaskType visit_far = 0;
+    for (MaskType m = far; m != 0; m &= m - 1) {
+      Size const q = static_cast<Size>(CountTrailingZeros(m));
+      DistanceType const distance =
+          node_box_distances[q] - offsets[q] + new_offsets[q];
+      if (visitors_[q].max() >= distance) {
+        visit_far |= MaskType(1) << q;
+        child_distances[q] = distance;
+        old_offsets[q] = offsets[q];
+        offsets[q] = new_offsets[q];
+      }
+    }
+    mask |= visit_far;
+
+    if (mask != 0) {
+      SearchNearest(child, mask, child_distances);
+    }
+
+    for (MaskType m = visit_far; m != 0; m &= m - 1) {
+      Size const q = static_cast<Size>(CountTrailingZeros(m));
+      offsets[q] = old_offsets[q];
+    }
+  }
+
+  static inline int PopCount(MaskType m) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(m);
+#else
+    int count = 0;
+    for (; m != 0; m &= m - 1) {
+      ++count;
+    }
+    return count;
+#endif
+  }
+
+  static inline int CountTrailingZeros(MaskType m) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(m);
+#else
+    int count = 0;
+    for (; (m & 1) == 0; m >>= 1) {
+      ++count;
+    }
+    return count;
+#endif
+  }
+
+  SpaceWrapper_ space_;
+  Metric_ metric_;
+  std::pmr::vector<IndexType> const& indices_;
+  //! \brief Coordinates of the queries stored per dimension.
+  std::vector<ScalarType> coords_;
+  //! \brief Node box offsets of the queries stored per dimension.
+  std::vector<DistanceType> node_box_offsets_;
+  std::array<ScalarType const*, kPacketSize> queries_;
+  Visitor_* visitors_;
+};
+
+//! \brief This class provides a search nearest function for a batch of
+//! queries in a Euclidean space that interleaves the searches of up to \p
+//! InFlight_ queries.
+//! \details Each search is a state machine that is equivalent to
+//! SearchNearestEuclidean, with an explicit stack instead of recursion. A
+//! search yields each time it is about to load a node or the points of a leaf,
+//! after it issued a prefetch for them. The searches in flight are resumed in a
+//! round-robin fashion, such that the memory latency of one query is hidden by
+//! the work of the others. When a search finishes, its slot is refilled with
+//! the next query of the batch.
+//! <p/>
+//! The searches are independent: a query visits exactly the nodes it would
+//! visit by itself and reports to its own visitor.
+template <
+    typename SpaceWrapper_,
+    typename Metric_,
+    typename Visitor_,
+    typename Index_,
+    Size InFlight_>
+class SearchNearestEuclideanInterleaved {
+  static_assert(InFlight_ > 0, "IN_FLIGHT_MUST_BE_LARGER_THAN_0");
+
+ public:
+  using IndexType = Index_;
+  using ScalarType = typename SpaceWrapper_::ScalarType;
+  using DistanceType = MetricDistanceType<Metric_, ScalarType>;
+  //! \brief Node type supported by this SearchNearestEuclideanInterleaved.
+  using NodeType = KdTreeNodeEuclidean<IndexType, ScalarType>;
+  //! \brief Maximum number of queries that are searched at the same time.
+  static Size constexpr kInFlight = InFlight_;
+
+  inline SearchNearestEuclideanInterleaved(
+      SpaceWrapper_ space,
+      Metric_ metric,
+      std::pmr::vector<IndexType> const& indices)
+      : space_(space),
+        metric_(metric),
+        indices_(indices),
+        node_box_offsets_(space_.sdim() * kInFlight) {
+    for (Size s = 0; s < kInFlight; ++s) {
+      slots_[s].node_box_offset = node_box_offsets_.data() + s * space_.sdim();
+    }
+  }
+
+  //! \brief Search nearest neighbors starting from \p node for the \p count
+  //! queries in \p queries. The results of query i are reported to visitor
+  //! \p visitors[i].
+  inline void operator()(
+      NodeType const* const node,
+      ScalarType const* const* queries,
+      Visitor_* visitors,
+      Size const count) {
+    Size next = 0;
+    Size active = 0;
+    for (; active < kInFlight && next < count; ++active, ++next) {
+      Start(active, node, queries[next], visitors + next);
+    }
+
+    // Round-robin over the searches in flight. A finished search is replaced
+    // by the next query or, when there are none left, by the last search.
+    while (active > 0) {
+      for (Size s = 0; s < active;) {
+        if (Resume(slots_[s])) {
+          ++s;
+        } else if (next < count) {
+          Start(s, node, queries[next], visitors + next);
+          ++next;
+          ++s;
+        } else {
+          --active;
+          if (s != active) {
+            std::swap(slots_[s], slots_[active]);
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  //! \brief The actions of a search that are stored on its stack.
+  enum class Action {
+    //! \brief Visit a node.
+    kVisit,
+    //! \brief Visit the points of a leaf.
+    kLeaf,
+    //! \brief Visit the second child of a branch when it is within the
+    //! search distance.
+    kSecond,
+    //! \brief Restore a node box offset.
+    kRestore
+  };
+
+  struct Entry {
+    Action action;
+    Size split_dim;
+    NodeType const* node;
+    DistanceType node_box_distance;
+    DistanceType offset;
+  };
+
+  //! \brief The state of a search that is in flight.
+  struct Slot {
+    ScalarType const* query;
+    Visitor_* visitor;
+    DistanceType* node_box_offset;
+    std::vector<Entry> stack;
+  };
+
+  //! \brief Starts the search of \p query at \p node in slot \p s.
+  inline void Start(
+      Size const s,
+      NodeType const* const node,
+      ScalarType const* const query,
+      Visitor_* const visitor) {
+    Size const sdim = space_.sdim();
+    Slot& slot = slots_[s];
+    slot.query = query;
+    slot.visitor = visitor;
+    std::fill(
+        slot.node_box_offset, slot.node_box_offset + sdim, DistanceType(0.0));
+    slot.stack.clear();
+    slot.stack.push_back({Action::kVisit, 0, node, DistanceType(0.0), 0});
+    Prefetch(node);
+  }
+
+  //! \brief Continues the search of \p slot until it yields. Returns false
+  //! when the search is finished.
+  inline bool Resume(Slot& slot) {
+    auto& stack = slot.stack;
+    while (!stack.empty()) {
+      Entry const entry = stack.back();
+      stack.pop_back();
+      switch (entry.action) {
+        case Action::kVisit: {
+          NodeType const* const node = entry.node;
+          if (node->IsLeaf()) {
+            for (IndexType i = node->data.leaf.begin_idx;
+                 i < node->data.leaf.end_idx;
+                 ++i) {
+              Prefetch(space_[indices_[i]]);
+            }
+            stack.push_back({Action::kLeaf, 0, node, 0, 0});
+            return true;
+          }
+
+          // See SearchNearestEuclidean for the traversal order and the
+          // incremental node box distance.
+          Size const split_dim =
+              static_cast<Size>(node->data.branch.split_dim);
+          ScalarType const v = slot.query[split_dim];
+          NodeType const* node_1st;
+          NodeType const* node_2nd;
+          DistanceType new_offset;
+          if ((node->data.branch.left_max + node->data.branch.right_min - v -
+               v) > 0) {
+            node_1st = node->left;
+            node_2nd = node->right;
+            new_offset = CoordinateDistance(
+                metric_,
+                node->data.branch.right_min,
+                v,
+                node->data.branch.split_dim);
+          } else {
+            node_1st = node->right;
+            node_2nd = node->left;
+            new_offset = CoordinateDistance(
+                metric_,
+                node->data.branch.left_max,
+                v,
+                node->data.branch.split_dim);
+          }
+
+          stack.push_back(
+              {Action::kSecond,
+               split_dim,
+               node_2nd,
+               entry.node_box_distance,
+               new_offset});
+          stack.push_back(
+              {Action::kVisit, 0, node_1st, entry.node_box_distance, 0});
+          Prefetch(node_1st);
+          return true;
+        }
+        case Action::kLeaf: {
+          Size const sdim = space_.sdim();
+          NodeType const* const node = entry.node;
+          for (IndexType i = node->data.leaf.begin_idx;
+               i < node->data.leaf.end_idx;
+               ++i) {
+            (*slot.visitor)(
+                indices_[i],
+                metric_(slot.query, slot.query + sdim, space_[indices_[i]]));
+          }
+          break;
+        }
+        case Action::kSecond: {
+          DistanceType const old_offset =
+              slot.node_box_offset[entry.split_dim];
+          DistanceType const node_box_distance =
+              entry.node_box_distance - old_offset + entry.offset;
+          if (slot.visitor->max() >= node_box_distance) {
+            slot.node_box_offset[entry.split_dim] = entry.offset;
+            stack.push_back(
+                {Action::kRestore, entry.split_dim, nullptr, 0, old_offset});
+            stack.push_back(
+                {Action::kVisit, 0, entry.node, node_box_distance, 0});
+            Prefetch(entry.node);
+            return true;
+          }
+          break;
+        }
+        case Action::kRestore:
+          slot.node_box_offset[entry.split_dim] = entry.offset;
+          break;
+      }
+    }
+    return false;
+  }
+
+  SpaceWrapper_ space_;
+  Metric_ metric_;
+  std::pmr::vector<IndexType> const& indices_;
+  //! \brief Node box offsets of the searches in flight stored per search.
+  std::vector<DistanceType> node_box_offsets_;
+  std::array<Slot, kInFlight> slots_;
+};
+
+//! \brief Priority queue of the branches that still need to be visited by a
+//! best bin first search.
+//! \details A branch is pushed while descending from the branch that was
+//! popped last, during which the node box offsets don't change. Each branch
+//! therefore only stores the offset that differs from those of its parent
+//! branch, together with a link to that parent. The offsets are rebuilt from
+//! this chain when a branch is popped, so the incremental distance calculation
+//! remains exact. The memory used per branch doesn't depend on the dimension of
+//! the space.
+template <typename Node_, typename Distance_, Size Dim_>
+class BranchQueue {
+ public:
+  using NodeType = Node_;
+  using DistanceType = Distance_;
+  using PointType = Point<DistanceType, Dim_>;
+
+  //! \brief Constructs a BranchQueue that allocates its memory from \p
+  //! resource.
+  explicit BranchQueue(std::pmr::memory_resource* resource)
+      : queue_(Greater(), std::pmr::vector<Entry>(resource)),
+        links_(resource),
+        path_(resource) {}
+
+  //! \brief Returns true when there are no more branches to visit.
+  inline bool empty() const { return queue_.empty(); }
+
+  //! \brief Returns the distance of the closest branch.
+  inline DistanceType top_distance() const { return queue_.top().distance; }
+
+  //! \brief Adds \p node at distance \p distance. The offsets of the node box
+  //! equal those of the branch that was popped last, except for dimension \p
+  //! dim , which equals \p offset .
+  inline void Push(
+      DistanceType const distance,
+      NodeType const* const node,
+      Size const dim,
+      DistanceType const offset) {
+    queue_.push({distance, node, links_.size()});
+    links_.push_back({current_, dim, offset});
+  }
+
+  //! \brief Removes the closest branch and returns its node, distance and node
+  //! box offsets.
+  inline void Pop(
+      NodeType const*& node, DistanceType& distance, PointType& offsets) {
+    Entry const& top = queue_.top();
+    node = top.node;
+    distance = top.distance;
+    current_ = top.link;
+    queue_.pop();
+
+    // Changes are applied from the root down such that the offset of a
+    // dimension equals the one that was set last.
+    path_.clear();
+    for (Size l = current_; l != kNoLink; l = links_[l].parent) {
+      path_.push_back(l);
+    }
+    offsets.Fill(DistanceType(0.0));
+    for (auto l = path_.rbegin(); l != path_.rend(); ++l) {
+      offsets[links_[*l].dim] = links_[*l].offset;
+    }
+  }
+
+ private:
+  static Size constexpr kNoLink = static_cast<Size>(-1);
+
+  struct Entry {
+    DistanceType distance;
+    NodeType const* node;
+    Size link;
+  };
+
+  struct Link {
+    Size parent;
+    Size dim;
+    DistanceType offset;
+  };
+
+  struct Greater {
+    inline bool operator()(Entry const& a, Entry const& b) const {
+      return a.distance > b.distance;
+    }
+  };
+
+  std::priority_queue<Entry, std::pmr::vector<Entry>, Greater> queue_;
+  // The links of popped branches are kept because they may be the parents of
+  // branches that are still queued.
+  std::pmr::vector<Link> links_;
+  // Scratch space for rebuilding offsets. Its size is bounded by the height of
+  // the tree.
+  std::pmr::vector<Size> path_;
+  Size current_ = kNoLink;
+};
+
+//! \brief This class provides a best bin first search for Euclidean spaces
+//! that visits at most a fixed number of leaf nodes.
+//! \details J. S. Beis and D. G. Lowe, Shape indexing using approximate
+//! nearest-neighbour search in high-dimensional spaces, In CVPR, pp. 1000–1006,
+//! 1997.
+//! <p/>
+//! Branches that are not taken are stored in a priority queue and visited in
+//! order of increasing distance to the query point. The search stops when the
+//! closest remaining branch is farther away than visitor.max() or when \p
+//! max_leaves_visited leaf nodes have been visited. The former results in an
+//! exact search, the latter puts a hard bound on the query time.
+template <
+    typename SpaceWrapper_,
+    typename Metric_,
+    typename PointWrapper_,
+    typename Visitor_,
+    typename Index_>
+class BestBinFirstSearchEuclidean {
+ public:
+  using IndexType = Index_;
+  using ScalarType = typename SpaceWrapper_::ScalarType;
+  using DistanceType = MetricDistanceType<Metric_, ScalarType>;
+  using PointType = Point<DistanceType, SpaceWrapper_::Dim>;
+  //! \brief Node type supported by this BestBinFirstSearchEuclidean.
+  using NodeType = KdTreeNodeEuclidean<IndexType, ScalarType>;
+
+  inline BestBinFirstSearchEuclidean(
+      SpaceWrapper_ space,
+      Metric_ metric,
+      std::pmr::vector<IndexType> const& indices,
+      PointWrapper_ query,
+      Size max_leaves_visited,
+      Visitor_& visitor,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : space_(space),
+        metric_(metric),
+        indices_(indices),
+        query_(query),
+        max_leaves_visited_(max_leaves_visited),
+        node_box_offset_(PointType::FromSize(space_.sdim())),
+        queue_(resource),
+        visitor_(visitor) {}
+
+  //! \brief Search nearest neighbors starting from \p root_node.
+  inline void operator()(NodeType const* const root_node) {
+    queue_.Push(DistanceType(0.0), root_node, 0, DistanceType(0.0));
+
+    Size leaves_visited = 0;
+    while (!queue_.empty() && leaves_visited < max_leaves_visited_ &&
+           visitor_.max() >= queue_.top_distance()) {
+      NodeType const* node;
+      DistanceType node_box_distance;
+      queue_.Pop(node, node_box_distance, node_box_offset_);
+      SearchNearest(node, node_box_distance);
+      ++leaves_visited;
+    }
+  }
+
+ private:
+  //! \brief Descends to the closest leaf node of \p node while adding the
+  //! branches that are not taken to the queue.
+  inline void SearchNearest(
+      NodeType const* const node, DistanceType node_box_distance) {
+    if (node->IsLeaf()) {
+      for (IndexType i = node->data.leaf.begin_idx; i < node->data.leaf.end_idx;
+           ++i) {
+        visitor_(
+            indices_[i],
+            metric_(query_.begin(), query_.end(), space_[indices_[i]]));
+      }
+    } else {
+      ScalarType const v = query_[node->data.branch.split_dim];
+      DistanceType new_offset;
+      NodeType const* node_1st;
+      NodeType const* node_2nd;
+
+      // See SearchNearestEuclidean.
+      if ((node->data.branch.left_max + node->data.branch.right_min - v - v) >
+          0) {
+        node_1st = node->left;
+        node_2nd = node->right;
+        new_offset = CoordinateDistance(
+            metric_,
+            node->data.branch.right_min,
+            v,
+            node->data.branch.split_dim);
+      } else {
+        node_1st = node->right;
+        node_2nd = node->left;
+        new_offset = CoordinateDistance(
+            metric_,
+            node->data.branch.left_max,
+            v,
+            node->data.branch.split_dim);
+      }
+
+      // Only first children are visited directly. This means that the node
+      // box offsets remain unchanged during the entire descent.
+      SearchNearest(node_1st, node_box_distance);
+
+      node_box_distance = node_box_distance -
+                          node_box_offset_[node->data.branch.split_dim] +
+                          new_offset;
+
+      if (visitor_.max() >= node_box_distance) {
+        queue_.Push(
+            node_box_distance,
+            node_2nd,
+            static_cast<Size>(node->data.branch.split_dim),
+            new_offset);
+      }
+    }
+  }
+
+  SpaceWrapper_ space_;
+  Metric_ metric_;
+  std::pmr::vector<IndexType> const& indices_;
   PointWrapper_ query_;
+  Size max_leaves_visited_;
   PointType node_box_offset_;
+  BranchQueue<NodeType, DistanceType, SpaceWrapper_::Dim> queue_;
   Visitor_& visitor_;
 };
 
+//! \brief This class provides a best bin first search for topological spaces
+//! that visits at most a fixed number of leaf nodes.
+//! \see BestBinFirstSearchEuclidean
+template <
+    typename SpaceWrapper_,
+    typename Metric_,
+    typename PointWrapper_,
+    typename Visitor_,
+    typename Index_>
+class BestBinFirstSearchTopological {
+ public:
+  using IndexType = Index_;
+  using ScalarType = typename SpaceWrapper_::ScalarType;
+  using DistanceType = MetricDistanceType<Metric_, ScalarType>;
+  using PointType = Point<DistanceType, SpaceWrapper_::Dim>;
+  //! \brief Node type supported by this BestBinFirstSearchTopological.
+  using NodeType = KdTreeNodeTopological<IndexType, ScalarType>;
+
+  inline BestBinFirstSearchTopological(
+      SpaceWrapper_ space,
+      Metric_ metric,
+      std::pmr::vector<IndexType> const& indices,
+      PointWrapper_ query,
+      Size max_leaves_visited,
+      Visitor_& visitor,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : space_(space),
+        metric_(metric),
+        indices_(indices),
+        query_(query),
+        max_leaves_visited_(max_leaves_visited),
+        node_box_offset_(PointType::FromSize(space_.sdim())),
+        queue_(resource),
+        visitor_(visitor) {}
+
+  //! \brief Search nearest neighbors starting from \p root_node.
+  inline void operator()(NodeType const* const root_node) {
+    queue_.Push(DistanceType(0.0), root_node, 0, DistanceType(0.0));
+
+    Size leaves_visited = 0;
+    while (!queue_.empty() && leaves_visited < max_leaves_visited_ &&
+           visitor_.max() >= queue_.top_distance()) {
+      NodeType const* node;
+      DistanceType node_box_distance;
+      queue_.Pop(node, node_box_distance, node_box_offset_);
+      SearchNearest(node, node_box_distance);
+      ++leaves_visited;
+    }
+  }
+
+ private:
+  //! \brief Descends to the closest leaf node of \p node while adding the
+  //! branches that are not taken to the queue.
+  inline void SearchNearest(
+      NodeType const* const node, DistanceType node_box_distance) {
+    if (node->IsLeaf()) {
+      for (IndexType i = node->data.leaf.begin_idx; i < node->data.leaf.end_idx;
+           ++i) {
+        visitor_(
+            indices_[i],
+            metric_(query_.begin(), query_.end(), space_[indices_[i]]));
+      }
+    } else {
+      ScalarType const v = query_[node->data.branch.split_dim];
+      // Determine the distance to the boxes of the children of this node.
+      DistanceType const d1 = metric_(
+          v,
+          node->data.branch.left_min,
+          node->data.branch.left_max,
+          node->data.branch.split_dim);
+      DistanceType const d2 = metric_(
+          v,
+          node->data.branch.right_min,
+          node->data.branch.right_max,
+          node->data.branch.split_dim);
+      NodeType const* node_1st;
+      NodeType const* node_2nd;
+      DistanceType new_offset;
+
+      // Visit the closest child/box first.
+      if (d1 < d2) {
+        node_1st = node->left;
+        node_2nd = node->right;
+        new_offset = d2;
+      } else {
+        node_1st = node->right;
+        node_2nd = node->left;
+        new_offset = d1;
+      }
+
+      SearchNearest(node_1st, node_box_distance);
+
+      node_box_distance = node_box_distance -
+                          node_box_offset_[node->data.branch.split_dim] +
+                          new_offset;
+
+      if (visitor_.max() >= node_box_distance) {
+        queue_.Push(
+            node_box_distance,
+            node_2nd,
+            static_cast<Size>(node->data.branch.split_dim),
+            new_offset);
+      }
+    }
+  }
+
+  SpaceWrapper_ space_;
+  Metric_ metric_;
+  std::pmr::vector<IndexType> const& indices_;
+  PointWrapper_ query_;
+  Size max_leaves_visited_;
+  PointType node_box_offset_;
+  BranchQueue<NodeType, DistanceType, SpaceWrapper_::Dim> queue_;
+  Visitor_& visitor_;
+};
+
+//! \brief This class provides a search for all pairs of points of a Euclidean
+//! space that are within a radius of each other: a self-join.
+//! \details Both sides of the join traverse the same tree. A pair of nodes is
+//! skipped when the distance between their boxes is not within the radius. The
+//! self-join of a node is the self-join of each of its children and the join
+//! between them, such that each pair of points is found once.
+//! <p/>
+//! The distance between two boxes is that between the origin and the vector
+//! of gaps between the boxes. It is a lower bound of the distance between any
+//! pair of points of the boxes for each metric that only depends on the
+//! differences between coordinates.
+//! <p/>
+//! The search can be split into independent tasks that can be processed in
+//! parallel. Each task requires its own instance of this class.
+template <typename SpaceWrapper_, typename Metric_, typename Index_>
+class SearchAllRadiusEuclidean {
+ public:
+  using IndexType = Index_;
+  using ScalarType = typename SpaceWrapper_::ScalarType;
+  using DistanceType = MetricDistanceType<Metric_, ScalarType>;
+  static Size constexpr Dim = SpaceWrapper_::Dim;
+  using BoxType = Box<ScalarType, Dim>;
+  using PointType = Point<ScalarType, Dim>;
+  //! \brief Node type supported by this SearchAllRadiusEuclidean.
+  using NodeType = KdTreeNodeEuclidean<IndexType, ScalarType>;
+  using NeighborType = Neighbor<IndexType, DistanceType>;
+  //! \brief A pair of points (i, {j, distance}) with i < j.
+  using PairType = std::pair<IndexType, NeighborType>;
+
+  //! \brief The self-join of a node when node1 equals node2, or the join
+  //! between two different nodes otherwise.
+  struct Task {
+    NodeType const* node1;
+    NodeType const* node2;
+    BoxType box1;
+    BoxType box2;
+  };
+
+  inline SearchAllRadiusEuclidean(
+      SpaceWrapper_ space,
+      Metric_ metric,
+      std::pmr::vector<IndexType> const& indices,
+      DistanceType const radius)
+      : space_(space),
+        metric_(metric),
+        indices_(indices),
+        radius_(radius),
+        gap_(PointType::FromSize(space_.sdim())),
+        origin_(PointType::FromSize(space_.sdim())) {
+    origin_.Fill(ScalarType(0));
+  }
+
+  //! \brief Splits the self-join of \p root into at least \p min_task_count
+  //! tasks. There are fewer tasks when only joins of leaves remain.
+  inline std::vector<Task> Split(
+      NodeType const* const root,
+      BoxType const& root_box,
+      Size const min_task_count) {
+    std::vector<Task> tasks{{root, root, root_box, root_box}};
+    std::vector<Task> split;
+    bool changed = true;
+    while (changed && tasks.size() < min_task_count) {
+      changed = false;
+      split.clear();
+      for (auto const& task : tasks) {
+        changed |= Split(task, split);
+      }
+      std::swap(tasks, split);
+    }
+    return tasks;
+  }
+
+  //! \brief Stores all pairs of points of \p task that are within the radius
+  //! in \p pairs.
+  inline void operator()(Task const& task, std::vector<PairType>& pairs) {
+    BoxType box1 = task.box1;
+    if (task.node1 == task.node2) {
+      SelfJoin(task.node1, box1, pairs);
+    } else {
+      BoxType box2 = task.box2;
+      Join(task.node1, box1, task.node2, box2, pairs);
+    }
+  }
+
+ private:
+  //! \brief Stores the subtasks of \p task in \p split. Returns false if
+  //! the task could not be split and is stored as is.
+  inline bool Split(Task const& task, std::vector<Task>& split) {
+    NodeType const* const node1 = task.node1;
+    NodeType const* const node2 = task.node2;
+
+    if (node1 == node2) {
+      if (node1->IsLeaf()) {
+        split.push_back(task);
+        return false;
+      }
+
+      Size const dim = static_cast<Size>(node1->data.branch.split_dim);
+      BoxType left = task.box1;
+      BoxType right = task.box1;
+      left.max(dim) = node1->data.branch.left_max;
+      right.min(dim) = node1->data.branch.right_min;
+      split.push_back({node1->left, node1->left, left, left});
+      split.push_back({node1->right, node1->right, right, right});
+      if (BoxDistance(left, right) < radius_) {
+        split.push_back({node1->left, node1->right, left, right});
+      }
+      return true;
+    }
+
+    if (node1->IsLeaf() && node2->IsLeaf()) {
+      split.push_back(task);
+      return false;
+    }
+
+    // The node to split and the other node.
+    bool const first = SplitFirst(node1, task.box1, node2, task.box2);
+    NodeType const* const node = first ? node1 : node2;
+    BoxType const& box = first ? task.box1 : task.box2;
+    NodeType const* const other = first ? node2 : node1;
+    BoxType const& other_box = first ? task.box2 : task.box1;
+
+    Size const dim = static_cast<Size>(node->data.branch.split_dim);
+    BoxType left = box;
+    BoxType right = box;
+    left.max(dim) = node->data.branch.left_max;
+    right.min(dim) = node->data.branch.right_min;
+    if (BoxDistance(left, other_box) < radius_) {
+      split.push_back({node->left, other, left, other_box});
+    }
+    if (BoxDistance(right, other_box) < radius_) {
+      split.push_back({node->right, other, right, other_box});
+    }
+    return true;
+  }
+
+  //! \brief Stores all pairs of points of \p node that are within the radius.
+  //! \p box is restored before returning.
+  inline void SelfJoin(
+      NodeType const* const node, BoxType& box, std::vector<PairType>& pairs) {
+    if (node->IsLeaf()) {
+      IndexType const begin_idx = node->data.leaf.begin_idx;
+      IndexType const end_idx = node->data.leaf.end_idx;
+      for (IndexType i = begin_idx; i < end_idx; ++i) {
+        ScalarType const* const p = space_[indices_[i]];
+        for (IndexType j = i + 1; j < end_idx; ++j) {
+          Visit(indices_[i], p, indices_[j], pairs);
+        }
+      }
+      return;
+    }
+
+    Size const dim = static_cast<Size>(node->data.branch.split_dim);
+    BoxType left = box;
+    left.max(dim) = node->data.branch.left_max;
+    ScalarType const old_min = box.min(dim);
+    box.min(dim) = node->data.branch.right_min;
+
+    SelfJoin(node->left, left, pairs);
+    SelfJoin(node->right, box, pairs);
+    Join(node->left, left, node->right, box, pairs);
+
+    box.min(dim) = old_min;
+  }
+
+  //! \brief Stores all pairs of points between \p node1 and \p node2 that
+  //! are within the radius. Both boxes are restored before returning.
+  inline void Join(
+      NodeType const* const node1,
+      BoxType& box1,
+      NodeType const* const node2,
+      BoxType& box2,
+      std::vector<PairType>& pairs) {
+    if (!(BoxDistance(box1, box2) < radius_)) {
+      return;
+    }
+
+    if (node1->IsLeaf() && node2->IsLeaf()) {
+      IndexType const end_idx1 = node1->data.leaf.end_idx;
+      IndexType const begin_idx2 = node2->data.leaf.begin_idx;
+      IndexType const end_idx2 = node2->data.leaf.end_idx;
+      for (IndexType i = node1->data.leaf.begin_idx; i < end_idx1; ++i) {
+        ScalarType const* const p = space_[indices_[i]];
+        for (IndexType j = begin_idx2; j < end_idx2; ++j) {
+          Visit(indices_[i], p, indices_[j], pairs);
+        }
+      }
+      return;
+    }
+
+    if (!SplitFirst(node1, box1, node2, box2)) {
+      Join(node2, box2, node1, box1, pairs);
+      return;
+    }
+
+    Size const dim = static_cast<Size>(node1->data.branch.split_dim);
+    ScalarType const old_max = box1.max(dim);
+    box1.max(dim) = node1->data.branch.left_max;
+    Join(node1->left, box1, node2, box2, pairs);
+    box1.max(dim) = old_max;
+
+    ScalarType const old_min = box1.min(dim);
+    box1.min(dim) = node1->data.branch.right_min;
+    Join(node1->right, box1, node2, box2, pairs);
+    box1.min(dim) = old_min;
+  }
+
+  //! \brief Returns true if \p node1 should be split before \p node2. A
+  //! branch is split before a leaf. Otherwise the node of which the box is
+  //! widest along its split dimension is split first.
+  inline bool SplitFirst(
+      NodeType const* const node1,
+      BoxType const& box1,
+      NodeType const* const node2,
+      BoxType const& box2) const {
+    if (node1->IsLeaf()) {
+      return false;
+    }
+    if (node2->IsLeaf()) {
+      return true;
+    }
+    Size const dim1 = static_cast<Size>(node1->data.branch.split_dim);
+    Size const dim2 = static_cast<Size>(node2->data.branch.split_dim);
+    return (box1.max(dim1) - box1.min(dim1)) >=
+           (box2.max(dim2) - box2.min(dim2));
+  }
+
+  //! \brief Stores the pair of points \p idx1 and \p idx2 if they are within
+  //! the radius. \p p refers to the coordinates of \p idx1.
+  inline void Visit(
+      IndexType const idx1,
+      ScalarType const* const p,
+      IndexType const idx2,
+      std::vector<PairType>& pairs) const {
+    DistanceType const d = metric_(p, p + space_.sdim(), space_[idx2]);
+    if (radius_ > d) {
+      if (idx1 < idx2) {
+        pairs.push_back({idx1, {idx2, d}});
+      } else {
+        pairs.push_back({idx2, {idx1, d}});
+      }
+    }
+  }
+
+  //! \brief Returns the distance between \p box1 and \p box2.
+  inline DistanceType BoxDistance(BoxType const& box1, BoxType const& box2) {
+    Size const sdim = space_.sdim();
+    for (Size i = 0; i < sdim; ++i) {
+      // The boxes overlap when the largest minimum is smaller than or equal
+      // to the smallest maximum.
+      ScalarType const min = std::max(box1.min(i), box2.min(i));
+      ScalarType const max = std::min(box1.max(i), box2.max(i));
+      gap_[i] = min > max ? static_cast<ScalarType>(min - max) : ScalarType(0);
+    }
+    return metric_(gap_.data(), gap_.data() + sdim, origin_.data());
+  }
+
+  SpaceWrapper_ space_;
+  Metric_ metric_;
+  std::pmr::vector<IndexType> const& indices_;
+  DistanceType radius_;
+  PointType gap_;
+  PointType origin_;
+};
+
 //! \brief A functor that provides range searches for Euclidean spaces. Query
 //! time is bounded by O(n^(1-1/Dim)+k).
 //! \details Many tree nodes are excluded by checking if they intersect with the
@@ -235,7 +1432,7 @@ class SearchBoxEuclidean {
   inline SearchBoxEuclidean(
       SpaceWrapper_ space,
       Metric_ metric,
-      std::vector<IndexType> const& indices,
+      std::pmr::vector<IndexType> const& indices,
       BoxType const& root_box,
       BoxMapType const& query,
       std::vector<IndexType>& idxs)
@@ -333,7 +1530,7 @@ class SearchBoxEuclidean {
 
   SpaceWrapper_ space_;
   Metric_ metric_;
-  std::vector<IndexType> const& indices_;
+  std::pmr::vector<IndexType> const& indices_;
   // This variable is used for maintaining a running bounding box.
   BoxType box_;
   BoxMapType const& query_;
@@ -1,15 +1,24 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
 #include <type_traits>
 
 namespace pico_tree::internal {
 
-//! \brief An instance of ListPoolResource constructs fixed size chunks of
-//! memory and stores these in a list. Memory is only released when the resource
-//! is destructed or when calling the Release() method.
+//! \brief An instance of ListPoolResource constructs chunks of memory and
+//! stores these in a list. Memory is only released when the resource is
+//! destructed or when calling the Release() method.
 //! \details A ListPoolResource is mainly useful for monotonically constructing
 //! objects of a single type when the total number to be created cannot be known
-//! up front.
+//! up front. When it can be estimated, a single chunk of the estimated size can
+//! be allocated instead.
+//! <p/>
+//! All chunks are allocated from an upstream std::pmr::memory_resource. This
+//! allows a tree to be placed in memory such as huge pages, NUMA local memory
+//! or a shared memory segment.
 //! <p/>
 //! A previous memory manager implementation was based on the std::deque. The
 //! chunk size that it uses can vary across different implementations of the C++
@@ -29,19 +38,20 @@ class ListPoolResource {
 
   //! \brief Value type allocated by the ListPoolResource.
   using ValueType = T;
-  //! \brief Chunk type allocated by the ListPoolResource.
-  using Chunk = typename Node::Chunk;
 
  public:
   //! \brief ListPoolResource constructor.
-  ListPoolResource() : head_(nullptr) {}
+  explicit ListPoolResource(
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : upstream_(upstream), head_(nullptr) {}
 
   //! \brief A ListPoolResource instance cannot be copied.
   //! \details Just no!
   ListPoolResource(ListPoolResource const&) = delete;
 
   //! \private
-  ListPoolResource(ListPoolResource&& other) : head_(other.head_) {
+  ListPoolResource(ListPoolResource&& other)
+      : upstream_(other.upstream_), head_(other.head_) {
     // So we don't accidentally delete things twice.
     other.head_ = nullptr;
   }
@@ -51,6 +61,8 @@ class ListPoolResource {
 
   //! \private
   ListPoolResource& operator=(ListPoolResource&& other) {
+    Release();
+    upstream_ = other.upstream_;
     head_ = other.head_;
     other.head_ = nullptr;
     return *this;
@@ -59,12 +71,29 @@ class ListPoolResource {
   //! \brief ListPoolResource destructor.
   virtual ~ListPoolResource() { Release(); }
 
-  //! \brief Allocates a chunk of memory and returns a pointer to it.
-  inline Chunk* Allocate() {
-    Node* node = new Node;
-    node->prev = head_;
-    head_ = node;
-    return &head_->data;
+  //! \brief Allocates a chunk of memory for ChunkSize objects and returns a
+  //! pointer to the first one.
+  inline T* Allocate() { return Allocate(ChunkSize); }
+
+  //! \brief Allocates a chunk of memory for \p count objects and returns a
+  //! pointer to the first one.
+  //! \details The objects are default-initialized. Their lifetime begins
+  //! here, but because T is trivial their values are indeterminate and no
+  //! code is generated for them.
+  inline T* Allocate(std::size_t count) {
+    // The list node and the objects share a single allocation.
+    std::size_t const bytes = kDataOffset + count * sizeof(T);
+    void* memory = upstream_->allocate(bytes, kAlignment);
+    head_ = new (memory) Node{head_, bytes};
+    T* objects =
+        reinterpret_cast<T*>(static_cast<std::byte*>(memory) + kDataOffset);
+    std::uninitialized_default_construct_n(objects, count);
+    return count > 0 ? std::launder(objects) : objects;
+  }
+
+  //! \brief Returns the upstream memory resource.
+  inline std::pmr::memory_resource* upstream_resource() const {
+    return upstream_;
   }
 
   //! \brief Release all memory allocated by this ListPoolResource.
@@ -73,57 +102,99 @@ class ListPoolResource {
     // we hit a recursion limit depending on how many nodes are destructed.
     while (head_ != nullptr) {
       Node* node = head_->prev;
-      delete head_;
+      upstream_->deallocate(head_, head_->bytes, kAlignment);
       head_ = node;
     }
   }
 
  private:
+  static std::size_t constexpr kAlignment =
+      alignof(T) > alignof(Node) ? alignof(T) : alignof(Node);
+  //! \brief Offset of the first object from the start of a chunk.
+  static std::size_t constexpr kDataOffset =
+      (sizeof(Node) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+  std::pmr::memory_resource* upstream_;
   Node* head_;
 };
 
-//! \brief Node containing a chunk of memory.
+//! \brief List node that precedes each chunk of memory.
 template <typename T, std::size_t ChunkSize>
 struct ListPoolResource<T, ChunkSize>::Node {
-  //! \brief Chunk type allocated by the ListPoolResource.
-  using Chunk = std::array<T, ChunkSize>;
-
   Node* prev;
-  Chunk data;
+  std::size_t bytes;
 };
 
 //! \brief An instance of ChunkAllocator constructs objects. It does so in
 //! chunks of size ChunkSize to reduce memory fragmentation.
+//! \details When the number of objects is known or can be estimated up front,
+//! the memory for all of them can be reserved using a single allocation.
+//! Chunks of size ChunkSize are only allocated once the reserved memory runs
+//! out.
 template <typename T, std::size_t ChunkSize>
 class ChunkAllocator final {
  private:
   using Resource = ListPoolResource<T, ChunkSize>;
-  using Chunk = typename Resource::Chunk;
 
  public:
   //! \brief Value type allocated by the ChunkAllocator.
   using ValueType = T;
 
-  //! \brief ChunkAllocator constructor.
-  ChunkAllocator() : object_index_(ChunkSize) {}
+  //! \brief Constructs a ChunkAllocator that allocates its memory from
+  //! \p resource .
+  explicit ChunkAllocator(
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : resource_(resource),
+        chunk_(nullptr),
+        chunk_size_(0),
+        object_index_(0),
+        capacity_(0) {}
+
+  //! \brief Constructs a ChunkAllocator that reserves memory for \p capacity
+  //! objects using a single allocation from \p resource .
+  explicit ChunkAllocator(
+      std::size_t capacity,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : ChunkAllocator(resource) {
+    if (capacity > 0) {
+      AllocateChunk(capacity);
+    }
+  }
 
   //! \brief Create an object of type T and return a pointer to it.
   inline T* Allocate() {
-    if (object_index_ == ChunkSize) {
-      chunk_ = resource_.Allocate();
-      object_index_ = 0;
+    if (object_index_ == chunk_size_) {
+      AllocateChunk(ChunkSize);
     }
 
-    T* object = &(*chunk_)[object_index_];
+    T* object = chunk_ + object_index_;
     object_index_++;
 
     return object;
   }
 
+  //! \brief Returns the number of objects that can be created without
+  //! allocating more memory, including those created.
+  inline std::size_t capacity() const { return capacity_; }
+
+  //! \brief Returns the memory resource used by the ChunkAllocator.
+  inline std::pmr::memory_resource* resource() const {
+    return resource_.upstream_resource();
+  }
+
  private:
+  inline void AllocateChunk(std::size_t size) {
+    chunk_ = resource_.Allocate(size);
+    chunk_size_ = size;
+    object_index_ = 0;
+    capacity_ += size;
+  }
+
   Resource resource_;
+  T* chunk_;
+  std::size_t chunk_size_;
   std::size_t object_index_;
-  Chunk* chunk_;
+  std::size_t capacity_;
 };
 
 }  // namespace pico_tree::internal
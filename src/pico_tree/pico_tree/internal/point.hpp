@@ -4,6 +4,7 @@
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <memory_resource>
 #include <vector>
 
 #include "pico_tree/core.hpp"
@@ -24,10 +25,11 @@ struct PointStorageTraits {
 };
 
 //! \details The specialized class doesn't knows its dimension at compile-time
-//! and uses an std::vector for storing its data so it can be resized.
+//! and uses an std::pmr::vector for storing its data so it can be resized. Its
+//! memory is allocated from std::pmr::get_default_resource().
 template <typename Scalar_>
 struct PointStorageTraits<Scalar_, kDynamicSize> {
-  using Type = std::vector<Scalar_>;
+  using Type = std::pmr::vector<Scalar_>;
 
   static constexpr auto FromSize(Size size) { return Type(size); }
 };
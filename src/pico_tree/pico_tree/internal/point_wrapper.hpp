@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cassert>
+
 #include "pico_tree/core.hpp"
 #include "pico_tree/point_traits.hpp"
 
@@ -11,13 +13,19 @@ namespace pico_tree::internal {
 //! \details The internals of PicoTree never use the specializations of the
 //! PointTraits class directly, but interface with any point type through this
 //! wrapper interface.
-template <typename Point_>
+//! <p/>
+//! The dimension of a point can be overridden by \p Dim_. A search structure
+//! of which the dimension is known at compile-time passes its dimension, such
+//! that distances to points with a run-time dimension are computed by loops
+//! of a fixed length that the compiler unrolls.
+template <typename Point_, Size Dim_ = PointTraits<Point_>::Dim>
 class PointWrapper {
   using PointTraitsType = PointTraits<Point_>;
   using PointType = Point_;
   using ScalarType = typename PointTraitsType::ScalarType;
   using SizeType = Size;
-  static SizeType constexpr Dim = PointTraitsType::Dim;
+  static SizeType constexpr Dim =
+      Dim_ != kDynamicSize ? Dim_ : PointTraitsType::Dim;
 
   inline ScalarType const* data() const {
     return PointTraitsType::data(point_);
@@ -32,7 +40,11 @@ class PointWrapper {
   }
 
  public:
-  inline explicit PointWrapper(PointType const& point) : point_(point) {}
+  inline explicit PointWrapper(PointType const& point) : point_(point) {
+    if constexpr (Dim != kDynamicSize) {
+      assert(Dim == PointTraitsType::size(point_));
+    }
+  }
 
   inline ScalarType const& operator[](std::size_t index) const {
     return data()[index];
@@ -0,0 +1,19 @@
+#pragma once
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+namespace pico_tree::internal {
+
+//! \brief Hints the processor to load the cache line of \p address for
+//! reading. It does nothing on unsupported compilers.
+inline void Prefetch([[maybe_unused]] void const* address) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  _mm_prefetch(static_cast<char const*>(address), _MM_HINT_T0);
+#endif
+}
+
+}  // namespace pico_tree::internal
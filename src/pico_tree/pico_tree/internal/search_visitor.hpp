@@ -2,6 +2,9 @@
 
 #include <algorithm>
 #include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
 
 #include "pico_tree/core.hpp"
 
@@ -116,6 +119,11 @@ class SearchKnn {
   //! \brief Maximum search distance with respect to the query point.
   inline ScalarType max() const { return std::prev(end_)->distance; }
 
+  //! \brief Returns the end of the range of neighbors found so far. It only
+  //! differs from the end of the output range when fewer than k points were
+  //! visited.
+  inline RandomAccessIterator_ active_end() const { return active_end_; }
+
  private:
   RandomAccessIterator_ begin_;
   RandomAccessIterator_ end_;
@@ -155,6 +163,41 @@ class SearchRadius {
   std::vector<NeighborType>& n_;
 };
 
+//! \brief Search visitor for finding the pairs of points that are within a
+//! radius of each other.
+//! \details The visitor belongs to a single query point, which is the first
+//! point of each pair. Pairs are appended to the output vector.
+template <typename Neighbor_>
+class SearchRadiusPairs {
+ public:
+  using NeighborType = Neighbor_;
+  using IndexType = typename Neighbor_::IndexType;
+  using ScalarType = typename Neighbor_::ScalarType;
+  using PairType = std::pair<IndexType, NeighborType>;
+
+  //! \private
+  inline SearchRadiusPairs(
+      ScalarType const radius,
+      IndexType const query_idx,
+      std::vector<PairType>& pairs)
+      : radius_{radius}, query_idx_{query_idx}, pairs_{pairs} {}
+
+  //! \brief Visit current point.
+  inline void operator()(IndexType const idx, ScalarType const dst) const {
+    if (max() > dst) {
+      pairs_.push_back({query_idx_, {idx, dst}});
+    }
+  }
+
+  //! \brief Maximum search distance with respect to the query point.
+  inline ScalarType max() const { return radius_; }
+
+ private:
+  ScalarType radius_;
+  IndexType query_idx_;
+  std::vector<PairType>& pairs_;
+};
+
 //! \brief Search visitor for finding an approximate nearest neighbor.
 //! \details Tree nodes are skipped by scaling down the search distance,
 //! possibly not visiting the true nearest neighbor. An approximate nearest
@@ -285,4 +328,85 @@ class SearchApproximateRadius {
   std::vector<NeighborType>& n_;
 };
 
+//! \brief Search visitor adaptor that ends a search once its SearchBudget is
+//! spent.
+//! \details The budget is consumed by the filter returned by filter(), which
+//! the search calls right before each distance evaluation. When the budget
+//! denies an evaluation, max() drops below any distance and the traversal
+//! unwinds without descending into other nodes. The search was exact when no
+//! evaluation got denied.
+template <typename Visitor_>
+class SearchBudgeted {
+ public:
+  using ScalarType =
+      std::decay_t<decltype(std::declval<Visitor_ const&>().max())>;
+
+  //! \brief Index filter that consumes the budget of a SearchBudgeted.
+  class Filter {
+   public:
+    //! \private
+    inline explicit Filter(SearchBudgeted& budgeted) : budgeted_(budgeted) {}
+
+    //! \brief Returns true if a distance may still be calculated.
+    template <typename Index_>
+    inline bool operator()(Index_) const {
+      return budgeted_.Consume();
+    }
+
+   private:
+    SearchBudgeted& budgeted_;
+  };
+
+  //! \private
+  inline SearchBudgeted(Visitor_& visitor, SearchBudget const& budget)
+      : visitor_(visitor),
+        budget_(budget),
+        evaluations_(0),
+        exhausted_(false) {}
+
+  //! \brief Visit current point.
+  template <typename Index_>
+  inline void operator()(Index_ const idx, ScalarType const dst) {
+    visitor_(idx, dst);
+  }
+
+  //! \brief Maximum search distance with respect to the query point.
+  inline ScalarType max() const {
+    return exhausted_ ? std::numeric_limits<ScalarType>::lowest()
+                      : visitor_.max();
+  }
+
+  //! \brief Returns the filter that consumes the budget.
+  inline Filter filter() { return Filter(*this); }
+
+  //! \brief Returns true if the search ended because the budget was spent.
+  inline bool exhausted() const { return exhausted_; }
+
+ private:
+  //! \brief Reading the clock costs about as much as a few distance
+  //! evaluations. It is only read once per this many evaluations.
+  static Size constexpr kClockCheckInterval = 32;
+
+  inline bool Consume() {
+    if (exhausted_) {
+      return false;
+    }
+
+    if (evaluations_ == budget_.max_distance_evaluations ||
+        (evaluations_ % kClockCheckInterval == 0 &&
+         SearchBudget::ClockType::now() >= budget_.deadline)) {
+      exhausted_ = true;
+      return false;
+    }
+
+    ++evaluations_;
+    return true;
+  }
+
+  Visitor_& visitor_;
+  SearchBudget budget_;
+  Size evaluations_;
+  bool exhausted_;
+};
+
 }  // namespace pico_tree::internal
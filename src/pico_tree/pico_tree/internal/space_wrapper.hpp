@@ -15,12 +15,12 @@ namespace pico_tree::internal {
 template <typename Space_>
 class SpaceWrapper {
   using SpaceTraitsType = SpaceTraits<Space_>;
-  using SpaceType = Space_;
   using PointType = typename SpaceTraitsType::PointType;
   using PointTraitsType = PointTraits<PointType>;
   using SizeType = Size;
 
  public:
+  using SpaceType = Space_;
   using ScalarType = typename SpaceTraitsType::ScalarType;
   static SizeType constexpr Dim = SpaceTraitsType::Dim;
 
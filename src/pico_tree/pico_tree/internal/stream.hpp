@@ -36,9 +36,10 @@ class Stream {
   //! \brief Reads a vector of values from the stream.
   //! \details Reads the size of the vector followed by all its elements.
   //! \tparam T Type of a value.
-  template <typename T>
-  inline void Read(std::vector<T>& values) {
-    typename std::vector<T>::size_type size;
+  //! \tparam Allocator_ Allocator type of the vector.
+  template <typename T, typename Allocator_>
+  inline void Read(std::vector<T, Allocator_>& values) {
+    typename std::vector<T, Allocator_>::size_type size;
     Read(size);
     values.resize(size);
     Read(size, values.data());
@@ -61,8 +62,9 @@ class Stream {
   //! \brief Writes a vector of values to the stream.
   //! \details Writes the size of the vector followed by all its elements.
   //! \tparam T Type of a value.
-  template <typename T>
-  inline void Write(std::vector<T> const& values) {
+  //! \tparam Allocator_ Allocator type of the vector.
+  template <typename T, typename Allocator_>
+  inline void Write(std::vector<T, Allocator_> const& values) {
     Write(values.size());
     stream_.write(
         reinterpret_cast<char const*>(&values[0]), sizeof(T) * values.size());
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PICO_TREE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "pico_tree/core.hpp"
+
+//! \file uint8_distance.hpp
+//! \brief Distance kernels for points with std::uint8_t coordinates.
+//! \details Byte sized coordinates are common for image and feature descriptor
+//! data sets such as MNIST and SIFT. Their distances are accumulated in int.
+//! Depending on the instruction set targeted by the compiler, 32 (AVX2) or 16
+//! (SSE2) coordinates are processed per iteration. With 8-bit coordinates, the
+//! sum of squared differences of up to 33025 dimensions fits an int.
+
+namespace pico_tree::internal {
+
+//! \brief True if \p Iterator_ is a pointer to std::uint8_t coordinates.
+template <typename Iterator_>
+inline constexpr bool kIsUint8Pointer =
+    std::is_pointer_v<Iterator_> &&
+    std::is_same_v<
+        std::remove_cv_t<std::remove_pointer_t<Iterator_>>,
+        std::uint8_t>;
+
+#if defined(__AVX2__)
+
+//! \brief Returns the sum of the 8 int lanes of \p v.
+inline int HorizontalSumEpi32(__m256i v) {
+  __m128i s = _mm_add_epi32(
+      _mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(s);
+}
+
+#elif defined(PICO_TREE_SSE2)
+
+//! \brief Returns the sum of the 4 int lanes of \p v.
+inline int HorizontalSumEpi32(__m128i s) {
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(s);
+}
+
+#endif
+
+//! \brief Calculates the sum of absolute differences between the \p n
+//! coordinates of \p a and \p b.
+inline int SumAbsoluteDifferences(
+    std::uint8_t const* a, std::uint8_t const* b, Size const n) {
+  Size i = 0;
+  int d = 0;
+#if defined(__AVX2__)
+  // The sad instruction sums groups of 8 absolute differences into 64-bit
+  // lanes. Each lane stays far below 2^31.
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 32 <= n; i += 32) {
+    __m256i const va =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+    __m256i const vb =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+  }
+  d = HorizontalSumEpi32(acc);
+#elif defined(PICO_TREE_SSE2)
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i const va = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+    __m128i const vb = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + i));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+  }
+  d = HorizontalSumEpi32(acc);
+#endif
+  for (; i < n; ++i) {
+    d += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+  }
+  return d;
+}
+
+//! \brief Calculates the sum of squared differences between the \p n
+//! coordinates of \p a and \p b.
+inline int SumSquaredDifferences(
+    std::uint8_t const* a, std::uint8_t const* b, Size const n) {
+  Size i = 0;
+  int d = 0;
+#if defined(__AVX2__)
+  // The absolute differences are computed using saturated subtractions. They
+  // get widened to 16 bits and madd squares and pairwise sums them into int.
+  __m256i const zero = _mm256_setzero_si256();
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 32 <= n; i += 32) {
+    __m256i const va =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+    __m256i const vb =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i));
+    __m256i const vd =
+        _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+    __m256i const lo = _mm256_unpacklo_epi8(vd, zero);
+    __m256i const hi = _mm256_unpackhi_epi8(vd, zero);
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(lo, lo));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(hi, hi));
+  }
+  d = HorizontalSumEpi32(acc);
+#elif defined(PICO_TREE_SSE2)
+  __m128i const zero = _mm_setzero_si128();
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i const va = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+    __m128i const vb = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + i));
+    __m128i const vd =
+        _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+    __m128i const lo = _mm_unpacklo_epi8(vd, zero);
+    __m128i const hi = _mm_unpackhi_epi8(vd, zero);
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(lo, lo));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(hi, hi));
+  }
+  d = HorizontalSumEpi32(acc);
+#endif
+  for (; i < n; ++i) {
+    int const t = static_cast<int>(a[i]) - static_cast<int>(b[i]);
+    d += t * t;
+  }
+  return d;
+}
+
+}  // namespace pico_tree::internal
+
+#undef PICO_TREE_SSE2
@@ -1,11 +1,21 @@
 #pragma once
 
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory_resource>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include "pico_tree/internal/box.hpp"
 #include "pico_tree/internal/kd_tree_builder.hpp"
 #include "pico_tree/internal/kd_tree_search.hpp"
 #include "pico_tree/internal/point_wrapper.hpp"
 #include "pico_tree/internal/search_visitor.hpp"
 #include "pico_tree/internal/space_wrapper.hpp"
+#include "pico_tree/map_traits.hpp"
 
 namespace pico_tree {
 
@@ -29,6 +39,8 @@ class KdTree {
   using BuildKdTreeType =
       internal::BuildKdTree<NodeType, SpaceWrapperType::Dim, SplittingRule_>;
   using KdTreeDataType = typename BuildKdTreeType::KdTreeDataType;
+  //! \brief Size in bytes of the stack buffer used by a best bin first search.
+  static std::size_t constexpr kBranchQueueBufferSize = 4096;
 
  public:
   //! \brief Size type.
@@ -44,8 +56,11 @@ class KdTree {
   using SpaceType = Space_;
   //! \brief The metric used for various searches.
   using MetricType = Metric_;
+  //! \brief Distance type. It equals ScalarType unless the metric computes
+  //! distances in a wider type, such as int for std::uint8_t coordinates.
+  using DistanceType = internal::MetricDistanceType<Metric_, ScalarType>;
   //! \brief Neighbor type of various search resuls.
-  using NeighborType = Neighbor<IndexType, ScalarType>;
+  using NeighborType = Neighbor<IndexType, DistanceType>;
 
   //! \brief Creates a KdTree given \p space and \p max_leaf_size.
   //! \details The KdTree takes \p space by value. This allows it to take
@@ -60,16 +75,60 @@ class KdTree {
   //!
   //! \param space The input point set.
   //! \param max_leaf_size The maximum number of points allowed in a leaf node.
-  KdTree(SpaceType space, SizeType max_leaf_size)
+  //! \param options Tunable parameters of the splitting rule.
+  //! \param resource The memory resource from which the indices and nodes of
+  //! the tree are allocated. It should outlive the KdTree.
+  KdTree(
+      SpaceType space,
+      SizeType max_leaf_size,
+      SplittingRuleOptions const& options = SplittingRuleOptions(),
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
       : space_(std::move(space)),
         metric_(),
-        data_(BuildKdTreeType()(SpaceWrapperType(space_), max_leaf_size)) {}
+        data_(BuildKdTreeType()(
+            SpaceWrapperType(space_), max_leaf_size, options, resource)) {}
+
+  //! \brief Creates a KdTree given \p space, \p max_leaf_size and \p metric.
+  //! \details A metric that has a state, such as WeightedL2Squared, is passed
+  //! to the tree using this constructor.
+  //! \see KdTree::KdTree
+  KdTree(
+      SpaceType space,
+      SizeType max_leaf_size,
+      MetricType metric,
+      SplittingRuleOptions const& options = SplittingRuleOptions(),
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : space_(std::move(space)),
+        metric_(std::move(metric)),
+        data_(BuildKdTreeType()(
+            SpaceWrapperType(space_), max_leaf_size, options, resource)) {}
+
+  //! \brief Creates a KdTree given \p space and \p max_leaf_size. The indices
+  //! and nodes of the tree are allocated from \p resource.
+  KdTree(
+      SpaceType space,
+      SizeType max_leaf_size,
+      std::pmr::memory_resource* resource)
+      : KdTree(
+            std::move(space),
+            max_leaf_size,
+            SplittingRuleOptions(),
+            resource) {}
 
   //! \brief The KdTree cannot be copied.
   //! \details The KdTree uses pointers to nodes and copying pointers is not
   //! the same as creating a deep copy.
   KdTree(KdTree const&) = delete;
 
+  //! \brief Creates a deep copy of \p other of which the indices and nodes are
+  //! allocated from \p resource.
+  //! \details The point set is copied as a SpaceType. A copy of an
+  //! std::reference_wrapper<SpaceType> refers to the same points.
+  KdTree(KdTree const& other, std::pmr::memory_resource* resource)
+      : space_(other.space_),
+        metric_(other.metric_),
+        data_(other.data_.Clone(resource)) {}
+
   //! \brief Move constructor of the KdTree.
   KdTree(KdTree&&) = default;
 
@@ -83,8 +142,162 @@ class KdTree {
   //! on their selection by visitor \p visitor .
   template <typename P, typename V>
   inline void SearchNearest(P const& x, V& visitor) const {
-    internal::PointWrapper<P> p(x);
-    SearchNearest(p, visitor, typename Metric_::SpaceTag());
+    internal::PointWrapper<P, Dim> p(x);
+    SearchNearest(
+        p, internal::AcceptAll(), visitor, typename Metric_::SpaceTag());
+  }
+
+  //! \brief Returns the nearest neighbor (or neighbors) of point \p x depending
+  //! on their selection by visitor \p visitor . Only points for which \p
+  //! filter returns true are visited.
+  //! \details The filter is called with the index of a point and is evaluated
+  //! inside the leaf nodes before the distance to the point is calculated.
+  //! Points that are rejected are never passed to the visitor. Like the
+  //! predicates of the standard library algorithms, \p filter is copied.
+  //! \code{.cpp}
+  //! // Only visit points that share the label of interest.
+  //! auto filter = [&labels, label](IndexType i) {
+  //!   return labels[i] == label;
+  //! };
+  //! \endcode
+  template <typename P, typename F, typename V>
+  inline void SearchNearestIf(P const& x, F filter, V& visitor) const {
+    internal::PointWrapper<P, Dim> p(x);
+    SearchNearest(p, filter, visitor, typename Metric_::SpaceTag());
+  }
+
+  //! \brief Returns the nearest neighbor (or neighbors) of point \p x depending
+  //! on their selection by visitor \p visitor . Only points for which \p
+  //! filter returns true are visited and only nodes of which the summary is
+  //! accepted by \p summary_filter are descended into.
+  //! \details The summary filter should return false only when none of the
+  //! points of a node can pass \p filter. Whole subtrees that can't contain a
+  //! match are then skipped without evaluating the filter for their points.
+  //! \code{.cpp}
+  //! // Labels are less than 64, such that a label set fits in a bit mask.
+  //! auto summaries = tree.Summarize(
+  //!     [&labels](IndexType const* begin, IndexType const* end) {
+  //!       std::uint64_t mask = 0;
+  //!       for (; begin != end; ++begin) {
+  //!         mask |= std::uint64_t(1) << labels[*begin];
+  //!       }
+  //!       return mask;
+  //!     });
+  //! auto summary_filter = [label](std::uint64_t mask) {
+  //!   return (mask >> label) & 1;
+  //! };
+  //! tree.SearchNearestIf(p, filter, summaries, summary_filter, visitor);
+  //! \endcode
+  //! \see template <typename F> auto Summarize(F) const
+  template <typename P, typename F, typename S, typename G, typename V>
+  inline void SearchNearestIf(
+      P const& x,
+      F filter,
+      NodeSummaries<S> const& summaries,
+      G summary_filter,
+      V& visitor) const {
+    internal::PointWrapper<P, Dim> p(x);
+    SearchNearest(
+        p,
+        filter,
+        visitor,
+        typename Metric_::SpaceTag(),
+        internal::AcceptSummaries<S, G>(summaries, summary_filter));
+  }
+
+  //! \brief Returns a summary of the points of each node of the tree.
+  //! \details The summary of a node is the result of calling \p summarize with
+  //! the range [begin, end) of the indices of the points of that node, where
+  //! begin and end are of type IndexType const*. Its result type should be
+  //! default constructible. The points of a node are contiguous in the index
+  //! order of the tree, such that a summary is computed without copying
+  //! indices. Summaries are used to skip subtrees of filtered searches.
+  //! <p/>
+  //! Each index is visited once for every node that contains it. For a
+  //! balanced tree, computing all summaries visits O(n log n) indices.
+  //! Summaries that can be merged are computed in O(n) time by
+  //! Summarize(F, C).
+  //! \see template <typename P, typename F, typename S, typename G, typename V>
+  //! void SearchNearestIf(P const&, F, NodeSummaries<S> const&, G, V&) const
+  template <typename F>
+  inline auto Summarize(F summarize) const {
+    using SummaryType = std::decay_t<
+        std::invoke_result_t<F&, IndexType const*, IndexType const*>>;
+    auto combine = [&summarize](
+                       SummaryType const&,
+                       SummaryType const&,
+                       IndexType const* begin,
+                       IndexType const* end) { return summarize(begin, end); };
+    NodeSummaries<SummaryType> summaries;
+    Summarize(data_.root_node, summarize, combine, summaries);
+    return summaries;
+  }
+
+  //! \brief Returns a summary of the points of each node of the tree.
+  //! \details The summary of a leaf node is the result of calling \p
+  //! summarize with the range of the indices of its points. The summary of a
+  //! branch node is the result of calling \p combine with the summaries of its
+  //! left and right child, such that each point is visited only once.
+  //! \code{.cpp}
+  //! auto combine = [](std::uint64_t left, std::uint64_t right) {
+  //!   return left | right;
+  //! };
+  //! auto summaries = tree.Summarize(summarize, combine);
+  //! \endcode
+  //! \see template <typename F> auto Summarize(F) const
+  template <typename F, typename C>
+  inline auto Summarize(F summarize, C combine) const {
+    using SummaryType = std::decay_t<
+        std::invoke_result_t<F&, IndexType const*, IndexType const*>>;
+    auto combine_children = [&combine](
+                                SummaryType const& left,
+                                SummaryType const& right,
+                                IndexType const*,
+                                IndexType const*) {
+      return combine(left, right);
+    };
+    NodeSummaries<SummaryType> summaries;
+    Summarize(data_.root_node, summarize, combine_children, summaries);
+    return summaries;
+  }
+
+  //! \brief Returns the nearest neighbor (or neighbors) of point \p x depending
+  //! on their selection by visitor \p visitor . At most \p max_leaves_visited
+  //! leaf nodes are visited.
+  //! \details Leaf nodes are visited in order of increasing distance to the
+  //! query point (best bin first). This puts a hard bound on the query time at
+  //! the cost of possibly not finding the true nearest neighbors. The search
+  //! is exact when it terminates before reaching \p max_leaves_visited.
+  template <typename P, typename V>
+  inline void SearchNearest(
+      P const& x,
+      MaxLeavesVisited const& max_leaves_visited,
+      V& visitor) const {
+    internal::PointWrapper<P, Dim> p(x);
+    SearchNearest(
+        p, max_leaves_visited, visitor, typename Metric_::SpaceTag());
+  }
+
+  //! \brief Returns the nearest neighbor (or neighbors) of point \p x depending
+  //! on their selection by visitor \p visitor while staying within \p budget.
+  //! \details Once the budget is spent, no more distances are calculated and
+  //! the search returns with the best result found so far. This allows a
+  //! search to degrade gracefully when it is short on time.
+  //! \code{.cpp}
+  //! SearchBudget budget;
+  //! budget.deadline =
+  //!     SearchBudget::ClockType::now() + std::chrono::microseconds(500);
+  //! bool exact = tree.SearchNn(p, budget, nn);
+  //! \endcode
+  //! \returns True if the result is exact. False if the budget was spent
+  //! before the search could finish.
+  template <typename P, typename V>
+  inline bool SearchNearest(
+      P const& x, SearchBudget const& budget, V& visitor) const {
+    internal::PointWrapper<P, Dim> p(x);
+    internal::SearchBudgeted<V> v(visitor, budget);
+    SearchNearest(p, v.filter(), v, typename Metric_::SpaceTag());
+    return !v.exhausted();
   }
 
   //! \brief Searches for the nearest neighbor of point \p x.
@@ -96,6 +309,33 @@ class KdTree {
     SearchNearest(x, v);
   }
 
+  //! \brief Searches for the nearest neighbor of point \p x while staying
+  //! within \p budget.
+  //! \details When the budget is spent before any distance was calculated, the
+  //! distance of \p nn equals std::numeric_limits<DistanceType>::max().
+  //! \returns True if \p nn is the exact nearest neighbor.
+  //! \see template <typename P, typename V> bool SearchNearest(P const&,
+  //! SearchBudget const&, V&) const
+  template <typename P>
+  inline bool SearchNn(
+      P const& x, SearchBudget const& budget, NeighborType& nn) const {
+    internal::SearchNn<NeighborType> v(nn);
+    return SearchNearest(x, budget, v);
+  }
+
+  //! \brief Searches for the nearest neighbor of point \p x while visiting at
+  //! most \p max_leaves_visited leaf nodes.
+  //! \see template <typename P, typename V> void SearchNearest(P const&,
+  //! MaxLeavesVisited const&, V&) const
+  template <typename P>
+  inline void SearchNn(
+      P const& x,
+      MaxLeavesVisited const& max_leaves_visited,
+      NeighborType& nn) const {
+    internal::SearchNn<NeighborType> v(nn);
+    SearchNearest(x, max_leaves_visited, v);
+  }
+
   //! \brief Searches for the approximate nearest neighbor of point \p x.
   //! \details Nodes in the tree are skipped by scaling down the search
   //! distance and as a result the true nearest neighbor may not be found. An
@@ -114,20 +354,33 @@ class KdTree {
   //! // A max error of 15%. I.e. max 15% farther away from the true nn.
   //! ScalarType max_error = ScalarType(0.15);
   //! ScalarType e = tree.metric()(ScalarType(1.0) + max_error);
-  //! Neighbor<IndexType, ScalarType> nn;
+  //! Neighbor<IndexType, DistanceType> nn;
   //! tree.SearchNn(p, e, nn);
   //! // Optionally scale back to the actual metric distance.
   //! nn.second *= e;
   //! \endcode
   template <typename P>
-  inline void SearchNn(P const& x, ScalarType const e, NeighborType& nn) const {
+  inline void SearchNn(
+      P const& x, DistanceType const e, NeighborType& nn) const {
     internal::SearchApproximateNn<NeighborType> v(e, nn);
     SearchNearest(x, v);
   }
 
+  //! \brief Searches for the nearest neighbor of point \p x for which \p
+  //! filter returns true.
+  //! \details When none of the points pass the filter, the distance of \p nn
+  //! equals std::numeric_limits<DistanceType>::max().
+  //! \see template <typename P, typename F, typename V> void SearchNearestIf(P
+  //! const&, F, V&) const
+  template <typename P, typename F>
+  inline void SearchNnIf(P const& x, F filter, NeighborType& nn) const {
+    internal::SearchNn<NeighborType> v(nn);
+    SearchNearestIf(x, filter, v);
+  }
+
   //! \brief Searches for the k nearest neighbors of point \p x, where k equals
   //! std::distance(begin, end). It is expected that the value type of the
-  //! iterator equals Neighbor<IndexType, ScalarType>.
+  //! iterator equals Neighbor<IndexType, DistanceType>.
   //! \details Interpretation of the output distances depend on the Metric. The
   //! default L2Squared results in squared distances.
   //! \tparam P Point type.
@@ -159,17 +412,161 @@ class KdTree {
     SearchKnn(x, knn.begin(), knn.end());
   }
 
+  //! \brief Searches for the \p k nearest neighbors of point \p x for which \p
+  //! filter returns true and stores the results in output vector \p knn.
+  //! \details Points that don't pass the filter don't count towards \p k. When
+  //! fewer than \p k points pass the filter, \p knn is shrunk to the number of
+  //! points that did.
+  //! \see template <typename P, typename F, typename V> void SearchNearestIf(P
+  //! const&, F, V&) const
+  template <typename P, typename F>
+  inline void SearchKnnIf(
+      P const& x,
+      SizeType const k,
+      F filter,
+      std::vector<NeighborType>& knn) const {
+    knn.resize(std::min(k, SpaceWrapperType(space_).size()));
+    // An empty output range can't be handled by the SearchKnn visitor.
+    if (knn.empty()) {
+      return;
+    }
+
+    internal::SearchKnn<typename std::vector<NeighborType>::iterator> v(
+        knn.begin(), knn.end());
+    SearchNearestIf(x, filter, v);
+    knn.erase(v.active_end(), knn.end());
+  }
+
+  //! \brief Searches for the \p k nearest neighbors of point \p x for which \p
+  //! filter returns true while skipping the nodes of which the summary isn't
+  //! accepted by \p summary_filter. The results are stored in output vector \p
+  //! knn.
+  //! \see template <typename P, typename F, typename S, typename G, typename V>
+  //! void SearchNearestIf(P const&, F, NodeSummaries<S> const&, G, V&) const
+  template <typename P, typename F, typename S, typename G>
+  inline void SearchKnnIf(
+      P const& x,
+      SizeType const k,
+      F filter,
+      NodeSummaries<S> const& summaries,
+      G summary_filter,
+      std::vector<NeighborType>& knn) const {
+    knn.resize(std::min(k, SpaceWrapperType(space_).size()));
+    // An empty output range can't be handled by the SearchKnn visitor.
+    if (knn.empty()) {
+      return;
+    }
+
+    internal::SearchKnn<typename std::vector<NeighborType>::iterator> v(
+        knn.begin(), knn.end());
+    SearchNearestIf(x, filter, summaries, summary_filter, v);
+    knn.erase(v.active_end(), knn.end());
+  }
+
+  //! \brief Searches for the k nearest neighbors of point \p x, where k equals
+  //! std::distance(begin, end), while visiting at most \p max_leaves_visited
+  //! leaf nodes.
+  //! \see template <typename P, typename V> void SearchNearest(P const&,
+  //! MaxLeavesVisited const&, V&) const
+  template <typename P, typename RandomAccessIterator>
+  inline void SearchKnn(
+      P const& x,
+      MaxLeavesVisited const& max_leaves_visited,
+      RandomAccessIterator begin,
+      RandomAccessIterator end) const {
+    static_assert(
+        std::is_same_v<
+            typename std::iterator_traits<RandomAccessIterator>::value_type,
+            NeighborType>,
+        "ITERATOR_VALUE_TYPE_DOES_NOT_EQUAL_NEIGHBOR_TYPE");
+
+    internal::SearchKnn<RandomAccessIterator> v(begin, end);
+    SearchNearest(x, max_leaves_visited, v);
+  }
+
+  //! \brief Searches for the \p k nearest neighbors of point \p x, while
+  //! visiting at most \p max_leaves_visited leaf nodes, and stores the results
+  //! in output vector \p knn.
+  //! \details When fewer than \p k points were visited, \p knn is shrunk to
+  //! the number of points that were.
+  //! \see template <typename P, typename V> void SearchNearest(P const&,
+  //! MaxLeavesVisited const&, V&) const
+  template <typename P>
+  inline void SearchKnn(
+      P const& x,
+      SizeType const k,
+      MaxLeavesVisited const& max_leaves_visited,
+      std::vector<NeighborType>& knn) const {
+    knn.resize(std::min(k, SpaceWrapperType(space_).size()));
+    // An empty output range can't be handled by the SearchKnn visitor.
+    if (knn.empty()) {
+      return;
+    }
+
+    internal::SearchKnn<typename std::vector<NeighborType>::iterator> v(
+        knn.begin(), knn.end());
+    SearchNearest(x, max_leaves_visited, v);
+    knn.erase(v.active_end(), knn.end());
+  }
+
+  //! \brief Searches for the k nearest neighbors of point \p x, where k equals
+  //! std::distance(begin, end), while staying within \p budget.
+  //! \returns True if the neighbors are the exact k nearest neighbors.
+  //! \see template <typename P, typename V> bool SearchNearest(P const&,
+  //! SearchBudget const&, V&) const
+  template <typename P, typename RandomAccessIterator>
+  inline bool SearchKnn(
+      P const& x,
+      SearchBudget const& budget,
+      RandomAccessIterator begin,
+      RandomAccessIterator end) const {
+    static_assert(
+        std::is_same_v<
+            typename std::iterator_traits<RandomAccessIterator>::value_type,
+            NeighborType>,
+        "ITERATOR_VALUE_TYPE_DOES_NOT_EQUAL_NEIGHBOR_TYPE");
+
+    internal::SearchKnn<RandomAccessIterator> v(begin, end);
+    return SearchNearest(x, budget, v);
+  }
+
+  //! \brief Searches for the \p k nearest neighbors of point \p x, while
+  //! staying within \p budget, and stores the results in output vector \p knn.
+  //! \details When the budget was spent before \p k points were visited, \p
+  //! knn is shrunk to the number of points that were.
+  //! \returns True if \p knn contains the exact k nearest neighbors.
+  //! \see template <typename P, typename V> bool SearchNearest(P const&,
+  //! SearchBudget const&, V&) const
+  template <typename P>
+  inline bool SearchKnn(
+      P const& x,
+      SizeType const k,
+      SearchBudget const& budget,
+      std::vector<NeighborType>& knn) const {
+    knn.resize(std::min(k, SpaceWrapperType(space_).size()));
+    // An empty output range can't be handled by the SearchKnn visitor.
+    if (knn.empty()) {
+      return true;
+    }
+
+    internal::SearchKnn<typename std::vector<NeighborType>::iterator> v(
+        knn.begin(), knn.end());
+    bool const exact = SearchNearest(x, budget, v);
+    knn.erase(v.active_end(), knn.end());
+    return exact;
+  }
+
   //! \brief Searches for the k approximate nearest neighbors of point \p x,
   //! where k equals std::distance(begin, end). It is expected that the value
-  //! type of the iterator equals Neighbor<IndexType, ScalarType>.
+  //! type of the iterator equals Neighbor<IndexType, DistanceType>.
   //! \see template <typename P, typename RandomAccessIterator> void
   //! SearchKnn(P const&, RandomAccessIterator, RandomAccessIterator) const
   //! \see template <typename P, typename RandomAccessIterator> void SearchNn(P
-  //! const&, ScalarType, NeighborType&) const
+  //! const&, DistanceType, NeighborType&) const
   template <typename P, typename RandomAccessIterator>
   inline void SearchKnn(
       P const& x,
-      ScalarType const e,
+      DistanceType const e,
       RandomAccessIterator begin,
       RandomAccessIterator end) const {
     static_assert(
@@ -188,12 +585,12 @@ class KdTree {
   //! \see template <typename P, typename RandomAccessIterator> void
   //! SearchKnn(P const&, RandomAccessIterator, RandomAccessIterator) const
   //! \see template <typename P, typename RandomAccessIterator> void SearchNn(P
-  //! const&, ScalarType, NeighborType&) const
+  //! const&, DistanceType, NeighborType&) const
   template <typename P>
   inline void SearchKnn(
       P const& x,
       SizeType const k,
-      ScalarType const e,
+      DistanceType const e,
       std::vector<NeighborType>& knn) const {
     // If it happens that the point set has less points than k we just return
     // all points in the set.
@@ -201,6 +598,76 @@ class KdTree {
     SearchKnn(x, e, knn.begin(), knn.end());
   }
 
+  //! \brief Searches for the \p k nearest neighbors of each point in the range
+  //! [\p begin, \p end) and stores the results in output vector \p knns. Each
+  //! point gets m neighbors, the minimum of \p k and the number of points of
+  //! the tree. For a non-empty range, m equals knns.size() / (\p end - \p
+  //! begin). The neighbors of the i-th point are stored at [i * m, (i + 1) *
+  //! m).
+  //! \details For a Euclidean space, the points are searched in packets of \p
+  //! PacketSize_ that traverse the tree together. Nodes and points that are
+  //! visited by more than one query of a packet are only loaded once. This
+  //! pays off when consecutive points are close to each other, for example
+  //! when they are sorted spatially or when they are the points of a
+  //! successive scan. The order in which the children of a node are visited
+  //! is shared by a packet and incoherent points may be slower to search than
+  //! with separate queries. For other spaces each point is searched by itself.
+  //! <p/>
+  //! The iterator should refer to points that outlive the search, such as the
+  //! points of a container.
+  //! \tparam PacketSize_ The number of points of a packet. At most 32.
+  //! \tparam InputIterator_ Iterator type of the points.
+  template <SizeType PacketSize_ = 8, typename InputIterator_>
+  inline void SearchKnnPacket(
+      InputIterator_ begin,
+      InputIterator_ end,
+      SizeType const k,
+      std::vector<NeighborType>& knns) const {
+    SizeType const count = static_cast<SizeType>(std::distance(begin, end));
+    SizeType const knn_count = std::min(k, SpaceWrapperType(space_).size());
+    knns.resize(count * knn_count);
+    if (knn_count == 0) {
+      return;
+    }
+
+    SearchKnnPacket<PacketSize_>(
+        begin, end, knn_count, knns, typename Metric_::SpaceTag());
+  }
+
+  //! \brief Searches for the \p k nearest neighbors of each point in the range
+  //! [\p begin, \p end) and stores the results in output vector \p knns. Each
+  //! point gets m neighbors, the minimum of \p k and the number of points of
+  //! the tree. For a non-empty range, m equals knns.size() / (\p end - \p
+  //! begin). The neighbors of the i-th point are stored at [i * m, (i + 1) *
+  //! m).
+  //! \details For a Euclidean space, the searches of up to \p InFlight_ points
+  //! are interleaved. Each search prefetches the node or the points it needs
+  //! next and yields to the next search, such that cache misses of one search
+  //! overlap with the work of the others. Unlike SearchKnnPacket, the points
+  //! don't have to be close to each other. For other spaces each point is
+  //! searched by itself.
+  //! <p/>
+  //! The iterator should refer to points that outlive the search, such as the
+  //! points of a container.
+  //! \tparam InFlight_ The number of searches that are interleaved.
+  //! \tparam InputIterator_ Iterator type of the points.
+  template <SizeType InFlight_ = 16, typename InputIterator_>
+  inline void SearchKnnInterleaved(
+      InputIterator_ begin,
+      InputIterator_ end,
+      SizeType const k,
+      std::vector<NeighborType>& knns) const {
+    SizeType const count = static_cast<SizeType>(std::distance(begin, end));
+    SizeType const knn_count = std::min(k, SpaceWrapperType(space_).size());
+    knns.resize(count * knn_count);
+    if (knn_count == 0) {
+      return;
+    }
+
+    SearchKnnInterleaved<InFlight_>(
+        begin, end, knn_count, knns, typename Metric_::SpaceTag());
+  }
+
   //! \brief Searches for all the neighbors of point \p x that are within radius
   //! \p radius and stores the results in output vector \p n.
   //! \details Interpretation of the in and output distances depend on the
@@ -212,7 +679,7 @@ class KdTree {
   //! ScalarType distance = -2.0;
   //! // E.g., L1: 2.0, L2Squared: 4.0
   //! ScalarType metric_distance = kdtree.metric()(distance);
-  //! std::vector<Neighbor<IndexType, ScalarType>> n;
+  //! std::vector<Neighbor<IndexType, DistanceType>> n;
   //! tree.SearchRadius(p, metric_distance, n);
   //! \endcode
   //! \param n Output points.
@@ -221,7 +688,7 @@ class KdTree {
   template <typename P>
   inline void SearchRadius(
       P const& x,
-      ScalarType const radius,
+      DistanceType const radius,
       std::vector<NeighborType>& n,
       bool const sort = false) const {
     internal::SearchRadius<NeighborType> v(radius, n);
@@ -232,17 +699,63 @@ class KdTree {
     }
   }
 
+  //! \brief Searches for all the neighbors of point \p x that are within radius
+  //! \p radius and for which \p filter returns true. The results are stored in
+  //! output vector \p n.
+  //! \see template <typename P> void SearchRadius(P const&, DistanceType,
+  //! std::vector<NeighborType>&, bool) const
+  //! \see template <typename P, typename F, typename V> void SearchNearestIf(P
+  //! const&, F, V&) const
+  template <typename P, typename F>
+  inline void SearchRadiusIf(
+      P const& x,
+      DistanceType const radius,
+      F filter,
+      std::vector<NeighborType>& n,
+      bool const sort = false) const {
+    internal::SearchRadius<NeighborType> v(radius, n);
+    SearchNearestIf(x, filter, v);
+
+    if (sort) {
+      v.Sort();
+    }
+  }
+
+  //! \brief Searches for all the neighbors of point \p x that are within radius
+  //! \p radius and for which \p filter returns true while skipping the nodes of
+  //! which the summary isn't accepted by \p summary_filter. The results are
+  //! stored in output vector \p n.
+  //! \see template <typename P, typename F, typename S, typename G, typename V>
+  //! void SearchNearestIf(P const&, F, NodeSummaries<S> const&, G, V&) const
+  template <typename P, typename F, typename S, typename G>
+  inline void SearchRadiusIf(
+      P const& x,
+      DistanceType const radius,
+      F filter,
+      NodeSummaries<S> const& summaries,
+      G summary_filter,
+      std::vector<NeighborType>& n,
+      bool const sort = false) const {
+    internal::SearchRadius<NeighborType> v(radius, n);
+    SearchNearestIf(x, filter, summaries, summary_filter, v);
+
+    if (sort) {
+      v.Sort();
+    }
+  }
+
   //! \brief Searches for all approximate neighbors of point \p x that are
   //! within radius \p radius and stores the results in output vector \p n.
   //! \see template <typename P, typename RandomAccessIterator> void
-  //! SearchRadius(P const&, ScalarType, std::vector<NeighborType>&, bool) const
+  //! SearchRadius(P const&, DistanceType, std::vector<NeighborType>&, bool)
+  //! const
   //! \see template <typename P, typename RandomAccessIterator> void SearchNn(P
-  //! const&, ScalarType, NeighborType&) const
+  //! const&, DistanceType, NeighborType&) const
   template <typename P>
   inline void SearchRadius(
       P const& x,
-      ScalarType const radius,
-      ScalarType const e,
+      DistanceType const radius,
+      DistanceType const e,
       std::vector<NeighborType>& n,
       bool const sort = false) const {
     internal::SearchApproximateRadius<NeighborType> v(e, radius, n);
@@ -253,6 +766,69 @@ class KdTree {
     }
   }
 
+  //! \brief Searches for all pairs of points of the tree that are within
+  //! radius \p radius of each other and stores them in output vector \p
+  //! pairs.
+  //! \details Each pair (i, {j, distance}) is stored once, with i < j. This is
+  //! the half neighbor list used by molecular dynamics simulations. The pairs
+  //! are stored in no particular order.
+  //! <p/>
+  //! For a Euclidean space, the tree is joined with itself. Pairs of nodes
+  //! that are too far apart are skipped as a whole. The join is split into
+  //! independent tasks that run in parallel when compiled with OpenMP. For a
+  //! topological space, the points are searched one by one in the order of
+  //! the tree and the indices of other points are filtered before their
+  //! distance is calculated.
+  //! <p/>
+  //! Combined with the Periodic metric, pairs are found across the periodic
+  //! boundaries of a simulation box.
+  //! \see template <typename P> void SearchRadius(P const&, DistanceType,
+  //! std::vector<NeighborType>&, bool) const
+  inline void SearchRadiusPairs(
+      DistanceType const radius,
+      std::vector<std::pair<IndexType, NeighborType>>& pairs) const {
+    pairs.clear();
+    SearchRadiusPairs(radius, pairs, typename Metric_::SpaceTag());
+  }
+
+  //! \brief Searches for the neighbors within radius \p radius of each point
+  //! of the tree and stores them in \p neighbors.
+  //! \details Each pair of points is found once by SearchRadiusPairs and it is
+  //! stored for both of its points. A point is not a neighbor of itself. The
+  //! neighbors of a point are stored in no particular order.
+  //! <p/>
+  //! Besides the output, the search temporarily uses memory for the pairs and
+  //! one offset per point.
+  //! \see void SearchRadiusPairs(DistanceType,
+  //! std::vector<std::pair<IndexType, NeighborType>>&) const
+  inline void SearchAllRadius(
+      DistanceType const radius,
+      NeighborList<IndexType, DistanceType>& neighbors) const {
+    std::vector<std::pair<IndexType, NeighborType>> pairs;
+    SearchRadiusPairs(radius, pairs);
+
+    SizeType const size = SpaceWrapperType(space_).size();
+    auto& offsets = neighbors.offsets;
+    offsets.assign(size + 1, 0);
+    for (auto const& pair : pairs) {
+      ++offsets[static_cast<SizeType>(pair.first) + 1];
+      ++offsets[static_cast<SizeType>(pair.second.index) + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    neighbors.indices.resize(offsets.back());
+    neighbors.distances.resize(offsets.back());
+    std::vector<SizeType> ends(offsets.begin(), offsets.end() - 1);
+    for (auto const& pair : pairs) {
+      SizeType const i = static_cast<SizeType>(pair.first);
+      SizeType const j = static_cast<SizeType>(pair.second.index);
+      neighbors.indices[ends[i]] = pair.second.index;
+      neighbors.distances[ends[i]++] = pair.second.distance;
+      neighbors.indices[ends[j]] = pair.first;
+      neighbors.distances[ends[j]++] = pair.second.distance;
+    }
+  }
+
   //! \brief Returns all points within the box defined by \p min and \p max.
   //! Query time is bounded by O(n^(1-1/Dim)+k).
   //! \tparam P Point type.
@@ -283,11 +859,40 @@ class KdTree {
   //! \brief Metric used for search queries.
   inline MetricType const& metric() const { return metric_; }
 
-  //! \brief Loads the tree in binary from file.
-  static KdTree Load(SpaceType points, std::string const& filename) {
+  //! \brief Returns the peak memory in bytes used while building the tree,
+  //! excluding the point set. It includes the indices, the nodes and any
+  //! scratch memory of the splitting rule. It is zero for a loaded tree.
+  inline SizeType peak_build_memory() const { return data_.peak_build_memory; }
+
+  //! \brief Returns the memory resource of the indices and nodes.
+  inline std::pmr::memory_resource* resource() const {
+    return data_.allocator.resource();
+  }
+
+  //! \brief Loads the tree in binary from file. The indices and nodes of the
+  //! tree are allocated from \p resource.
+  static KdTree Load(
+      SpaceType points,
+      std::string const& filename,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
     std::fstream stream =
         internal::OpenStream(filename, std::ios::in | std::ios::binary);
-    return Load(std::move(points), stream);
+    return Load(std::move(points), stream, resource);
+  }
+
+  //! \brief Loads the tree in binary from file. The tree compares distances
+  //! using \p metric.
+  //! \details A metric that has a state, such as WeightedL2Squared, is not
+  //! saved with the tree and is passed to it using this function.
+  //! \see KdTree::Load(SpaceType, std::iostream&, std::pmr::memory_resource*)
+  static KdTree Load(
+      SpaceType points,
+      std::string const& filename,
+      MetricType metric,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+    std::fstream stream =
+        internal::OpenStream(filename, std::ios::in | std::ios::binary);
+    return Load(std::move(points), stream, std::move(metric), resource);
   }
 
   //! \brief Loads the tree in binary from \p stream .
@@ -298,9 +903,24 @@ class KdTree {
   //! point set.
   //! \li Does not check if the stored tree structure is valid for the given
   //! template arguments.
-  static KdTree Load(SpaceType points, std::iostream& stream) {
+  static KdTree Load(
+      SpaceType points,
+      std::iostream& stream,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+    return Load(std::move(points), stream, MetricType(), resource);
+  }
+
+  //! \brief Loads the tree in binary from \p stream . The tree compares
+  //! distances using \p metric.
+  //! \see KdTree::Load(SpaceType, std::string const&, MetricType,
+  //! std::pmr::memory_resource*)
+  static KdTree Load(
+      SpaceType points,
+      std::iostream& stream,
+      MetricType metric,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
     internal::Stream s(stream);
-    return KdTree(std::move(points), s);
+    return KdTree(std::move(points), std::move(metric), s, resource);
   }
 
   //! \brief Saves the tree in binary to file.
@@ -321,41 +941,324 @@ class KdTree {
   }
 
  private:
+  //! \brief Minimum number of tasks that a self-join is split into, such that
+  //! they can be balanced across threads.
+  static SizeType constexpr kTaskCount = 256;
+
   //! \brief Constructs a KdTree by reading its indexing and leaf information
   //! from a Stream.
-  KdTree(SpaceType space, internal::Stream& stream)
+  KdTree(
+      SpaceType space,
+      MetricType metric,
+      internal::Stream& stream,
+      std::pmr::memory_resource* resource)
       : space_(std::move(space)),
-        metric_(),
-        data_(KdTreeDataType::Load(stream)) {}
+        metric_(std::move(metric)),
+        data_(KdTreeDataType::Load(stream, resource)) {}
 
   //! \brief Returns the nearest neighbor (or neighbors) of point \p x depending
   //! on their selection by visitor \p visitor for node \p node.
-  template <typename PointWrapper_, typename Visitor_>
+  template <
+      typename PointWrapper_,
+      typename Filter_,
+      typename Visitor_,
+      typename NodeFilter_ = internal::AcceptAllNodes>
   inline void SearchNearest(
-      PointWrapper_ point, Visitor_& visitor, EuclideanSpaceTag) const {
+      PointWrapper_ point,
+      Filter_ filter,
+      Visitor_& visitor,
+      EuclideanSpaceTag,
+      NodeFilter_ node_filter = NodeFilter_()) const {
     internal::SearchNearestEuclidean<
         SpaceWrapperType,
         Metric_,
         PointWrapper_,
         Visitor_,
-        IndexType>(
-        SpaceWrapperType(space_), metric_, data_.indices, point, visitor)(
-        data_.root_node);
+        IndexType,
+        Filter_,
+        NodeFilter_>(
+        SpaceWrapperType(space_),
+        metric_,
+        data_.indices,
+        point,
+        visitor,
+        filter,
+        node_filter)(data_.root_node);
   }
 
   //! \brief Returns the nearest neighbor (or neighbors) of point \p x depending
   //! on their selection by visitor \p visitor for node \p node.
-  template <typename PointWrapper_, typename Visitor_>
+  template <
+      typename PointWrapper_,
+      typename Filter_,
+      typename Visitor_,
+      typename NodeFilter_ = internal::AcceptAllNodes>
   inline void SearchNearest(
-      PointWrapper_ point, Visitor_& visitor, TopologicalSpaceTag) const {
+      PointWrapper_ point,
+      Filter_ filter,
+      Visitor_& visitor,
+      TopologicalSpaceTag,
+      NodeFilter_ node_filter = NodeFilter_()) const {
     internal::SearchNearestTopological<
+        SpaceWrapperType,
+        Metric_,
+        PointWrapper_,
+        Visitor_,
+        IndexType,
+        Filter_,
+        NodeFilter_>(
+        SpaceWrapperType(space_),
+        metric_,
+        data_.indices,
+        point,
+        visitor,
+        filter,
+        node_filter)(data_.root_node);
+  }
+
+  //! \brief Searches for the \p k nearest neighbors of each point in the range
+  //! [\p begin, \p end) using packets of points.
+  template <SizeType PacketSize_, typename InputIterator_>
+  inline void SearchKnnPacket(
+      InputIterator_ begin,
+      InputIterator_ end,
+      SizeType const k,
+      std::vector<NeighborType>& knns,
+      EuclideanSpaceTag) const {
+    using PointType =
+        typename std::iterator_traits<InputIterator_>::value_type;
+    using VisitorType =
+        internal::SearchKnn<typename std::vector<NeighborType>::iterator>;
+    using SearchType = internal::SearchNearestEuclideanPacket<
+        SpaceWrapperType,
+        Metric_,
+        VisitorType,
+        IndexType,
+        PacketSize_>;
+
+    SearchType search(SpaceWrapperType(space_), metric_, data_.indices);
+    std::array<ScalarType const*, PacketSize_> queries;
+    std::vector<VisitorType> visitors;
+    visitors.reserve(PacketSize_);
+    auto output = knns.begin();
+
+    while (begin != end) {
+      visitors.clear();
+      for (; begin != end && visitors.size() < PacketSize_; ++begin) {
+        queries[visitors.size()] =
+            internal::PointWrapper<PointType>(*begin).begin();
+        visitors.emplace_back(output, output + k);
+        output += k;
+      }
+      search(data_.root_node, queries.data(), visitors.data(), visitors.size());
+    }
+  }
+
+  //! \brief Searches for the \p k nearest neighbors of each point in the range
+  //! [\p begin, \p end) one point at a time.
+  template <SizeType PacketSize_, typename InputIterator_>
+  inline void SearchKnnPacket(
+      InputIterator_ begin,
+      InputIterator_ end,
+      SizeType const k,
+      std::vector<NeighborType>& knns,
+      TopologicalSpaceTag) const {
+    auto output = knns.begin();
+    for (; begin != end; ++begin, output += k) {
+      SearchKnn(*begin, output, output + k);
+    }
+  }
+
+  //! \brief Searches for the \p k nearest neighbors of each point in the range
+  //! [\p begin, \p end) using interleaved searches.
+  template <SizeType InFlight_, typename InputIterator_>
+  inline void SearchKnnInterleaved(
+      InputIterator_ begin,
+      InputIterator_ end,
+      SizeType const k,
+      std::vector<NeighborType>& knns,
+      EuclideanSpaceTag) const {
+    using PointType =
+        typename std::iterator_traits<InputIterator_>::value_type;
+    using VisitorType =
+        internal::SearchKnn<typename std::vector<NeighborType>::iterator>;
+    using SearchType = internal::SearchNearestEuclideanInterleaved<
+        SpaceWrapperType,
+        Metric_,
+        VisitorType,
+        IndexType,
+        InFlight_>;
+
+    std::vector<ScalarType const*> queries;
+    std::vector<VisitorType> visitors;
+    queries.reserve(knns.size() / k);
+    visitors.reserve(knns.size() / k);
+    auto output = knns.begin();
+    for (; begin != end; ++begin, output += k) {
+      queries.push_back(internal::PointWrapper<PointType>(*begin).begin());
+      visitors.emplace_back(output, output + k);
+    }
+
+    SearchType(SpaceWrapperType(space_), metric_, data_.indices)(
+        data_.root_node, queries.data(), visitors.data(), visitors.size());
+  }
+
+  //! \brief Searches for the \p k nearest neighbors of each point in the range
+  //! [\p begin, \p end) one point at a time.
+  template <SizeType InFlight_, typename InputIterator_>
+  inline void SearchKnnInterleaved(
+      InputIterator_ begin,
+      InputIterator_ end,
+      SizeType const k,
+      std::vector<NeighborType>& knns,
+      TopologicalSpaceTag) const {
+    auto output = knns.begin();
+    for (; begin != end; ++begin, output += k) {
+      SearchKnn(*begin, output, output + k);
+    }
+  }
+
+  //! \brief Searches for all pairs of points within radius \p radius using a
+  //! self-join of the tree.
+  inline void SearchRadiusPairs(
+      DistanceType const radius,
+      std::vector<std::pair<IndexType, NeighborType>>& pairs,
+      EuclideanSpaceTag) const {
+    using SearchType = internal::
+        SearchAllRadiusEuclidean<SpaceWrapperType, Metric_, IndexType>;
+    // TODO Remove when MSVC++ has default support for OpenMP 3.0+.
+    using SSize = std::ptrdiff_t;
+
+    SpaceWrapperType space(space_);
+    auto const tasks = SearchType(space, metric_, data_.indices, radius)
+                           .Split(data_.root_node, data_.root_box, kTaskCount);
+
+    std::vector<std::vector<std::pair<IndexType, NeighborType>>> task_pairs(
+        tasks.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (SSize t = 0; t < static_cast<SSize>(tasks.size()); ++t) {
+      auto const i = static_cast<SizeType>(t);
+      SearchType(space, metric_, data_.indices, radius)(
+          tasks[i], task_pairs[i]);
+    }
+
+    SizeType count = 0;
+    for (auto const& p : task_pairs) {
+      count += p.size();
+    }
+    pairs.reserve(count);
+    for (auto const& p : task_pairs) {
+      pairs.insert(pairs.end(), p.begin(), p.end());
+    }
+  }
+
+  //! \brief Searches for all pairs of points within radius \p radius by
+  //! searching each point.
+  inline void SearchRadiusPairs(
+      DistanceType const radius,
+      std::vector<std::pair<IndexType, NeighborType>>& pairs,
+      TopologicalSpaceTag) const {
+    SpaceWrapperType space(space_);
+    for (IndexType const i : data_.indices) {
+      PointMap<ScalarType const, Dim> const x(space[i], space.sdim());
+      internal::SearchRadiusPairs<NeighborType> v(radius, i, pairs);
+      SearchNearestIf(x, [i](IndexType const j) { return j > i; }, v);
+    }
+  }
+
+  //! \brief Returns the nearest neighbor (or neighbors) of point \p x depending
+  //! on their selection by visitor \p visitor while visiting at most \p
+  //! max_leaves_visited leaf nodes.
+  template <typename PointWrapper_, typename Visitor_>
+  inline void SearchNearest(
+      PointWrapper_ point,
+      MaxLeavesVisited const& max_leaves_visited,
+      Visitor_& visitor,
+      EuclideanSpaceTag) const {
+    // The branch queue of a typical search fits in this buffer, such that it
+    // doesn't allocate from the heap.
+    std::array<std::byte, kBranchQueueBufferSize> buffer;
+    std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size());
+    internal::BestBinFirstSearchEuclidean<
         SpaceWrapperType,
         Metric_,
         PointWrapper_,
         Visitor_,
         IndexType>(
-        SpaceWrapperType(space_), metric_, data_.indices, point, visitor)(
-        data_.root_node);
+        SpaceWrapperType(space_),
+        metric_,
+        data_.indices,
+        point,
+        max_leaves_visited.value,
+        visitor,
+        &resource)(data_.root_node);
+  }
+
+  //! \brief Returns the nearest neighbor (or neighbors) of point \p x depending
+  //! on their selection by visitor \p visitor while visiting at most \p
+  //! max_leaves_visited leaf nodes.
+  template <typename PointWrapper_, typename Visitor_>
+  inline void SearchNearest(
+      PointWrapper_ point,
+      MaxLeavesVisited const& max_leaves_visited,
+      Visitor_& visitor,
+      TopologicalSpaceTag) const {
+    // The branch queue of a typical search fits in this buffer, such that it
+    // doesn't allocate from the heap.
+    std::array<std::byte, kBranchQueueBufferSize> buffer;
+    std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size());
+    internal::BestBinFirstSearchTopological<
+        SpaceWrapperType,
+        Metric_,
+        PointWrapper_,
+        Visitor_,
+        IndexType>(
+        SpaceWrapperType(space_),
+        metric_,
+        data_.indices,
+        point,
+        max_leaves_visited.value,
+        visitor,
+        &resource)(data_.root_node);
+  }
+
+  //! \brief Stores the summaries of \p node and its descendants in \p
+  //! summaries and returns the range of indices of the points of \p node.
+  //! \details The summary of a branch node is computed by \p combine from the
+  //! summaries of its children and the indices of its points.
+  template <typename F, typename C, typename S>
+  std::pair<IndexType, IndexType> Summarize(
+      NodeType const* const node,
+      F& summarize,
+      C& combine,
+      NodeSummaries<S>& summaries) const {
+    Size const pos = summaries.summaries.size();
+    summaries.summaries.emplace_back();
+    summaries.right.push_back(0);
+
+    IndexType const* const indices = data_.indices.data();
+    std::pair<IndexType, IndexType> range;
+    if (node->IsLeaf()) {
+      range = {node->data.leaf.begin_idx, node->data.leaf.end_idx};
+      summaries.summaries[pos] =
+          summarize(indices + range.first, indices + range.second);
+    } else {
+      auto const left = Summarize(node->left, summarize, combine, summaries);
+      summaries.right[pos] = summaries.summaries.size();
+      auto const right = Summarize(node->right, summarize, combine, summaries);
+      // The builders partition the indices in place, such that the points of
+      // the right child directly follow those of the left child.
+      assert(left.second == right.first);
+      range = {left.first, right.second};
+      summaries.summaries[pos] = combine(
+          summaries.summaries[pos + 1],
+          summaries.summaries[summaries.right[pos]],
+          indices + range.first,
+          indices + range.second);
+    }
+    return range;
   }
 
   //! \brief Point set used for querying point data.
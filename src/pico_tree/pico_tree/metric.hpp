@@ -1,6 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include "core.hpp"
+#include "internal/uint8_distance.hpp"
 
 namespace pico_tree {
 
@@ -13,36 +22,44 @@ inline T constexpr kPi = T(3.14159265358979323846l);
 template <typename T>
 inline T constexpr kTwoPi = T(6.28318530717958647693l);
 
+//! \brief The type of the difference between two coordinates.
+//! \details Coordinates of a small integral type, such as std::uint8_t, are
+//! promoted to int before they are subtracted. Their differences and the
+//! distances computed from them don't wrap around.
+template <typename Scalar_>
+using DifferenceType =
+    decltype(std::declval<Scalar_>() - std::declval<Scalar_>());
+
 //! \brief Calculates the square of a number.
 template <typename Scalar_>
-constexpr Scalar_ Squared(Scalar_ x) {
+constexpr auto Squared(Scalar_ x) {
   return x * x;
 }
 
 //! \brief Calculates the distance between two coordinates.
 template <typename Scalar_>
-constexpr Scalar_ Distance(Scalar_ x, Scalar_ y) {
+constexpr auto Distance(Scalar_ x, Scalar_ y) {
   return std::abs(x - y);
 }
 
 //! \brief Calculates the distance between two coordinates.
 struct DistanceFn {
   template <typename Scalar_>
-  constexpr Scalar_ operator()(Scalar_ x, Scalar_ y) const {
+  constexpr auto operator()(Scalar_ x, Scalar_ y) const {
     return Distance(x, y);
   }
 };
 
 //! \brief Calculates the squared distance between two coordinates.
 template <typename Scalar_>
-constexpr Scalar_ SquaredDistance(Scalar_ x, Scalar_ y) {
+constexpr auto SquaredDistance(Scalar_ x, Scalar_ y) {
   return Squared(x - y);
 }
 
 //! \brief Calculates the squared distance between two coordinates.
 struct SquaredDistanceFn {
   template <typename Scalar_>
-  constexpr Scalar_ operator()(Scalar_ x, Scalar_ y) const {
+  constexpr auto operator()(Scalar_ x, Scalar_ y) const {
     return SquaredDistance(x, y);
   }
 };
@@ -50,28 +67,54 @@ struct SquaredDistanceFn {
 //! \brief Calculates the distance between coordinate \p x and the box defined
 //! by [ \p min, \p max ].
 template <typename Scalar_>
-constexpr Scalar_ DistanceBox(Scalar_ x, Scalar_ min, Scalar_ max) {
+constexpr DifferenceType<Scalar_> DistanceBox(
+    Scalar_ x, Scalar_ min, Scalar_ max) {
   if (x < min) {
     return min - x;
   } else if (x > max) {
     return x - max;
   } else {
-    return Scalar_(0.0);
+    return DifferenceType<Scalar_>(0);
   }
 }
 
 //! \brief Calculates the squared distance between coordinate \p x and the box
 //! defined by [ \p min, \p max ].
 template <typename Scalar_>
-constexpr Scalar_ SquaredDistanceBox(Scalar_ x, Scalar_ min, Scalar_ max) {
+constexpr auto SquaredDistanceBox(Scalar_ x, Scalar_ min, Scalar_ max) {
   return Squared(DistanceBox(x, min, max));
 }
 
+//! \brief Calculates the distance between two coordinates that wrap around
+//! with a period of \p length.
+//! \details Both coordinates should be in the range [0, \p length) or
+//! another range of the same size.
+template <typename Scalar_>
+constexpr Scalar_ PeriodicDistance(Scalar_ x, Scalar_ y, Scalar_ length) {
+  Scalar_ const d = std::abs(x - y);
+  return std::min(d, length - d);
+}
+
+//! \brief Calculates the distance between coordinate \p x and the box defined
+//! by [ \p min, \p max ] for coordinates that wrap around with a period of \p
+//! length.
+template <typename Scalar_>
+constexpr Scalar_ PeriodicDistanceBox(
+    Scalar_ x, Scalar_ min, Scalar_ max, Scalar_ length) {
+  // Rectangles can't currently wrap around the identification of the begin
+  // and end of a period where the minimum is larger than the maximum.
+  if (x < min || x > max) {
+    return std::min(
+        PeriodicDistance(x, min, length), PeriodicDistance(x, max, length));
+  } else {
+    return Scalar_(0.0);
+  }
+}
+
 //! \brief Calculates the angular distance between two coordinates.
 template <typename Scalar_>
 constexpr Scalar_ AngleDistance(Scalar_ x, Scalar_ y) {
-  Scalar_ const d = std::abs(x - y);
-  return std::min(d, internal::kTwoPi<Scalar_> - d);
+  return PeriodicDistance(x, y, internal::kTwoPi<Scalar_>);
 }
 
 //! \brief Calculates the squared angular distance between two coordinates.
@@ -84,20 +127,22 @@ constexpr Scalar_ SquaredAngleDistance(Scalar_ x, Scalar_ y) {
 //! defined by [ \p min, \p max ].
 template <typename Scalar_>
 constexpr Scalar_ AngleDistanceBox(Scalar_ x, Scalar_ min, Scalar_ max) {
-  // Rectangles can't currently wrap around the identification of PI ~ -PI
-  // where the minimum is larger than he maximum.
-  if (x < min || x > max) {
-    return std::min(AngleDistance(x, min), AngleDistance(x, max));
-  } else {
-    return Scalar_(0.0);
-  }
+  return PeriodicDistanceBox(x, min, max, internal::kTwoPi<Scalar_>);
 }
 
 //! \brief Calculates the squared angular distance between a coordinate and a
 //! box.
 template <typename Scalar_>
 constexpr Scalar_ SquaredAngleDistanceBox(Scalar_ x, Scalar_ min, Scalar_ max) {
-  return Squared(AngleDistance(x, min, max));
+  return Squared(AngleDistanceBox(x, min, max));
+}
+
+//! \brief Calculates the haversine of angle \p x: sin^2(x / 2).
+//! \details The haversine is monotonic for angles in the range [0, PI] and it
+//! is periodic with a period of 2 PI.
+template <typename Scalar_>
+inline Scalar_ Haversine(Scalar_ x) {
+  return Squared(std::sin(x / Scalar_(2.0)));
 }
 
 //! \brief Calculates the squared angular distance between two coordinates.
@@ -119,9 +164,9 @@ constexpr auto Sum(
     InputSentinel1 end1,
     InputIterator2 begin2,
     BinaryOperator op) {
-  using ScalarType = typename std::iterator_traits<InputIterator1>::value_type;
-
-  ScalarType d{};
+  // The sum has the type of the terms. It is wider than the coordinates when
+  // these are of a small integral type.
+  decltype(op(*begin1, *begin2)) d{};
 
   for (; begin1 != end1; ++begin1, ++begin2) {
     d += op(*begin1, *begin2);
@@ -130,6 +175,127 @@ constexpr auto Sum(
   return d;
 }
 
+//! \brief Calculates the product of two coordinates.
+struct ProductFn {
+  template <typename Scalar_>
+  constexpr auto operator()(Scalar_ x, Scalar_ y) const {
+    return x * y;
+  }
+};
+
+//! \brief True if \p Iterator_ is a pointer to floating point coordinates.
+template <typename Iterator_>
+inline constexpr bool kIsFloatingPointPointer =
+    std::is_pointer_v<Iterator_> &&
+    std::is_floating_point_v<std::remove_pointer_t<Iterator_>>;
+
+//! \brief Calculates the sum of \p op applied to the \p n coordinates of \p a
+//! and \p b using four partial sums.
+//! \details A compiler may not reorder a floating point sum. The partial sums
+//! are independent, such that they can be kept in a single SIMD register and
+//! the loop is vectorized without -ffast-math.
+template <typename Scalar_, typename BinaryOperator>
+constexpr Scalar_ SumPartials(
+    Scalar_ const* a, Scalar_ const* b, Size const n, BinaryOperator op) {
+  Scalar_ s0{};
+  Scalar_ s1{};
+  Scalar_ s2{};
+  Scalar_ s3{};
+  Size i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 += op(a[i + 0], b[i + 0]);
+    s1 += op(a[i + 1], b[i + 1]);
+    s2 += op(a[i + 2], b[i + 2]);
+    s3 += op(a[i + 3], b[i + 3]);
+  }
+  for (; i < n; ++i) {
+    s0 += op(a[i], b[i]);
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+//! \brief Calculates the sum of \p op applied to the coordinates of two points.
+//! Floating point coordinates stored in contiguous memory are summed using
+//! SumPartials().
+template <
+    typename InputIterator1,
+    typename InputSentinel1,
+    typename InputIterator2,
+    typename BinaryOperator>
+constexpr auto SumVectorized(
+    InputIterator1 begin1,
+    InputSentinel1 end1,
+    InputIterator2 begin2,
+    BinaryOperator op) {
+  if constexpr (
+      kIsFloatingPointPointer<InputIterator1> &&
+      std::is_same_v<InputIterator1, InputSentinel1> &&
+      std::is_same_v<
+          std::remove_cv_t<std::remove_pointer_t<InputIterator1>>,
+          std::remove_cv_t<std::remove_pointer_t<InputIterator2>>>) {
+    return SumPartials<std::remove_cv_t<std::remove_pointer_t<InputIterator1>>>(
+        begin1, begin2, static_cast<Size>(end1 - begin1), op);
+  } else {
+    return Sum(begin1, end1, begin2, op);
+  }
+}
+
+//! \brief Calculates the inner product of two points.
+template <
+    typename InputIterator1,
+    typename InputSentinel1,
+    typename InputIterator2>
+constexpr auto Dot(
+    InputIterator1 begin1, InputSentinel1 end1, InputIterator2 begin2) {
+  return SumVectorized(begin1, end1, begin2, ProductFn());
+}
+
+//! \brief The type of the distances that \p Metric_ calculates between points
+//! with coordinates of type \p Scalar_.
+template <typename Metric_, typename Scalar_>
+using MetricDistanceType = std::decay_t<decltype(std::declval<Metric_ const&>()(
+    std::declval<Scalar_ const*>(),
+    std::declval<Scalar_ const*>(),
+    std::declval<Scalar_ const*>()))>;
+
+//! \brief Raises \p x to the integral power \p P_.
+template <int P_, typename Scalar_>
+constexpr Scalar_ Pow(Scalar_ x) {
+  static_assert(P_ >= 1, "POWER_MUST_BE_LARGER_THAN_0");
+  if constexpr (P_ == 1) {
+    return x;
+  } else if constexpr (P_ % 2 == 0) {
+    return Squared(Pow<P_ / 2>(x));
+  } else {
+    return x * Pow<P_ - 1>(x);
+  }
+}
+
+//! \brief True if \p Metric_ weighs each dimension differently. Such a metric
+//! provides a weights() method and measures the distance between two
+//! coordinates given their dimension.
+template <typename Metric_, typename = void>
+inline constexpr bool kIsWeightedMetric = false;
+
+template <typename Metric_>
+inline constexpr bool kIsWeightedMetric<
+    Metric_,
+    std::void_t<decltype(std::declval<Metric_ const&>().weights())>> = true;
+
+//! \brief Calculates the distance between coordinates \p x and \p y of
+//! dimension \p dim using \p metric.
+//! \details This function is used by the searches of Euclidean spaces to
+//! calculate node box offsets.
+template <typename Metric_, typename Scalar_>
+constexpr auto CoordinateDistance(
+    Metric_ const& metric, Scalar_ x, Scalar_ y, [[maybe_unused]] int dim) {
+  if constexpr (kIsWeightedMetric<Metric_>) {
+    return metric(x, y, dim);
+  } else {
+    return metric(x, y);
+  }
+}
+
 }  // namespace internal
 
 //! \brief Identifies a metric to support the most generic space that can be
@@ -165,18 +331,26 @@ struct L1 {
       typename InputIterator2>
   constexpr auto operator()(
       InputIterator1 begin1, InputSentinel1 end1, InputIterator2 begin2) const {
-    return internal::Sum(begin1, end1, begin2, internal::DistanceFn());
+    if constexpr (
+        internal::kIsUint8Pointer<InputIterator1> &&
+        std::is_same_v<InputIterator1, InputSentinel1> &&
+        internal::kIsUint8Pointer<InputIterator2>) {
+      return internal::SumAbsoluteDifferences(
+          begin1, begin2, static_cast<Size>(end1 - begin1));
+    } else {
+      return internal::Sum(begin1, end1, begin2, internal::DistanceFn());
+    }
   }
 
   //! \brief Calculates the distance between two coordinates.
   template <typename Scalar_>
-  constexpr Scalar_ operator()(Scalar_ x, Scalar_ y) const {
+  constexpr auto operator()(Scalar_ x, Scalar_ y) const {
     return internal::Distance(x, y);
   }
 
   //! \brief Returns the absolute value of \p x.
   template <typename Scalar_>
-  constexpr Scalar_ operator()(Scalar_ x) const {
+  constexpr auto operator()(Scalar_ x) const {
     return std::abs(x);
   }
 };
@@ -194,23 +368,45 @@ struct L2Squared {
       typename InputIterator2>
   constexpr auto operator()(
       InputIterator1 begin1, InputSentinel1 end1, InputIterator2 begin2) const {
-    return internal::Sum(begin1, end1, begin2, internal::SquaredDistanceFn());
+    if constexpr (
+        internal::kIsUint8Pointer<InputIterator1> &&
+        std::is_same_v<InputIterator1, InputSentinel1> &&
+        internal::kIsUint8Pointer<InputIterator2>) {
+      return internal::SumSquaredDifferences(
+          begin1, begin2, static_cast<Size>(end1 - begin1));
+    } else {
+      return internal::Sum(
+          begin1, end1, begin2, internal::SquaredDistanceFn());
+    }
   }
 
   //! \brief Calculates the distance between two coordinates.
   template <typename Scalar_>
-  constexpr Scalar_ operator()(Scalar_ x, Scalar_ y) const {
+  constexpr auto operator()(Scalar_ x, Scalar_ y) const {
     return internal::SquaredDistance(x, y);
   }
 
   //! \brief Returns the squared value of \p x.
   template <typename Scalar_>
-  constexpr Scalar_ operator()(Scalar_ x) const {
+  constexpr auto operator()(Scalar_ x) const {
     return internal::Squared(x);
   }
 };
 
-struct LInf {
+//! \brief The Minkowski semimetric measures Lp distances between points
+//! raised to the power \p P_. Like L2Squared, the root is never taken.
+//! \details Minkowski<1> equals L1 and Minkowski<2> equals L2Squared. The
+//! distances can be compared to the radius of a search after raising the
+//! latter to the power \p P_.
+//! <p/>
+//! For integral coordinates the powers are calculated in double. Already for
+//! std::uint8_t coordinates, 255^4 overflows an int.
+//! \see L1
+//! \tparam P_ The order of the Lp norm. It must be larger than 0.
+template <int P_>
+struct Minkowski {
+  static_assert(P_ >= 1, "P_MUST_BE_LARGER_THAN_0");
+
   //! \brief This tag specifies the supported space by this metric.
   using SpaceTag = EuclideanSpaceTag;
 
@@ -220,10 +416,46 @@ struct LInf {
       typename InputIterator2>
   constexpr auto operator()(
       InputIterator1 begin1, InputSentinel1 end1, InputIterator2 begin2) const {
-    using ScalarType =
-        typename std::iterator_traits<InputIterator1>::value_type;
+    return internal::Sum(begin1, end1, begin2, [](auto x, auto y) {
+      return Power(internal::Distance(x, y));
+    });
+  }
+
+  //! \brief Calculates the distance between two coordinates.
+  template <typename Scalar_>
+  constexpr auto operator()(Scalar_ x, Scalar_ y) const {
+    return Power(internal::Distance(x, y));
+  }
+
+  //! \brief Returns the absolute value of \p x raised to the power P_.
+  template <typename Scalar_>
+  constexpr auto operator()(Scalar_ x) const {
+    return Power(std::abs(x));
+  }
 
-    ScalarType d{};
+ private:
+  //! \brief Raises \p x to the power P_ in a type that can hold the result.
+  template <typename Scalar_>
+  static constexpr auto Power(Scalar_ x) {
+    if constexpr (std::is_integral_v<Scalar_>) {
+      return internal::Pow<P_>(static_cast<double>(x));
+    } else {
+      return internal::Pow<P_>(x);
+    }
+  }
+};
+
+struct LInf {
+  //! \brief This tag specifies the supported space by this metric.
+  using SpaceTag = EuclideanSpaceTag;
+
+  template <
+      typename InputIterator1,
+      typename InputSentinel1,
+      typename InputIterator2>
+  constexpr auto operator()(
+      InputIterator1 begin1, InputSentinel1 end1, InputIterator2 begin2) const {
+    decltype(internal::Distance(*begin1, *begin2)) d{};
 
     for (; begin1 != end1; ++begin1, ++begin2) {
       d = std::max(d, internal::Distance(*begin1, *begin2));
@@ -234,17 +466,150 @@ struct LInf {
 
   //! \brief Calculates the distance between two coordinates.
   template <typename Scalar_>
-  constexpr Scalar_ operator()(Scalar_ x, Scalar_ y) const {
+  constexpr auto operator()(Scalar_ x, Scalar_ y) const {
     return internal::Distance(x, y);
   }
 
   //! \brief Returns the absolute value of \p x.
   template <typename Scalar_>
-  constexpr Scalar_ operator()(Scalar_ x) const {
+  constexpr auto operator()(Scalar_ x) const {
     return std::abs(x);
   }
 };
 
+//! \brief The Cosine metric measures the cosine distance, 1 - cos(a, b),
+//! between points of unit length.
+//! \details For points of unit length the cosine distance equals half their
+//! squared Euclidean distance: 1 - a.b = 0.5 * |a - b|^2. It is computed as
+//! the latter, which doesn't suffer from cancellation for nearby points and
+//! keeps the distances between points and boxes exact. Points, queries
+//! included, must be normalized before they are used. Coordinates must have a
+//! floating point type, as integral points of unit length don't exist. The
+//! distance is vectorized.
+//! <p/>
+//! The cosine distance is not a metric as it does not satisfy the triangle
+//! inequality. Ranking by cosine distance equals ranking by cosine similarity.
+struct Cosine {
+  //! \brief This tag specifies the supported space by this metric.
+  using SpaceTag = EuclideanSpaceTag;
+
+  template <
+      typename InputIterator1,
+      typename InputSentinel1,
+      typename InputIterator2>
+  constexpr auto operator()(
+      InputIterator1 begin1, InputSentinel1 end1, InputIterator2 begin2) const {
+    static_assert(
+        std::is_floating_point_v<
+            typename std::iterator_traits<InputIterator1>::value_type>,
+        "COSINE_REQUIRES_FLOATING_POINT_COORDINATES");
+    auto const d = internal::SumVectorized(
+        begin1, end1, begin2, internal::SquaredDistanceFn());
+    return decltype(d)(0.5) * d;
+  }
+
+  //! \brief Calculates the distance between two coordinates.
+  template <typename Scalar_>
+  constexpr auto operator()(Scalar_ x, Scalar_ y) const {
+    static_assert(
+        std::is_floating_point_v<Scalar_>,
+        "COSINE_REQUIRES_FLOATING_POINT_COORDINATES");
+    auto const d = internal::SquaredDistance(x, y);
+    return decltype(d)(0.5) * d;
+  }
+
+  //! \brief Returns half the squared value of \p x.
+  template <typename Scalar_>
+  constexpr auto operator()(Scalar_ x) const {
+    static_assert(
+        std::is_floating_point_v<Scalar_>,
+        "COSINE_REQUIRES_FLOATING_POINT_COORDINATES");
+    auto const d = internal::Squared(x);
+    return decltype(d)(0.5) * d;
+  }
+};
+
+//! \brief The WeightedL2Squared semimetric measures squared Euclidean
+//! distances between points of which each dimension has its own weight:
+//! sum_i w_i * (x_i - y_i)^2.
+//! \details Weights are useful when the coordinates of a point have different
+//! units. The distance of a single coordinate depends on its dimension, which
+//! the searches of a Euclidean space pass to the metric. Node box offsets are
+//! weighted as well and pruning stays exact.
+//! <p/>
+//! The weights are shared between copies of the metric. The metric has no
+//! default constructor and a KdTree should be created with an instance of it.
+template <typename Scalar_>
+class WeightedL2Squared {
+ public:
+  //! \brief This tag specifies the supported space by this metric.
+  using SpaceTag = EuclideanSpaceTag;
+  //! \brief Type of a weight.
+  using ScalarType = Scalar_;
+
+  //! \brief Creates a WeightedL2Squared metric given the \p weights of each
+  //! dimension. Weights should be positive.
+  explicit WeightedL2Squared(std::vector<ScalarType> weights)
+      : weights_(std::make_shared<std::vector<ScalarType> const>(
+            std::move(weights))) {}
+
+  template <
+      typename InputIterator1,
+      typename InputSentinel1,
+      typename InputIterator2>
+  constexpr auto operator()(
+      InputIterator1 begin1, InputSentinel1 end1, InputIterator2 begin2) const {
+    ScalarType const* w = weights_->data();
+    decltype(*w * internal::SquaredDistance(*begin1, *begin2)) d{};
+
+    for (; begin1 != end1; ++begin1, ++begin2, ++w) {
+      d += *w * internal::SquaredDistance(*begin1, *begin2);
+    }
+
+    return d;
+  }
+
+  //! \brief Calculates the distance between two coordinates of dimension \p
+  //! dim.
+  template <typename Coordinate_>
+  constexpr auto operator()(Coordinate_ x, Coordinate_ y, int dim) const {
+    return (*weights_)[static_cast<Size>(dim)] *
+           internal::SquaredDistance(x, y);
+  }
+
+  //! \brief Returns the weights of the dimensions.
+  inline std::vector<ScalarType> const& weights() const { return *weights_; }
+
+ private:
+  std::shared_ptr<std::vector<ScalarType> const> weights_;
+};
+
+//! \brief The DiagonalMahalanobis semimetric measures squared Mahalanobis
+//! distances between points for a covariance matrix that is diagonal:
+//! sum_i (x_i - y_i)^2 / var_i.
+//! \details It is a WeightedL2Squared metric of which the weights are the
+//! inverse variances. A full covariance matrix is supported by whitening the
+//! points and queries instead.
+//! \see WeightedL2Squared
+template <typename Scalar_>
+class DiagonalMahalanobis : public WeightedL2Squared<Scalar_> {
+ public:
+  using typename WeightedL2Squared<Scalar_>::ScalarType;
+
+  //! \brief Creates a DiagonalMahalanobis metric given the \p variances of
+  //! each dimension. Variances should be positive.
+  explicit DiagonalMahalanobis(std::vector<ScalarType> variances)
+      : WeightedL2Squared<Scalar_>(Inverse(std::move(variances))) {}
+
+ private:
+  static std::vector<ScalarType> Inverse(std::vector<ScalarType> v) {
+    for (auto& e : v) {
+      e = ScalarType(1.0) / e;
+    }
+    return v;
+  }
+};
+
 //! \brief The SO2 metric measures distances on the unit circle S1. It is the
 //! intrinsic metric of points in R2 on S1 given by the great-circel distance.
 //! \details Named after the Special Orthogonal Group of dimension 2. The circle
@@ -323,4 +688,180 @@ struct SE2Squared {
   }
 };
 
+namespace internal {
+
+//! \brief True if distances of \p Metric_ are a sum of the distances of
+//! individual coordinates, such that each coordinate distance is given by
+//! Metric_::operator()(Scalar_).
+template <typename Metric_>
+inline constexpr bool kIsCoordinateSumMetric = false;
+
+template <>
+inline constexpr bool kIsCoordinateSumMetric<L1> = true;
+
+template <>
+inline constexpr bool kIsCoordinateSumMetric<L2Squared> = true;
+
+template <int P_>
+inline constexpr bool kIsCoordinateSumMetric<Minkowski<P_>> = true;
+
+}  // namespace internal
+
+//! \brief The Periodic metric measures distances between points in a box with
+//! periodic boundary conditions, such as the simulation box of a molecular
+//! dynamics simulation. The box is a torus of which each dimension has its own
+//! length.
+//! \details Coordinates of dimension i should be in the range [0, length_i).
+//! The difference between two coordinates wraps around: the distance between
+//! them is min(|x_i - y_i|, length_i - |x_i - y_i|). The wrapped differences
+//! are combined by \p Metric_, which should be a sum of coordinate distances
+//! such as L1, L2Squared or Minkowski.
+//! <p/>
+//! Like the weights of WeightedL2Squared, the lengths are shared between
+//! copies of the metric and a KdTree should be created with an instance of it.
+//! \see WeightedL2Squared
+//! \see SO2
+template <typename Scalar_, typename Metric_>
+class Periodic {
+  static_assert(
+      internal::kIsCoordinateSumMetric<Metric_>,
+      "METRIC_IS_NOT_A_SUM_OF_COORDINATE_DISTANCES");
+
+ public:
+  //! \brief This tag specifies the supported space by this metric.
+  using SpaceTag = TopologicalSpaceTag;
+  //! \brief Type of a length.
+  using ScalarType = Scalar_;
+
+  //! \brief Creates a Periodic metric given the box \p lengths of each
+  //! dimension.
+  explicit Periodic(std::vector<ScalarType> lengths)
+      : lengths_(std::make_shared<std::vector<ScalarType> const>(
+            std::move(lengths))) {}
+
+  template <
+      typename InputIterator1,
+      typename InputSentinel1,
+      typename InputIterator2>
+  constexpr auto operator()(
+      InputIterator1 begin1, InputSentinel1 end1, InputIterator2 begin2) const {
+    using CoordinateType = std::decay_t<decltype(*begin1)>;
+    ScalarType const* length = lengths_->data();
+    decltype(metric_(CoordinateType())) d{};
+
+    for (; begin1 != end1; ++begin1, ++begin2, ++length) {
+      d += metric_(internal::PeriodicDistance(
+          *begin1, *begin2, static_cast<CoordinateType>(*length)));
+    }
+
+    return d;
+  }
+
+  //! \brief Calculates the distance between coordinate \p x and the box
+  //! defined by [ \p min, \p max ] in dimension \p dim.
+  template <typename Coordinate_>
+  constexpr auto operator()(
+      Coordinate_ x, Coordinate_ min, Coordinate_ max, int dim) const {
+    return metric_(internal::PeriodicDistanceBox(
+        x,
+        min,
+        max,
+        static_cast<Coordinate_>((*lengths_)[static_cast<Size>(dim)])));
+  }
+
+  //! \brief Returns the distance of coordinate \p x using Metric_.
+  template <typename Coordinate_>
+  constexpr auto operator()(Coordinate_ x) const {
+    return metric_(x);
+  }
+
+  //! \brief Returns the box lengths of the dimensions.
+  inline std::vector<ScalarType> const& lengths() const { return *lengths_; }
+
+ private:
+  Metric_ metric_;
+  std::shared_ptr<std::vector<ScalarType> const> lengths_;
+};
+
+//! \brief The Haversine semimetric measures great-circle distances between
+//! points on a sphere given by their latitude and longitude in radians.
+//! \details A point is represented by the coordinates (latitude, longitude),
+//! with latitudes in the range [-PI / 2, PI / 2] and longitudes in the range
+//! [-PI, PI] / -PI ~ PI. The distance between two points is the haversine of
+//! their central angle a, hav(a) = sin^2(a / 2), which is calculated as:
+//! hav(a) = hav(lat2 - lat1) + cos(lat1) cos(lat2) hav(lon2 - lon1)
+//! Like L2Squared, the distance is monotonic in the actual distance and it is
+//! cheaper to compute. The central angle equals 2 asin(sqrt(hav(a))) and the
+//! distance on a sphere with radius R equals R times that angle. A radius is
+//! converted to a haversine using operator()(Scalar_).
+//! <p/>
+//! Both terms of the haversine are non-negative, such that node boxes bound
+//! each of them separately:
+//! * A latitude range bounds the first term by the haversine of the distance
+//! to the range.
+//! * A longitude range bounds the second term by the haversine of the angular
+//! distance to the range, which wraps around -PI ~ PI, times a lower bound of
+//! cos(lat1) cos(lat2). This lower bound is cos^2 of the maximum absolute
+//! latitude of all points and queries. By default it is PI / 2, in which case
+//! only latitudes prune the search.
+//! <p/>
+//! An alternative without the need for a latitude bound is to convert the
+//! points to unit vectors and to search them using the L2Squared metric. The
+//! squared chord length between two unit vectors equals 4 hav(a).
+//!
+//! For more details:
+//! * https://en.wikipedia.org/wiki/Haversine_formula
+class Haversine {
+ public:
+  //! \brief This tag specifies the supported space by this metric.
+  using SpaceTag = TopologicalSpaceTag;
+
+  //! \brief Creates a Haversine metric for points and queries anywhere on the
+  //! sphere.
+  Haversine() = default;
+
+  //! \brief Creates a Haversine metric for points and queries of which the
+  //! absolute latitude is at most \p max_abs_latitude.
+  explicit Haversine(double max_abs_latitude)
+      : cos2_max_abs_latitude_(internal::Squared(std::cos(max_abs_latitude))) {}
+
+  template <
+      typename InputIterator1,
+      typename InputSentinel1,
+      typename InputIterator2>
+  inline auto operator()(
+      InputIterator1 begin1, InputSentinel1, InputIterator2 begin2) const {
+    auto const lat1 = *begin1;
+    auto const lat2 = *begin2;
+    auto const h = internal::Haversine(lat2 - lat1) +
+                   std::cos(lat1) * std::cos(lat2) *
+                       internal::Haversine(*(begin2 + 1) - *(begin1 + 1));
+    // Rounding may result in a value slightly larger than 1.
+    return std::min(h, decltype(h)(1.0));
+  }
+
+  //! \brief Calculates a lower bound of the distance between coordinate \p x
+  //! and the box defined by [ \p min, \p max ] in dimension \p dim.
+  template <typename Scalar_>
+  inline Scalar_ operator()(
+      Scalar_ x, Scalar_ min, Scalar_ max, int dim) const {
+    if (dim == 0) {
+      return internal::Haversine(internal::DistanceBox(x, min, max));
+    } else {
+      return static_cast<Scalar_>(cos2_max_abs_latitude_) *
+             internal::Haversine(internal::AngleDistanceBox(x, min, max));
+    }
+  }
+
+  //! \brief Returns the haversine of angle \p x.
+  template <typename Scalar_>
+  inline Scalar_ operator()(Scalar_ x) const {
+    return internal::Haversine(x);
+  }
+
+ private:
+  //! \brief Lower bound of cos(lat1) cos(lat2).
+  double cos2_max_abs_latitude_{0.0};
+};
+
 }  // namespace pico_tree
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+#include <type_traits>
+
+#include "core.hpp"
+
+namespace pico_tree {
+
+//! \brief PrefetchTraits controls the software prefetching of a nearest
+//! neighbor search through a space.
+//! \details Prefetching is disabled by default. Its benefit depends on the
+//! hardware, the size of the space and the memory layout of its points. It
+//! can be enabled for a space type by specializing this class:
+//! \code{.cpp}
+//! template <>
+//! struct pico_tree::PrefetchTraits<std::vector<Point3f>> {
+//!   static bool constexpr kPrefetchNodes = true;
+//!   static pico_tree::Size constexpr kPrefetchPointDistance = 4;
+//! };
+//! \endcode
+//! \tparam Space_ Any of the space types supported by SpaceTraits.
+template <typename Space_>
+struct PrefetchTraits {
+  //! \brief When true, the second child of a branch is prefetched before the
+  //! search descends into the first one.
+  static bool constexpr kPrefetchNodes = false;
+  //! \brief The number of points ahead of the current one that are prefetched
+  //! while scanning a leaf. A value of zero disables prefetching of points.
+  static Size constexpr kPrefetchPointDistance = 0;
+};
+
+//! \brief Provides the PrefetchTraits of Space_ for
+//! std::reference_wrapper<Space_>.
+template <typename Space_>
+struct PrefetchTraits<std::reference_wrapper<Space_>>
+    : public PrefetchTraits<std::remove_const_t<Space_>> {};
+
+}  // namespace pico_tree
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <pico_toolshed/point.hpp>
+#include <pico_tree/kd_tree.hpp>
+#include <pico_tree/map_traits.hpp>
+#include <pico_tree/vector_traits.hpp>
+#include <pico_understory/compact_kd_tree.hpp>
+
+#include "common.hpp"
+
+namespace {
+
+template <typename PointX>
+using CompactKdTree = pico_tree::CompactKdTree<std::vector<PointX>>;
+
+}  // namespace
+
+TEST(CompactKdTreeTest, NodeSize) {
+  EXPECT_EQ(sizeof(pico_tree::internal::CompactKdTreeNode), 8);
+}
+
+TEST(CompactKdTreeTest, NodeEncoding) {
+  using NodeType = pico_tree::internal::CompactKdTreeNode;
+
+  NodeType branch = NodeType::Branch(1023, 5, NodeType::kMaxBound, 123456789);
+  EXPECT_FALSE(branch.IsLeaf());
+  EXPECT_EQ(branch.split_dim(), 1023);
+  EXPECT_EQ(branch.left_max(), 5);
+  EXPECT_EQ(branch.right_min(), NodeType::kMaxBound);
+  EXPECT_EQ(branch.right(), 123456789);
+
+  NodeType leaf = NodeType::Leaf(4000000000, 4000000008);
+  EXPECT_TRUE(leaf.IsLeaf());
+  EXPECT_EQ(leaf.begin_idx(), 4000000000);
+  EXPECT_EQ(leaf.end_idx(), 4000000008);
+}
+
+TEST(CompactKdTreeTest, Quantize) {
+  using NodeType = pico_tree::internal::CompactKdTreeNode;
+
+  float const min = -3.7f;
+  float const max = 12.1f;
+  EXPECT_EQ(NodeType::Dequantize(0, min, max), min);
+  EXPECT_EQ(NodeType::Dequantize(NodeType::kMaxBound, min, max), max);
+
+  std::vector<Point1f> values = GenerateRandomN<Point1f>(1024, min, max);
+  values.push_back(Point1f{min});
+  values.push_back(Point1f{max});
+  for (auto const& p : values) {
+    float const v = p[0];
+    auto const up = NodeType::QuantizeUp(v, min, max);
+    auto const down = NodeType::QuantizeDown(v, min, max);
+    // Bounds are conservative.
+    EXPECT_GE(NodeType::Dequantize(up, min, max), v);
+    EXPECT_LE(NodeType::Dequantize(down, min, max), v);
+    // Bounds are tight.
+    EXPECT_LE(up - down, 1);
+  }
+}
+
+TEST(CompactKdTreeTest, QueryKnn) {
+  using PointX = Point3f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 128, 100.0f);
+  CompactKdTree<PointX> tree(random, 8);
+
+  TestKnn(tree, 10);
+}
+
+TEST(CompactKdTreeTest, QueryRadius) {
+  using PointX = Point2f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 128, 100.0f);
+  CompactKdTree<PointX> tree(random, 8);
+
+  TestRadius(tree, 2.5f);
+}
+
+// The compact tree has the same structure as a KdTree and the results of both
+// should be the same.
+TEST(CompactKdTreeTest, SameAsKdTree) {
+  using PointX = Point2f;
+  using NeighborType = pico_tree::Neighbor<int, float>;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 64, 100.0f);
+  pico_tree::KdTree<std::vector<PointX>> tree(random, 8);
+  CompactKdTree<PointX> compact(random, 8);
+
+  std::vector<PointX> queries = GenerateRandomN<PointX>(256, 110.0f);
+  std::vector<NeighborType> knn;
+  std::vector<NeighborType> compact_knn;
+  for (auto const& q : queries) {
+    tree.SearchKnn(q, 8, knn);
+    compact.SearchKnn(q, 8, compact_knn);
+    ASSERT_EQ(knn.size(), compact_knn.size());
+    for (std::size_t i = 0; i < knn.size(); ++i) {
+      EXPECT_EQ(knn[i].distance, compact_knn[i].distance);
+    }
+  }
+}
+
+// A query with a run-time dimension is searched with the compile-time
+// dimension of the tree.
+TEST(CompactKdTreeTest, QueryKnnRtQuery) {
+  using PointX = Point3f;
+  using PointMapX = pico_tree::PointMap<float const, pico_tree::kDynamicSize>;
+  using NeighborType = pico_tree::Neighbor<int, float>;
+
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 64, 100.0f);
+  CompactKdTree<PointX> tree(random, 8);
+
+  std::vector<NeighborType> knn;
+  std::vector<NeighborType> rt_knn;
+  for (auto const& q : GenerateRandomN<PointX>(256, 110.0f)) {
+    tree.SearchKnn(q, 8, knn);
+    tree.SearchKnn(PointMapX(q.data(), q.size()), 8, rt_knn);
+    ASSERT_EQ(knn.size(), rt_knn.size());
+    for (std::size_t i = 0; i < knn.size(); ++i) {
+      EXPECT_EQ(knn[i].index, rt_knn[i].index);
+    }
+  }
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory_resource>
+#include <pico_toolshed/point.hpp>
+#include <pico_tree/kd_tree.hpp>
+#include <pico_tree/vector_traits.hpp>
+#include <pico_understory/huge_page_memory_resource.hpp>
+
+#include "common.hpp"
+
+using HugePageMemoryResource = pico_tree::HugePageMemoryResource;
+
+TEST(HugePageMemoryResourceTest, Allocate) {
+  for (auto mode :
+       {pico_tree::HugePageMode::kTransparent,
+        pico_tree::HugePageMode::kExplicit}) {
+    HugePageMemoryResource resource(mode);
+    EXPECT_EQ(resource.mode(), mode);
+
+    // Large allocations are aligned to a huge page. Huge pages may be
+    // unavailable, but the memory is always usable.
+    std::size_t const size = HugePageMemoryResource::kHugePageSize * 3 / 2;
+    auto* large = static_cast<std::uint8_t*>(resource.allocate(size));
+    EXPECT_EQ(
+        reinterpret_cast<std::uintptr_t>(large) %
+            HugePageMemoryResource::kHugePageSize,
+        0);
+    large[0] = 1;
+    large[size - 1] = 2;
+    EXPECT_EQ(large[0] + large[size - 1], 3);
+    resource.deallocate(large, size);
+
+    // Small allocations go to the upstream resource.
+    void* small = resource.allocate(64, 16);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(small) % 16, 0);
+    resource.deallocate(small, 64, 16);
+  }
+}
+
+TEST(HugePageMemoryResourceTest, KdTree) {
+  using PointX = Point3f;
+  using Scalar = typename PointX::ScalarType;
+
+  std::vector<PointX> random = GenerateRandomN<PointX>(200000, Scalar(100.0));
+  HugePageMemoryResource resource;
+  std::pmr::vector<PointX> points(random.begin(), random.end(), &resource);
+  pico_tree::KdTree<std::pmr::vector<PointX>> tree(
+      std::move(points), 8, &resource);
+
+  EXPECT_EQ(tree.points().get_allocator().resource(), &resource);
+  EXPECT_EQ(tree.resource(), &resource);
+  TestKnn(tree, 8);
+}
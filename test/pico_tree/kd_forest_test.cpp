@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <pico_toolshed/point.hpp>
+#include <pico_tree/kd_tree.hpp>
+#include <pico_tree/vector_traits.hpp>
+#include <pico_understory/kd_forest.hpp>
+
+#include "common.hpp"
+
+using PointX = Point3f;
+using Scalar = typename PointX::ScalarType;
+
+namespace {
+
+// Points are stretched along the diagonal (1, 1, 0) and flattened along z.
+std::vector<PointX> GenerateStretched(std::size_t point_count) {
+  std::vector<PointX> points = GenerateRandomN<PointX>(point_count, 1.0f);
+  for (auto& p : points) {
+    Scalar const t = (p[0] - 0.5f) * 100.0f;
+    p[0] = t + p[1];
+    p[1] = t - p[1];
+    p[2] *= 0.01f;
+  }
+  return points;
+}
+
+}  // namespace
+
+TEST(KdForestTest, PrincipalAxes) {
+  std::vector<PointX> points = GenerateStretched(1024);
+  pico_tree::internal::SpaceWrapper<std::vector<PointX>> space(points);
+
+  auto axes = pico_tree::internal::PrincipalAxes<Scalar, PointX::Dim>(space, 4);
+  ASSERT_EQ(axes.size(), 4);
+
+  Scalar const inv_sqrt2 = Scalar(1.0) / std::sqrt(Scalar(2.0));
+  EXPECT_NEAR(std::abs(axes[0][0]), inv_sqrt2, 1e-3f);
+  EXPECT_NEAR(std::abs(axes[0][1]), inv_sqrt2, 1e-3f);
+  EXPECT_NEAR(std::abs(axes[1][0]), inv_sqrt2, 1e-3f);
+  EXPECT_NEAR(std::abs(axes[1][1]), inv_sqrt2, 1e-3f);
+  EXPECT_NEAR(std::abs(axes[2][2]), Scalar(1.0), 1e-3f);
+  // Axes beyond the spatial dimension repeat.
+  EXPECT_EQ(axes[3][0], axes[0][0]);
+
+  // The reflection maps the principal axis onto the first coordinate axis.
+  using DataX = pico_tree::internal::RKdTreeHhData<
+      pico_tree::internal::KdTreeNodeTopological<int, Scalar>,
+      PointX::Dim>;
+  auto const v = DataX::PrincipalAxisRotation(axes[0]);
+  Scalar dot = Scalar(0.0);
+  for (std::size_t i = 0; i < PointX::Dim; ++i) {
+    dot += v[i] * axes[0][i];
+  }
+  EXPECT_NEAR(std::abs(axes[0][0] - Scalar(2.0) * dot * v[0]), 1.0f, 1e-5f);
+  EXPECT_NEAR(axes[0][1] - Scalar(2.0) * dot * v[1], 0.0f, 1e-5f);
+  EXPECT_NEAR(axes[0][2] - Scalar(2.0) * dot * v[2], 0.0f, 1e-5f);
+}
+
+TEST(KdForestTest, QueryNnPrincipalAxis) {
+  using SpaceX = std::vector<PointX>;
+  using KdForestX = pico_tree::KdForest<
+      SpaceX,
+      pico_tree::L2Squared,
+      pico_tree::SplittingRule::kMaxVariance>;
+
+  std::vector<PointX> points = GenerateStretched(1024 * 4);
+  KdForestX forest(points, 8, 3, pico_tree::RotationRule::kPrincipalAxis);
+
+  // When all leaves may be visited the search is exact.
+  std::vector<PointX> queries = GenerateStretched(64);
+  for (auto const& q : queries) {
+    typename KdForestX::NeighborType nn;
+    forest.SearchNn(q, points.size(), nn);
+
+    std::vector<typename KdForestX::NeighborType> nns;
+    SearchKnn<pico_tree::SpaceTraits<SpaceX>>(
+        q, points, 1, pico_tree::L2Squared(), &nns);
+    // Distances differ slightly because of rounding in the rotated space.
+    EXPECT_EQ(nn.index, nns[0].index);
+  }
+}
+
+TEST(KdForestTest, QueryNnCosine) {
+  using SpaceX = std::vector<PointX>;
+  using KdForestX = pico_tree::KdForest<SpaceX, pico_tree::Cosine>;
+
+  auto generate_normalized = [](std::size_t point_count) {
+    std::vector<PointX> points =
+        GenerateRandomN<PointX>(point_count, -1.0f, 1.0f);
+    for (auto& p : points) {
+      p.Normalize();
+    }
+    return points;
+  };
+
+  std::vector<PointX> points = generate_normalized(1024 * 4);
+  KdForestX forest(points, 8, 3);
+
+  // When all leaves may be visited the search is exact.
+  for (auto const& q : generate_normalized(64)) {
+    typename KdForestX::NeighborType nn;
+    forest.SearchNn(q, points.size(), nn);
+
+    std::vector<typename KdForestX::NeighborType> nns;
+    SearchKnn<pico_tree::SpaceTraits<SpaceX>>(
+        q, points, 1, pico_tree::Cosine(), &nns);
+    EXPECT_EQ(nn.index, nns[0].index);
+  }
+}
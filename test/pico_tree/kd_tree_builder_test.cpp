@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <cstdint>
+#include <functional>
+#include <numeric>
 #include <pico_toolshed/point.hpp>
 #include <pico_tree/internal/kd_tree_builder.hpp>
 #include <pico_tree/internal/space_wrapper.hpp>
@@ -12,6 +15,67 @@ using Space = std::reference_wrapper<std::vector<PointX>>;
 
 }  // namespace
 
+TEST(KdTreeTest, ToRadixKey) {
+  using pico_tree::internal::ToRadixKey;
+
+  std::vector<float> f{-1e30f, -2.5f, -1.0f, -0.0f, 1e-30f, 1.0f, 2.5f, 1e30f};
+  for (std::size_t i = 1; i < f.size(); ++i) {
+    EXPECT_LT(ToRadixKey(f[i - 1]), ToRadixKey(f[i]));
+  }
+  EXPECT_EQ(ToRadixKey(-0.0f), ToRadixKey(0.0f));
+  EXPECT_EQ(ToRadixKey(-0.0), ToRadixKey(0.0));
+  EXPECT_LT(ToRadixKey(-3.0), ToRadixKey(-2.0));
+  EXPECT_LT(ToRadixKey(-1), ToRadixKey(0));
+  EXPECT_LT(ToRadixKey(std::int64_t{-5}), ToRadixKey(std::int64_t{3}));
+  EXPECT_LT(ToRadixKey(std::uint8_t{3}), ToRadixKey(std::uint8_t{200}));
+}
+
+TEST(KdTreeTest, RadixSelect) {
+  using PointX = Point2f;
+  using Index = int;
+  using Scalar = typename PointX::ScalarType;
+  using SpaceX = Space<PointX>;
+  using SelectX = pico_tree::internal::RadixSelect<
+      pico_tree::internal::SpaceWrapper<SpaceX>>;
+
+  // Enough points to not fall back to std::nth_element. Many coordinates are
+  // equal and half of them are negative.
+  std::vector<PointX> points = GenerateRandomN<PointX>(1024 * 16, 100.0f);
+  for (auto& p : points) {
+    p[1] = std::floor(p[1]) - Scalar(50.0);
+  }
+  SpaceX space(points);
+  pico_tree::internal::SpaceWrapper<SpaceX> space_wrapper(space);
+
+  std::vector<Scalar> sorted;
+  for (auto const& p : points) {
+    sorted.push_back(p[1]);
+  }
+  std::sort(sorted.begin(), sorted.end());
+
+  SelectX select(space_wrapper);
+  std::size_t const size = points.size();
+  for (std::size_t nth : {std::size_t(0), size / 3, size - 1}) {
+    std::vector<Index> indices(points.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    auto const it = indices.begin() + static_cast<std::ptrdiff_t>(nth);
+    select(indices.begin(), it, indices.end(), 1);
+
+    Scalar const v = points[*it][1];
+    EXPECT_EQ(v, sorted[nth]);
+    for (auto i = indices.begin(); i < it; ++i) {
+      EXPECT_LE(points[*i][1], v);
+    }
+    for (auto i = it; i < indices.end(); ++i) {
+      EXPECT_GE(points[*i][1], v);
+    }
+    std::sort(indices.begin(), indices.end());
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+      ASSERT_EQ(indices[i], static_cast<Index>(i));
+    }
+  }
+}
+
 TEST(KdTreeTest, SplitterMedian) {
   using PointX = Point2f;
   using Index = int;
@@ -195,3 +259,221 @@ TEST(KdTreeTest, SplitterSlidingMidpoint) {
   EXPECT_EQ(split_dim, 0);
   EXPECT_EQ(split_val, ptsx4[3][0]);
 }
+
+TEST(KdTreeTest, SplitterSurfaceAreaHeuristic) {
+  using PointX = Point2f;
+  using Index = int;
+  using Scalar = typename PointX::ScalarType;
+  using SpaceX = Space<PointX>;
+  using SplitterX = pico_tree::internal::SplitterSurfaceAreaHeuristic<
+      pico_tree::internal::SpaceWrapper<SpaceX>>;
+
+  // A dense cluster of points and a single far away outlier.
+  std::vector<PointX> ptsx9{
+      {100.0f, 0.5f},
+      {0.0f, 0.0f},
+      {0.5f, 0.0f},
+      {1.0f, 0.0f},
+      {0.0f, 0.5f},
+      {1.0f, 0.5f},
+      {0.0f, 1.0f},
+      {0.5f, 1.0f},
+      {1.0f, 1.0f}};
+  SpaceX spcx9(ptsx9);
+  pico_tree::internal::SpaceWrapper<SpaceX> spcx9_wrapper(spcx9);
+  std::vector<Index> idx9{0, 1, 2, 3, 4, 5, 6, 7, 8};
+
+  SplitterX splitter(spcx9_wrapper);
+
+  pico_tree::internal::Box<Scalar, 2> box(2);
+  std::vector<Index>::iterator split;
+  pico_tree::Size split_dim;
+  Scalar split_val;
+
+  // The midpoint would split at 50. The cheapest split tightly wraps the
+  // cluster at the first bin boundary of the longest side: 100 / 32.
+  box.min(0) = Scalar{0.0};
+  box.min(1) = Scalar{0.0};
+  box.max(0) = Scalar{100.0};
+  box.max(1) = Scalar{1.0};
+  splitter(0, idx9.begin(), idx9.end(), box, split, split_dim, split_val);
+
+  EXPECT_EQ(split - idx9.begin(), 8);
+  EXPECT_EQ(split_dim, 0);
+  EXPECT_FLOAT_EQ(split_val, Scalar{100.0} / Scalar{32.0});
+  EXPECT_EQ(idx9[8], 0);
+
+  // All points fall into the first bin of the only side that isn't flat. The
+  // split falls back to the midpoint and the largest point slides to the
+  // right side.
+  box.max(1) = Scalar{0.0};
+  std::vector<Index> idx3{1, 2, 3};
+  splitter(0, idx3.begin(), idx3.end(), box, split, split_dim, split_val);
+
+  EXPECT_EQ(split - idx3.begin(), 2);
+  EXPECT_EQ(split_dim, 0);
+  EXPECT_EQ(split_val, ptsx9[3][0]);
+  EXPECT_EQ(idx3[2], 3);
+}
+
+TEST(KdTreeTest, SplitterMaxVariance) {
+  using PointX = Point2f;
+  using Index = int;
+  using Scalar = typename PointX::ScalarType;
+  using SpaceX = Space<PointX>;
+  using SplitterX = pico_tree::internal::SplitterMaxVariance<
+      pico_tree::internal::SpaceWrapper<SpaceX>>;
+
+  // The first dimension has the longest side because of a single outlier, but
+  // most of the variance is in the second dimension.
+  std::vector<PointX> ptsx6{
+      {0.0f, 0.0f},
+      {0.0f, 1.0f},
+      {0.0f, 9.0f},
+      {0.0f, 10.0f},
+      {0.0f, 0.0f},
+      {12.0f, 10.0f}};
+  SpaceX spcx6(ptsx6);
+  pico_tree::internal::SpaceWrapper<SpaceX> spcx6_wrapper(spcx6);
+  std::vector<Index> idx6{0, 1, 2, 3, 4, 5};
+
+  SplitterX splitter(spcx6_wrapper);
+
+  pico_tree::internal::Box<Scalar, 2> box(2);
+  box.min(0) = Scalar{0.0};
+  box.min(1) = Scalar{0.0};
+  box.max(0) = Scalar{12.0};
+  box.max(1) = Scalar{10.0};
+  std::vector<Index>::iterator split;
+  pico_tree::Size split_dim;
+  Scalar split_val;
+
+  splitter(0, idx6.begin(), idx6.end(), box, split, split_dim, split_val);
+
+  EXPECT_EQ(split - idx6.begin(), 3);
+  EXPECT_EQ(split_dim, 1);
+  EXPECT_FLOAT_EQ(split_val, Scalar{5.0});
+}
+
+TEST(KdTreeTest, SplitterMaxSpreadSample) {
+  using PointX = Point2f;
+  using Index = int;
+  using Scalar = typename PointX::ScalarType;
+  using SpaceX = Space<PointX>;
+  using SplitterX = pico_tree::internal::SplitterMaxSpreadSample<
+      pico_tree::internal::SpaceWrapper<SpaceX>>;
+
+  std::vector<PointX> ptsx5{
+      {0.0f, 4.0f},
+      {1.0f, 0.0f},
+      {2.0f, 3.0f},
+      {3.0f, 1.0f},
+      {4.0f, 8.0f}};
+  SpaceX spcx5(ptsx5);
+  pico_tree::internal::SpaceWrapper<SpaceX> spcx5_wrapper(spcx5);
+  std::vector<Index> idx5{0, 1, 2, 3, 4};
+
+  SplitterX splitter(spcx5_wrapper);
+
+  pico_tree::internal::Box<Scalar, 2> box(2);
+  box.min(0) = Scalar{0.0};
+  box.min(1) = Scalar{0.0};
+  box.max(0) = Scalar{4.0};
+  box.max(1) = Scalar{8.0};
+  std::vector<Index>::iterator split;
+  pico_tree::Size split_dim;
+  Scalar split_val;
+
+  // The median of the second dimension is 3. All sampled points are used
+  // because there are fewer than the sample size.
+  splitter(0, idx5.begin(), idx5.end(), box, split, split_dim, split_val);
+
+  EXPECT_EQ(split - idx5.begin(), 2);
+  EXPECT_EQ(split_dim, 1);
+  EXPECT_EQ(split_val, Scalar{3.0});
+}
+
+TEST(KdTreeTest, SplitterSampledMedian) {
+  using PointX = Point2f;
+  using Index = int;
+  using Scalar = typename PointX::ScalarType;
+  using SpaceX = Space<PointX>;
+  using SplitterX = pico_tree::internal::SplitterSampledMedian<
+      pico_tree::internal::SpaceWrapper<SpaceX>>;
+
+  std::vector<PointX> points = GenerateRandomN<PointX>(256, 100.0f);
+  SpaceX space(points);
+  pico_tree::internal::SpaceWrapper<SpaceX> space_wrapper(space);
+
+  pico_tree::SplittingRuleOptions options;
+  options.sample_size = 5;
+  SplitterX splitter(space_wrapper, options);
+
+  pico_tree::internal::Box<Scalar, 2> box(2);
+  box.min(0) = Scalar{0.0};
+  box.min(1) = Scalar{0.0};
+  box.max(0) = Scalar{50.0};
+  box.max(1) = Scalar{100.0};
+  std::vector<Index>::iterator split;
+  pico_tree::Size split_dim;
+  Scalar split_val;
+
+  // The split value is random, but it is a coordinate of one of the points
+  // and the split is always valid.
+  for (int i = 0; i < 16; ++i) {
+    std::vector<Index> indices(points.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    splitter(
+        0, indices.begin(), indices.end(), box, split, split_dim, split_val);
+
+    EXPECT_EQ(split_dim, 1);
+    EXPECT_GT(split - indices.begin(), 0);
+    EXPECT_LT(split - indices.begin(), static_cast<long>(points.size()));
+    for (auto it = indices.begin(); it < split; ++it) {
+      EXPECT_LT(points[*it][1], split_val);
+    }
+    for (auto it = split; it < indices.end(); ++it) {
+      EXPECT_GE(points[*it][1], split_val);
+    }
+  }
+}
+
+TEST(KdTreeTest, MedianNodeCount) {
+  using pico_tree::Size;
+
+  // Each range of more than max_leaf_size indices is split in half.
+  std::function<Size(Size, Size)> node_count = [&node_count](
+                                                   Size count,
+                                                   Size max_leaf_size) -> Size {
+    if (count <= max_leaf_size) {
+      return 1;
+    }
+    return 1 + node_count(count / 2, max_leaf_size) +
+           node_count(count - count / 2, max_leaf_size);
+  };
+
+  for (Size max_leaf_size : {1, 2, 3, 7, 10}) {
+    for (Size count = 1; count < 1000; ++count) {
+      auto const counts =
+          pico_tree::internal::MedianNodeCount(count, max_leaf_size);
+      EXPECT_EQ(counts[0], node_count(count, max_leaf_size));
+      EXPECT_EQ(counts[1], node_count(count + 1, max_leaf_size));
+    }
+  }
+}
+
+TEST(KdTreeTest, ChunkAllocator) {
+  pico_tree::internal::ChunkAllocator<int, 4> allocator(6);
+  EXPECT_EQ(allocator.capacity(), 6);
+
+  // The reserved objects are contiguous.
+  int* first = allocator.Allocate();
+  for (int i = 1; i < 6; ++i) {
+    EXPECT_EQ(allocator.Allocate(), first + i);
+  }
+  EXPECT_EQ(allocator.capacity(), 6);
+
+  // Running out of reserved memory adds a chunk.
+  allocator.Allocate();
+  EXPECT_EQ(allocator.capacity(), 10);
+}
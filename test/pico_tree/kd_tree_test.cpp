@@ -1,10 +1,16 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <filesystem>
+#include <memory_resource>
 #include <pico_toolshed/dynamic_space.hpp>
 #include <pico_toolshed/point.hpp>
+#include <pico_tree/array_traits.hpp>
 #include <pico_tree/kd_tree.hpp>
+#include <pico_tree/map_traits.hpp>
 #include <pico_tree/vector_traits.hpp>
+#include <random>
 
 #include "common.hpp"
 
@@ -41,13 +47,17 @@ void QueryRadius(
   TestRadius(tree, radius);
 }
 
-template <typename PointX>
+template <
+    typename PointX,
+    pico_tree::SplittingRule SplittingRule_ =
+        pico_tree::SplittingRule::kSlidingMidpoint>
 void QueryKnn(
     int const point_count,
     typename PointX::ScalarType const area_size,
     int const k) {
   std::vector<PointX> random = GenerateRandomN<PointX>(point_count, area_size);
-  KdTree<PointX> tree1(random, 8);
+  pico_tree::KdTree<Space<PointX>, pico_tree::L2Squared, SplittingRule_> tree1(
+      random, 8);
 
   // "Test" move constructor.
   auto tree2 = std::move(tree1);
@@ -57,6 +67,164 @@ void QueryKnn(
   TestKnn(tree1, static_cast<typename KdTree<PointX>::IndexType>(k));
 }
 
+// Points are clustered on a plane with a few far away outliers.
+template <pico_tree::SplittingRule SplittingRule_>
+void QueryKnnAnisotropic(int const point_count, int const k) {
+  using PointX = Point3f;
+
+  std::vector<PointX> random = GenerateRandomN<PointX>(point_count, 100.0f);
+  for (std::size_t i = 0; i < random.size(); ++i) {
+    random[i][2] = i % 64 == 0 ? random[i][2] * 100.0f : random[i][2] * 0.01f;
+  }
+  pico_tree::KdTree<Space<PointX>, pico_tree::L2Squared, SplittingRule_> tree(
+      random, 8);
+
+  TestKnn(tree, static_cast<typename KdTree<PointX>::IndexType>(k));
+}
+
+template <typename PointX>
+void QueryKnnIf(
+    int const point_count,
+    typename PointX::ScalarType const area_size,
+    int const k,
+    int const label_count) {
+  using Index = typename KdTree<PointX>::IndexType;
+  using Scalar = typename PointX::ScalarType;
+  using NeighborX = pico_tree::Neighbor<Index, Scalar>;
+
+  std::vector<PointX> random = GenerateRandomN<PointX>(point_count, area_size);
+  KdTree<PointX> tree(random, 8);
+
+  // Only points with label 0 pass the filter. The more labels, the more sparse
+  // the matching points become.
+  auto filter = [label_count](Index i) { return i % label_count == 0; };
+  PointX const& p = random[random.size() / 2];
+
+  std::vector<NeighborX> compare;
+  for (std::size_t i = 0; i < random.size(); ++i) {
+    Index idx = static_cast<Index>(i);
+    if (filter(idx)) {
+      compare.push_back(
+          {idx,
+           tree.metric()(p.data(), p.data() + p.size(), random[i].data())});
+    }
+  }
+  std::sort(compare.begin(), compare.end());
+  compare.resize(std::min(compare.size(), static_cast<std::size_t>(k)));
+
+  std::vector<NeighborX> knn;
+  tree.SearchKnnIf(p, static_cast<pico_tree::Size>(k), filter, knn);
+
+  ASSERT_EQ(compare.size(), knn.size());
+  for (std::size_t i = 0; i < compare.size(); ++i) {
+    EXPECT_TRUE(filter(knn[i].index));
+    FloatEq(knn[i].distance, compare[i].distance);
+  }
+
+  NeighborX nn;
+  tree.SearchNnIf(p, filter, nn);
+  EXPECT_TRUE(filter(nn.index));
+  FloatEq(nn.distance, compare.front().distance);
+
+  Scalar const radius = tree.metric()(area_size / Scalar(10.0));
+  std::vector<NeighborX> n;
+  tree.SearchRadiusIf(p, radius, filter, n);
+
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < random.size(); ++i) {
+    if (filter(static_cast<Index>(i)) &&
+        tree.metric()(p.data(), p.data() + p.size(), random[i].data()) <=
+            radius) {
+      ++count;
+    }
+  }
+
+  EXPECT_EQ(count, n.size());
+  for (auto const& r : n) {
+    EXPECT_TRUE(filter(r.index));
+    EXPECT_LE(r.distance, radius);
+  }
+}
+
+template <typename Tree, typename PointX>
+void TestKnnMaxLeavesVisited(
+    Tree const& tree, pico_tree::Size const k, PointX const& p) {
+  using Index = typename Tree::IndexType;
+  using Scalar = typename Tree::ScalarType;
+  using NeighborX = pico_tree::Neighbor<Index, Scalar>;
+
+  std::vector<NeighborX> results_exact;
+  tree.SearchKnn(p, k, results_exact);
+
+  // With an unbounded number of leaves the search is exact.
+  std::vector<NeighborX> results_unbounded;
+  tree.SearchKnn(p, k, pico_tree::MaxLeavesVisited(), results_unbounded);
+
+  ASSERT_EQ(results_exact.size(), results_unbounded.size());
+  for (std::size_t i = 0; i < results_exact.size(); ++i) {
+    FloatEq(results_exact[i].distance, results_unbounded[i].distance);
+  }
+
+  // A single leaf is the bare minimum. The results can't be any closer than
+  // the exact ones.
+  std::vector<NeighborX> results_bounded;
+  tree.SearchKnn(p, k, pico_tree::MaxLeavesVisited{1}, results_bounded);
+
+  ASSERT_LE(results_bounded.size(), results_exact.size());
+  for (std::size_t i = 0; i < results_bounded.size(); ++i) {
+    FloatLe(results_exact[i].distance, results_bounded[i].distance);
+  }
+
+  NeighborX nn;
+  tree.SearchNn(p, pico_tree::MaxLeavesVisited{4}, nn);
+  FloatLe(results_exact[0].distance, nn.distance);
+
+  tree.SearchKnn(p, 0, pico_tree::MaxLeavesVisited{1}, results_bounded);
+  EXPECT_TRUE(results_bounded.empty());
+}
+
+template <typename Tree, typename PointX>
+void TestKnnSearchBudget(
+    Tree const& tree, pico_tree::Size const k, PointX const& p) {
+  using Index = typename Tree::IndexType;
+  using Scalar = typename Tree::ScalarType;
+  using NeighborX = pico_tree::Neighbor<Index, Scalar>;
+
+  std::vector<NeighborX> results_exact;
+  tree.SearchKnn(p, k, results_exact);
+
+  // The default budget is unbounded.
+  std::vector<NeighborX> results_unbounded;
+  EXPECT_TRUE(
+      tree.SearchKnn(p, k, pico_tree::SearchBudget(), results_unbounded));
+
+  ASSERT_EQ(results_exact.size(), results_unbounded.size());
+  for (std::size_t i = 0; i < results_exact.size(); ++i) {
+    FloatEq(results_exact[i].distance, results_unbounded[i].distance);
+  }
+
+  // Not enough distance evaluations to visit k points.
+  pico_tree::SearchBudget budget;
+  budget.max_distance_evaluations = k / 2;
+  std::vector<NeighborX> results_bounded;
+  EXPECT_FALSE(tree.SearchKnn(p, k, budget, results_bounded));
+
+  ASSERT_EQ(results_bounded.size(), k / 2);
+  for (std::size_t i = 0; i < results_bounded.size(); ++i) {
+    FloatLe(results_exact[i].distance, results_bounded[i].distance);
+  }
+
+  // A deadline that has already passed ends the search right away.
+  budget = pico_tree::SearchBudget();
+  budget.deadline = pico_tree::SearchBudget::ClockType::now();
+  NeighborX nn;
+  EXPECT_FALSE(tree.SearchNn(p, budget, nn));
+
+  // Requesting no neighbors is always exact.
+  EXPECT_TRUE(tree.SearchKnn(p, 0, budget, results_bounded));
+  EXPECT_TRUE(results_bounded.empty());
+}
+
 }  // namespace
 
 TEST(KdTreeTest, QueryRangeSubset2d) {
@@ -75,6 +243,313 @@ TEST(KdTreeTest, QueryKnn1) { QueryKnn<Point2f>(1024 * 1024, 100.0f, 1); }
 
 TEST(KdTreeTest, QueryKnn10) { QueryKnn<Point2f>(1024 * 1024, 100.0f, 10); }
 
+TEST(KdTreeTest, QueryKnnSah10) {
+  QueryKnn<Point2f, pico_tree::SplittingRule::kSurfaceAreaHeuristic>(
+      1024 * 128, 100.0f, 10);
+  QueryKnnAnisotropic<pico_tree::SplittingRule::kSurfaceAreaHeuristic>(
+      1024 * 128, 10);
+}
+
+TEST(KdTreeTest, QueryKnnLongestMedian10) {
+  QueryKnn<Point2f, pico_tree::SplittingRule::kLongestMedian>(
+      1024 * 128, 100.0f, 10);
+}
+
+TEST(KdTreeTest, QueryKnnMaxVariance10) {
+  QueryKnn<Point2f, pico_tree::SplittingRule::kMaxVariance>(
+      1024 * 128, 100.0f, 10);
+  QueryKnnAnisotropic<pico_tree::SplittingRule::kMaxVariance>(1024 * 128, 10);
+}
+
+TEST(KdTreeTest, QueryKnnMaxSpreadSample10) {
+  QueryKnn<Point2f, pico_tree::SplittingRule::kMaxSpreadSample>(
+      1024 * 128, 100.0f, 10);
+  QueryKnnAnisotropic<pico_tree::SplittingRule::kMaxSpreadSample>(
+      1024 * 128, 10);
+}
+
+TEST(KdTreeTest, QueryKnnSampledMedian10) {
+  QueryKnn<Point2f, pico_tree::SplittingRule::kSampledMedian>(
+      1024 * 128, 100.0f, 10);
+  QueryKnnAnisotropic<pico_tree::SplittingRule::kSampledMedian>(
+      1024 * 128, 10);
+
+  // A sample of a single point is the least balanced option.
+  using PointX = Point3f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 16, 100.0f);
+  pico_tree::SplittingRuleOptions options;
+  options.sample_size = 1;
+  pico_tree::KdTree<
+      Space<PointX>,
+      pico_tree::L2Squared,
+      pico_tree::SplittingRule::kSampledMedian>
+      tree(random, 8, options);
+
+  TestKnn(tree, 10);
+}
+
+TEST(KdTreeTest, QueryKnnMorton10) {
+  QueryKnn<Point2f, pico_tree::SplittingRule::kMorton>(1024 * 128, 100.0f, 10);
+  QueryKnn<Point3f, pico_tree::SplittingRule::kMorton>(1024 * 128, 100.0f, 10);
+  QueryKnnAnisotropic<pico_tree::SplittingRule::kMorton>(1024 * 128, 10);
+}
+
+// Many points share a Morton code when they are duplicates or when there are
+// more dimensions than bits in a code.
+TEST(KdTreeTest, QueryKnnMortonSharedCodes) {
+  using PointX = Point3f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 8, 100.0f);
+  for (std::size_t i = 0; i < random.size(); i += 2) {
+    random[i] = random[0];
+    random[i][2] += static_cast<float>(i) * 1e-6f;
+  }
+  pico_tree::KdTree<
+      Space<PointX>,
+      pico_tree::L2Squared,
+      pico_tree::SplittingRule::kMorton>
+      tree(random, 4);
+  TestKnn(tree, 10);
+
+  using PointY = std::array<float, 80>;
+  std::mt19937 e;
+  std::uniform_real_distribution<float> d(0.0f, 1.0f);
+  std::vector<PointY> points(1024 * 4);
+  for (auto& p : points) {
+    for (auto& c : p) {
+      c = d(e);
+    }
+  }
+  pico_tree::KdTree<
+      Space<PointY>,
+      pico_tree::L2Squared,
+      pico_tree::SplittingRule::kMorton>
+      tree_y(points, 8);
+  TestKnn(tree_y, 5);
+}
+
+TEST(KdTreeTest, QueryKnnIf10) {
+  QueryKnnIf<Point2f>(1024 * 128, 100.0f, 10, 7);
+}
+
+// Fewer points pass the filter than the amount of neighbors requested.
+TEST(KdTreeTest, QueryKnnIfSparse) {
+  QueryKnnIf<Point2f>(1024, 100.0f, 16, 128);
+}
+
+// Labels are spatially coherent, such that the label set of most subtrees
+// doesn't contain the label of interest and they can be skipped as a whole.
+TEST(KdTreeTest, QueryKnnIfSummaries) {
+  using PointX = Point2f;
+  using Index = typename KdTree<PointX>::IndexType;
+  using NeighborX = typename KdTree<PointX>::NeighborType;
+
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 16, 100.0f);
+  KdTree<PointX> tree(random, 8);
+
+  std::vector<int> labels(random.size());
+  for (std::size_t i = 0; i < random.size(); ++i) {
+    labels[i] = static_cast<int>(random[i][0] / 12.5f) % 8;
+  }
+  int const label = 3;
+
+  auto const summaries =
+      tree.Summarize([&labels](Index const* begin, Index const* end) {
+        std::uint8_t mask = 0;
+        for (; begin != end; ++begin) {
+          mask |= static_cast<std::uint8_t>(1 << labels[*begin]);
+        }
+        return mask;
+      });
+  static_assert(
+      std::is_same_v<
+          typename std::decay_t<decltype(summaries)>::SummaryType,
+          std::uint8_t>,
+      "SUMMARY_TYPE_NOT_DEDUCED");
+  auto const summary_filter = [label](std::uint8_t mask) {
+    return ((mask >> label) & 1) != 0;
+  };
+  // The root summary contains all labels.
+  EXPECT_EQ(summaries.summaries.front(), 0xFF);
+
+  // Merging the summaries of the children gives the same result.
+  auto const merged = tree.Summarize(
+      [&labels](Index const* begin, Index const* end) {
+        std::uint8_t mask = 0;
+        for (; begin != end; ++begin) {
+          mask |= static_cast<std::uint8_t>(1 << labels[*begin]);
+        }
+        return mask;
+      },
+      [](std::uint8_t left, std::uint8_t right) {
+        return static_cast<std::uint8_t>(left | right);
+      });
+  EXPECT_EQ(merged.summaries, summaries.summaries);
+  EXPECT_EQ(merged.right, summaries.right);
+
+  std::size_t calls = 0;
+  std::size_t calls_summaries = 0;
+  auto filter = [&labels, &calls, label](Index i) {
+    ++calls;
+    return labels[i] == label;
+  };
+  auto filter_summaries = [&labels, &calls_summaries, label](Index i) {
+    ++calls_summaries;
+    return labels[i] == label;
+  };
+
+  // The query lies in the region of a different label.
+  PointX const p{80.0f, 50.0f};
+  std::vector<NeighborX> knn;
+  std::vector<NeighborX> knn_summaries;
+  tree.SearchKnnIf(p, 16, filter, knn);
+  tree.SearchKnnIf(
+      p, 16, filter_summaries, summaries, summary_filter, knn_summaries);
+
+  ASSERT_EQ(knn.size(), knn_summaries.size());
+  for (std::size_t i = 0; i < knn.size(); ++i) {
+    EXPECT_EQ(knn[i].index, knn_summaries[i].index);
+    EXPECT_EQ(labels[knn_summaries[i].index], label);
+  }
+  EXPECT_LT(calls_summaries, calls);
+
+  float const radius = tree.metric()(40.0f);
+  std::vector<NeighborX> n;
+  std::vector<NeighborX> n_summaries;
+  tree.SearchRadiusIf(p, radius, filter, n, true);
+  tree.SearchRadiusIf(
+      p,
+      radius,
+      filter_summaries,
+      summaries,
+      summary_filter,
+      n_summaries,
+      true);
+
+  ASSERT_EQ(n.size(), n_summaries.size());
+  for (std::size_t i = 0; i < n.size(); ++i) {
+    EXPECT_EQ(n[i].index, n_summaries[i].index);
+  }
+}
+
+TEST(KdTreeTest, QueryKnnMaxLeavesVisited) {
+  using PointX = Point2f;
+
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 128, 100.0f);
+  KdTree<PointX> tree(random, 8);
+  TestKnnMaxLeavesVisited(tree, 10, random[random.size() / 2]);
+}
+
+// The DistanceType of a tree with uint8 coordinates is int. A leaf budget must
+// not be mistaken for the error ratio of an approximate search.
+TEST(KdTreeTest, QueryKnnMaxLeavesVisitedUint8) {
+  using PointX = std::array<std::uint8_t, 4>;
+  using Tree = pico_tree::KdTree<Space<PointX>>;
+
+  std::mt19937 e2(0);
+  std::uniform_int_distribution<int> dist(0, 255);
+  std::vector<PointX> random(1024 * 8);
+  for (auto& p : random) {
+    for (auto& c : p) {
+      c = static_cast<std::uint8_t>(dist(e2));
+    }
+  }
+  pico_tree::Size const max_leaf_size = 8;
+  Tree tree(random, max_leaf_size);
+
+  PointX const q = random[random.size() / 2];
+  pico_tree::Size const k = 4 * max_leaf_size;
+  std::vector<typename Tree::NeighborType> results_exact;
+  tree.SearchKnn(q, k, results_exact);
+
+  std::vector<typename Tree::NeighborType> results_unbounded;
+  tree.SearchKnn(q, k, pico_tree::MaxLeavesVisited(), results_unbounded);
+  ASSERT_EQ(results_exact.size(), results_unbounded.size());
+  for (std::size_t i = 0; i < results_exact.size(); ++i) {
+    EXPECT_EQ(results_exact[i].distance, results_unbounded[i].distance);
+  }
+
+  // A single leaf holds fewer points than requested.
+  std::vector<typename Tree::NeighborType> results_bounded;
+  tree.SearchKnn(q, k, pico_tree::MaxLeavesVisited{1}, results_bounded);
+  ASSERT_FALSE(results_bounded.empty());
+  EXPECT_LE(results_bounded.size(), max_leaf_size);
+  for (std::size_t i = 0; i < results_bounded.size(); ++i) {
+    EXPECT_LE(results_exact[i].distance, results_bounded[i].distance);
+  }
+}
+
+TEST(KdTreeTest, QuerySo2KnnMaxLeavesVisited) {
+  using PointX = Point1f;
+  using SpaceX = Space<PointX>;
+
+  const auto pi = pico_tree::internal::kPi<typename KdTree<PointX>::ScalarType>;
+  std::vector<PointX> random = GenerateRandomN<PointX>(256 * 256, -pi, pi);
+  pico_tree::KdTree<SpaceX, pico_tree::SO2> tree(random, 10);
+  TestKnnMaxLeavesVisited(tree, 8, PointX{pi});
+}
+
+TEST(KdTreeTest, QueryKnnSearchBudget) {
+  using PointX = Point2f;
+
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 128, 100.0f);
+  KdTree<PointX> tree(random, 8);
+  TestKnnSearchBudget(tree, 10, random[random.size() / 2]);
+}
+
+TEST(KdTreeTest, QuerySo2KnnSearchBudget) {
+  using PointX = Point1f;
+  using SpaceX = Space<PointX>;
+
+  const auto pi = pico_tree::internal::kPi<typename KdTree<PointX>::ScalarType>;
+  std::vector<PointX> random = GenerateRandomN<PointX>(256 * 256, -pi, pi);
+  pico_tree::KdTree<SpaceX, pico_tree::SO2> tree(random, 10);
+  TestKnnSearchBudget(tree, 8, PointX{pi});
+}
+
+TEST(KdTreeTest, QueryKnnUint8) {
+  using PointX = std::array<std::uint8_t, 40>;
+  using Tree = pico_tree::KdTree<Space<PointX>>;
+
+  static_assert(
+      std::is_same_v<typename Tree::DistanceType, int>,
+      "UINT8_DISTANCE_TYPE_NOT_INT");
+
+  std::mt19937 e2(0);
+  std::uniform_int_distribution<int> dist(0, 255);
+  auto generate = [&e2, &dist]() {
+    PointX p;
+    for (auto& c : p) {
+      c = static_cast<std::uint8_t>(dist(e2));
+    }
+    return p;
+  };
+
+  std::vector<PointX> random(1024 * 8);
+  std::generate(random.begin(), random.end(), generate);
+  Tree tree(random, 8);
+
+  PointX const q = generate();
+  std::size_t const k = 8;
+  std::vector<typename Tree::NeighborType> knn;
+  tree.SearchKnn(q, k, knn);
+
+  std::vector<int> distances(random.size());
+  for (std::size_t i = 0; i < random.size(); ++i) {
+    distances[i] = 0;
+    for (std::size_t j = 0; j < q.size(); ++j) {
+      int const d = static_cast<int>(q[j]) - static_cast<int>(random[i][j]);
+      distances[i] += d * d;
+    }
+  }
+  std::partial_sort(
+      distances.begin(), distances.begin() + k, distances.end());
+
+  ASSERT_EQ(knn.size(), k);
+  for (std::size_t i = 0; i < k; ++i) {
+    EXPECT_EQ(knn[i].distance, distances[i]);
+  }
+}
+
 TEST(KdTreeTest, QuerySo2Knn4) {
   using PointX = Point1f;
   using SpaceX = Space<PointX>;
@@ -85,6 +560,107 @@ TEST(KdTreeTest, QuerySo2Knn4) {
   TestKnn(tree, static_cast<typename KdTree<PointX>::IndexType>(8), PointX{pi});
 }
 
+TEST(KdTreeTest, PeakBuildMemory) {
+  using PointX = Point2f;
+  using Index = int;
+  using Node = pico_tree::internal::KdTreeNodeEuclidean<Index, float>;
+  pico_tree::Size point_count = 100000;
+  pico_tree::Size max_leaf_size = 10;
+  std::vector<PointX> random =
+      GenerateRandomN<PointX>(point_count, typename PointX::ScalarType(100.0));
+
+  // The node count of a median split tree is known up front.
+  pico_tree::KdTree<
+      Space<PointX>,
+      pico_tree::L2Squared,
+      pico_tree::SplittingRule::kLongestMedian>
+      median(random, max_leaf_size);
+  pico_tree::Size const index_memory = point_count * sizeof(Index);
+  pico_tree::Size const node_memory =
+      pico_tree::internal::MedianNodeCount(point_count, max_leaf_size)[0] *
+      sizeof(Node);
+  // The radix select needs at most two keys per point.
+  EXPECT_GE(median.peak_build_memory(), index_memory + node_memory);
+  EXPECT_LE(
+      median.peak_build_memory(),
+      index_memory + node_memory + 2 * point_count * sizeof(float));
+
+  KdTree<PointX> sliding(random, max_leaf_size);
+  EXPECT_GT(sliding.peak_build_memory(), index_memory);
+  TestKnn(sliding, Index(10));
+
+  pico_tree::KdTree<
+      Space<PointX>,
+      pico_tree::L2Squared,
+      pico_tree::SplittingRule::kMorton>
+      morton(random, max_leaf_size);
+  // The Morton codes, sort buffers and indices.
+  EXPECT_GT(
+      morton.peak_build_memory(),
+      index_memory + 2 * point_count * sizeof(std::uint64_t));
+}
+
+namespace {
+
+// Counts the bytes currently allocated through it.
+class CountingResource : public std::pmr::memory_resource {
+ public:
+  std::size_t bytes = 0;
+
+ private:
+  void* do_allocate(std::size_t size, std::size_t alignment) override {
+    bytes += size;
+    return std::pmr::new_delete_resource()->allocate(size, alignment);
+  }
+
+  void do_deallocate(
+      void* p, std::size_t size, std::size_t alignment) override {
+    bytes -= size;
+    std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+  }
+
+  bool do_is_equal(
+      std::pmr::memory_resource const& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+}  // namespace
+
+TEST(KdTreeTest, MemoryResource) {
+  using PointX = Point2f;
+  using Index = int;
+  pico_tree::Size point_count = 10000;
+  std::vector<PointX> random =
+      GenerateRandomN<PointX>(point_count, typename PointX::ScalarType(100.0));
+
+  CountingResource resource;
+  {
+    KdTree<PointX> tree(random, 8, &resource);
+    EXPECT_EQ(tree.resource(), &resource);
+    // The indices and (nearly) all nodes.
+    EXPECT_GE(resource.bytes, point_count * sizeof(Index));
+    TestKnn(tree, Index(10));
+  }
+  EXPECT_EQ(resource.bytes, 0);
+
+  // A monotonic buffer only releases its memory when it is destroyed.
+  std::pmr::monotonic_buffer_resource monotonic;
+  std::string filename = "tree_resource.bin";
+  {
+    KdTree<PointX> tree(random, 8, &monotonic);
+    KdTree<PointX>::Save(tree, filename);
+  }
+  {
+    KdTree<PointX> tree = KdTree<PointX>::Load(random, filename, &resource);
+    EXPECT_EQ(tree.resource(), &resource);
+    EXPECT_GE(resource.bytes, point_count * sizeof(Index));
+    TestKnn(tree, Index(10));
+  }
+  EXPECT_EQ(resource.bytes, 0);
+  EXPECT_TRUE(std::filesystem::remove(filename));
+}
+
 TEST(KdTreeTest, WriteRead) {
   using Index = int;
   using Scalar = typename Point2f::ScalarType;
@@ -109,6 +685,31 @@ TEST(KdTreeTest, WriteRead) {
 
   EXPECT_TRUE(std::filesystem::remove(filename));
 
+  // A metric that has a state is passed to the loaded tree.
+  using WeightedKdTree =
+      pico_tree::KdTree<Space<Point2f>, pico_tree::WeightedL2Squared<float>>;
+  pico_tree::WeightedL2Squared<float> const metric({0.25f, 4.0f});
+  {
+    WeightedKdTree tree(random, 1, metric);
+    WeightedKdTree::Save(tree, filename);
+  }
+  {
+    WeightedKdTree tree = WeightedKdTree::Load(random, filename, metric);
+    EXPECT_EQ(tree.metric().weights(), metric.weights());
+
+    std::vector<typename WeightedKdTree::NeighborType> knn;
+    std::vector<typename WeightedKdTree::NeighborType> compare;
+    tree.SearchKnn(random[0], 20, knn);
+    SearchKnn<pico_tree::SpaceTraits<std::vector<Point2f>>>(
+        random[0], random, 20, metric, &compare);
+    ASSERT_EQ(knn.size(), compare.size());
+    for (std::size_t i = 0; i < knn.size(); ++i) {
+      EXPECT_FLOAT_EQ(knn[i].distance, compare[i].distance);
+    }
+  }
+
+  EXPECT_TRUE(std::filesystem::remove(filename));
+
   // Run time known dimensions.
   using DSpace = DynamicSpace<Space<Point2f>>;
 
@@ -131,3 +732,428 @@ TEST(KdTreeTest, WriteRead) {
 
   EXPECT_TRUE(std::filesystem::remove(filename));
 }
+
+namespace {
+
+// A space for which prefetching is enabled.
+template <typename PointX>
+struct PrefetchSpace : public std::vector<PointX> {
+  using std::vector<PointX>::vector;
+};
+
+}  // namespace
+
+namespace pico_tree {
+
+template <typename PointX>
+struct SpaceTraits<PrefetchSpace<PointX>>
+    : public SpaceTraits<std::vector<PointX>> {
+  using SpaceType = PrefetchSpace<PointX>;
+};
+
+template <typename PointX>
+struct PrefetchTraits<PrefetchSpace<PointX>> {
+  static bool constexpr kPrefetchNodes = true;
+  static Size constexpr kPrefetchPointDistance = 3;
+};
+
+}  // namespace pico_tree
+
+TEST(KdTreeTest, QueryKnnPrefetch) {
+  std::vector<Point2f> random = GenerateRandomN<Point2f>(1024 * 128, 100.0f);
+  PrefetchSpace<Point2f> points(random.begin(), random.end());
+  pico_tree::KdTree<std::reference_wrapper<PrefetchSpace<Point2f>>> tree(
+      points, 8);
+  TestKnn(tree, 10);
+}
+
+TEST(KdTreeTest, QuerySo2KnnPrefetch) {
+  using PointX = Point1f;
+
+  auto const pi = pico_tree::internal::kPi<typename PointX::ScalarType>;
+  std::vector<PointX> random = GenerateRandomN<PointX>(256 * 256, -pi, pi);
+  PrefetchSpace<PointX> points(random.begin(), random.end());
+  pico_tree::KdTree<
+      std::reference_wrapper<PrefetchSpace<PointX>>,
+      pico_tree::SO2>
+      tree(points, 10);
+  TestKnn(tree, 8, PointX{pi});
+}
+
+namespace {
+
+template <pico_tree::Size PacketSize_, typename Tree_, typename PointX>
+void TestKnnPacket(
+    Tree_ const& tree, std::vector<PointX> const& queries, pico_tree::Size k) {
+  using NeighborType = typename Tree_::NeighborType;
+
+  std::vector<NeighborType> knns;
+  tree.template SearchKnnPacket<PacketSize_>(
+      queries.begin(), queries.end(), k, knns);
+  ASSERT_EQ(knns.size(), queries.size() * k);
+
+  std::vector<NeighborType> knn;
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    tree.SearchKnn(queries[i], k, knn);
+    for (std::size_t j = 0; j < k; ++j) {
+      EXPECT_EQ(knn[j].distance, knns[i * k + j].distance);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(KdTreeTest, QueryKnnPacket) {
+  using PointX = Point3f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 64, 100.0f);
+  KdTree<PointX> tree(random, 8);
+
+  // Queries that are incoherent, and a number of queries that is not a
+  // multiple of the packet size.
+  std::vector<PointX> queries = GenerateRandomN<PointX>(1001, 110.0f);
+  TestKnnPacket<8>(tree, queries, 8);
+  TestKnnPacket<3>(tree, queries, 1);
+
+  // Coherent queries.
+  std::sort(queries.begin(), queries.end(), [](auto const& a, auto const& b) {
+    return a[0] < b[0];
+  });
+  TestKnnPacket<16>(tree, queries, 10);
+  TestKnnPacket<32>(tree, queries, 4);
+}
+
+TEST(KdTreeTest, QuerySo2KnnPacket) {
+  using PointX = Point1f;
+
+  auto const pi = pico_tree::internal::kPi<typename PointX::ScalarType>;
+  std::vector<PointX> random = GenerateRandomN<PointX>(256 * 256, -pi, pi);
+  pico_tree::KdTree<Space<PointX>, pico_tree::SO2> tree(random, 10);
+  std::vector<PointX> queries = GenerateRandomN<PointX>(100, -pi, pi);
+  TestKnnPacket<8>(tree, queries, 8);
+}
+
+namespace {
+
+template <pico_tree::Size InFlight_, typename Tree_, typename PointX>
+void TestKnnInterleaved(
+    Tree_ const& tree, std::vector<PointX> const& queries, pico_tree::Size k) {
+  using NeighborType = typename Tree_::NeighborType;
+
+  std::vector<NeighborType> knns;
+  tree.template SearchKnnInterleaved<InFlight_>(
+      queries.begin(), queries.end(), k, knns);
+  ASSERT_EQ(knns.size(), queries.size() * k);
+
+  std::vector<NeighborType> knn;
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    tree.SearchKnn(queries[i], k, knn);
+    for (std::size_t j = 0; j < k; ++j) {
+      EXPECT_EQ(knn[j].distance, knns[i * k + j].distance);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(KdTreeTest, QueryKnnInterleaved) {
+  using PointX = Point3f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 64, 100.0f);
+  KdTree<PointX> tree(random, 8);
+
+  std::vector<PointX> queries = GenerateRandomN<PointX>(1001, 110.0f);
+  TestKnnInterleaved<16>(tree, queries, 8);
+  TestKnnInterleaved<1>(tree, queries, 1);
+  // More searches in flight than queries.
+  std::vector<PointX> few(queries.begin(), queries.begin() + 5);
+  TestKnnInterleaved<32>(tree, few, 4);
+}
+
+TEST(KdTreeTest, QuerySo2KnnInterleaved) {
+  using PointX = Point1f;
+
+  auto const pi = pico_tree::internal::kPi<typename PointX::ScalarType>;
+  std::vector<PointX> random = GenerateRandomN<PointX>(256 * 256, -pi, pi);
+  pico_tree::KdTree<Space<PointX>, pico_tree::SO2> tree(random, 10);
+  std::vector<PointX> queries = GenerateRandomN<PointX>(100, -pi, pi);
+  TestKnnInterleaved<8>(tree, queries, 8);
+}
+
+// A query with a run-time dimension is searched with the compile-time
+// dimension of the tree.
+TEST(KdTreeTest, QueryKnnRtQuery) {
+  using PointX = Point3f;
+  using PointMapX = pico_tree::PointMap<float const, pico_tree::kDynamicSize>;
+  using NeighborType = typename KdTree<PointX>::NeighborType;
+
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 64, 100.0f);
+  KdTree<PointX> tree(random, 8);
+
+  std::vector<NeighborType> knn;
+  std::vector<NeighborType> rt_knn;
+  for (auto const& q : GenerateRandomN<PointX>(256, 110.0f)) {
+    tree.SearchKnn(q, 8, knn);
+    tree.SearchKnn(PointMapX(q.data(), q.size()), 8, rt_knn);
+    ASSERT_EQ(knn.size(), rt_knn.size());
+    for (std::size_t i = 0; i < knn.size(); ++i) {
+      EXPECT_EQ(knn[i].index, rt_knn[i].index);
+    }
+  }
+}
+
+TEST(KdTreeTest, QueryCosine) {
+  using PointX = Point3f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 64, -1.0f, 1.0f);
+  for (auto& p : random) {
+    p.Normalize();
+  }
+  pico_tree::KdTree<Space<PointX>, pico_tree::Cosine> tree(random, 8);
+
+  TestKnn(tree, 10);
+  TestRadius(tree, 0.01f);
+}
+
+TEST(KdTreeTest, QueryMinkowski) {
+  using PointX = Point3f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 64, 100.0f);
+  pico_tree::KdTree<Space<PointX>, pico_tree::Minkowski<3>> tree(random, 8);
+
+  TestKnn(tree, 10);
+  TestRadius(tree, 64.0f);
+}
+
+TEST(KdTreeTest, QueryWeightedL2Squared) {
+  using PointX = Point3f;
+  using TraitsX = pico_tree::SpaceTraits<std::vector<PointX>>;
+  using MetricX = pico_tree::WeightedL2Squared<float>;
+  using KdTreeX = pico_tree::KdTree<Space<PointX>, MetricX>;
+  using NeighborType = typename KdTreeX::NeighborType;
+
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 64, 100.0f);
+  KdTreeX tree(random, 8, MetricX({0.01f, 1.0f, 25.0f}));
+
+  std::size_t const k = 8;
+  std::vector<NeighborType> knn;
+  std::vector<NeighborType> compare;
+  for (auto const& q : GenerateRandomN<PointX>(64, 110.0f)) {
+    tree.SearchKnn(q, k, knn);
+    SearchKnn<TraitsX>(q, random, k, tree.metric(), &compare);
+
+    ASSERT_EQ(knn.size(), compare.size());
+    for (std::size_t i = 0; i < knn.size(); ++i) {
+      EXPECT_FLOAT_EQ(knn[i].distance, compare[i].distance);
+    }
+  }
+}
+
+TEST(KdTreeTest, QueryHaversine) {
+  using PointX = Point2f;
+  using TraitsX = pico_tree::SpaceTraits<std::vector<PointX>>;
+  using KdTreeX = pico_tree::KdTree<Space<PointX>, pico_tree::Haversine>;
+  using NeighborType = typename KdTreeX::NeighborType;
+
+  float const pi = pico_tree::internal::kPi<float>;
+  float const max_abs_latitude = 1.2f;
+  auto generate = [&](std::size_t n) {
+    std::vector<PointX> points = GenerateRandomN<PointX>(n, -pi, pi);
+    for (auto& p : points) {
+      p[0] *= max_abs_latitude / pi;
+    }
+    return points;
+  };
+
+  std::vector<PointX> random = generate(1024 * 64);
+  KdTreeX tree(random, 8);
+  KdTreeX bounded(random, 8, pico_tree::Haversine(max_abs_latitude));
+
+  std::vector<PointX> queries = generate(64);
+  // Queries near the identification of -PI ~ PI.
+  queries.push_back(PointX{0.5f, pi});
+  queries.push_back(PointX{-0.5f, -pi});
+
+  std::size_t const k = 8;
+  std::vector<NeighborType> knn;
+  std::vector<NeighborType> bounded_knn;
+  std::vector<NeighborType> compare;
+  for (auto const& q : queries) {
+    tree.SearchKnn(q, k, knn);
+    bounded.SearchKnn(q, k, bounded_knn);
+    SearchKnn<TraitsX>(q, random, k, tree.metric(), &compare);
+
+    ASSERT_EQ(knn.size(), compare.size());
+    ASSERT_EQ(bounded_knn.size(), compare.size());
+    for (std::size_t i = 0; i < knn.size(); ++i) {
+      EXPECT_FLOAT_EQ(knn[i].distance, compare[i].distance);
+      EXPECT_FLOAT_EQ(bounded_knn[i].distance, compare[i].distance);
+    }
+  }
+}
+
+TEST(KdTreeTest, QueryPeriodic) {
+  using PointX = Point3f;
+  using TraitsX = pico_tree::SpaceTraits<std::vector<PointX>>;
+  using MetricX = pico_tree::Periodic<float, pico_tree::L2Squared>;
+  using KdTreeX = pico_tree::KdTree<Space<PointX>, MetricX>;
+  using NeighborType = typename KdTreeX::NeighborType;
+
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 64, 0.0f, 10.0f);
+  KdTreeX tree(random, 8, MetricX({10.0f, 10.0f, 10.0f}));
+
+  std::vector<PointX> queries = GenerateRandomN<PointX>(64, 0.0f, 10.0f);
+  // Queries near the periodic boundaries.
+  queries.push_back(PointX{0.0f, 0.0f, 0.0f});
+  queries.push_back(PointX{9.99f, 0.01f, 5.0f});
+
+  std::size_t const k = 8;
+  std::vector<NeighborType> knn;
+  std::vector<NeighborType> compare;
+  for (auto const& q : queries) {
+    tree.SearchKnn(q, k, knn);
+    SearchKnn<TraitsX>(q, random, k, tree.metric(), &compare);
+
+    ASSERT_EQ(knn.size(), compare.size());
+    for (std::size_t i = 0; i < knn.size(); ++i) {
+      EXPECT_FLOAT_EQ(knn[i].distance, compare[i].distance);
+    }
+  }
+}
+
+namespace {
+
+template <typename Tree>
+void TestRadiusPairs(
+    Tree const& tree, typename Tree::DistanceType const radius) {
+  using IndexType = typename Tree::IndexType;
+  using NeighborType = typename Tree::NeighborType;
+  using PairType = std::pair<IndexType, NeighborType>;
+
+  auto const& points = tree.points().get();
+  auto const& metric = tree.metric();
+
+  std::vector<PairType> pairs;
+  tree.SearchRadiusPairs(radius, pairs);
+
+  std::vector<PairType> compare;
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    auto const& p = points[i];
+    for (std::size_t j = i + 1; j < points.size(); ++j) {
+      auto const& q = points[j];
+      auto const d = metric(p.data(), p.data() + p.size(), q.data());
+      if (radius > d) {
+        compare.push_back(
+            {static_cast<IndexType>(i), {static_cast<IndexType>(j), d}});
+      }
+    }
+  }
+
+  auto const less = [](PairType const& a, PairType const& b) {
+    return std::make_pair(a.first, a.second.index) <
+           std::make_pair(b.first, b.second.index);
+  };
+  std::sort(pairs.begin(), pairs.end(), less);
+
+  ASSERT_EQ(pairs.size(), compare.size());
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    EXPECT_EQ(pairs[i].first, compare[i].first);
+    EXPECT_EQ(pairs[i].second.index, compare[i].second.index);
+    EXPECT_EQ(pairs[i].second.distance, compare[i].second.distance);
+  }
+}
+
+}  // namespace
+
+TEST(KdTreeTest, QueryRadiusPairs) {
+  using PointX = Point3f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 4, 0.0f, 10.0f);
+  KdTree<PointX> tree(random, 8);
+
+  TestRadiusPairs(tree, 0.5f);
+}
+
+TEST(KdTreeTest, QueryPeriodicRadiusPairs) {
+  using PointX = Point3f;
+  using MetricX = pico_tree::Periodic<float, pico_tree::L2Squared>;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 4, 0.0f, 10.0f);
+  pico_tree::KdTree<Space<PointX>, MetricX> tree(
+      random, 8, MetricX({10.0f, 10.0f, 10.0f}));
+
+  TestRadiusPairs(tree, 0.5f);
+}
+
+namespace {
+
+template <typename Tree>
+void TestAllRadius(Tree const& tree, typename Tree::DistanceType const radius) {
+  using IndexType = typename Tree::IndexType;
+  using NeighborType = typename Tree::NeighborType;
+
+  auto const& points = tree.points().get();
+  auto const& metric = tree.metric();
+
+  pico_tree::NeighborList<IndexType, typename Tree::DistanceType> neighbors;
+  tree.SearchAllRadius(radius, neighbors);
+
+  ASSERT_EQ(neighbors.size(), points.size());
+  ASSERT_EQ(neighbors.offsets.back(), neighbors.indices.size());
+  ASSERT_EQ(neighbors.offsets.back(), neighbors.distances.size());
+
+  std::vector<NeighborType> row;
+  std::vector<NeighborType> compare;
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    row.clear();
+    for (auto j = neighbors.offsets[i]; j < neighbors.offsets[i + 1]; ++j) {
+      row.push_back({neighbors.indices[j], neighbors.distances[j]});
+    }
+
+    // The per-point search sums the box offsets of each dimension, which is
+    // too pessimistic for LInf. The reference is therefore a linear scan.
+    compare.clear();
+    auto const& p = points[i];
+    for (std::size_t j = 0; j < points.size(); ++j) {
+      auto const d = metric(p.data(), p.data() + p.size(), points[j].data());
+      if (j != i && radius > d) {
+        compare.push_back({static_cast<IndexType>(j), d});
+      }
+    }
+
+    auto const less = [](NeighborType const& a, NeighborType const& b) {
+      return a.index < b.index;
+    };
+    std::sort(row.begin(), row.end(), less);
+    std::sort(compare.begin(), compare.end(), less);
+
+    ASSERT_EQ(row.size(), compare.size());
+    for (std::size_t j = 0; j < row.size(); ++j) {
+      EXPECT_EQ(row[j].index, compare[j].index);
+      EXPECT_EQ(row[j].distance, compare[j].distance);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(KdTreeTest, QueryAllRadius) {
+  using PointX = Point3f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 4, 0.0f, 10.0f);
+  KdTree<PointX> tree(random, 8);
+
+  TestAllRadius(tree, 0.5f);
+  TestAllRadius(tree, 0.0f);
+}
+
+TEST(KdTreeTest, QueryAllRadiusLInf) {
+  using PointX = Point2f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 4, 0.0f, 10.0f);
+  pico_tree::KdTree<Space<PointX>, pico_tree::LInf> tree(random, 4);
+
+  TestAllRadius(tree, 0.25f);
+}
+
+TEST(KdTreeTest, QueryPeriodicAllRadius) {
+  using PointX = Point3f;
+  using MetricX = pico_tree::Periodic<float, pico_tree::L2Squared>;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 4, 0.0f, 10.0f);
+  pico_tree::KdTree<Space<PointX>, MetricX> tree(
+      random, 8, MetricX({10.0f, 10.0f, 10.0f}));
+
+  TestAllRadius(tree, 0.5f);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <pico_toolshed/point.hpp>
+#include <pico_tree/kd_tree.hpp>
+#include <pico_tree/vector_traits.hpp>
+#include <pico_understory/max_inner_product_space.hpp>
+
+#include "common.hpp"
+
+using PointX = Point3f;
+using Scalar = typename PointX::ScalarType;
+using MaxInnerProductSpaceX =
+    pico_tree::MaxInnerProductSpace<Scalar, PointX::Dim>;
+
+namespace {
+
+Scalar Dot(PointX const& a, PointX const& b) {
+  return pico_tree::internal::Dot(a.data(), a.data() + a.size(), b.data());
+}
+
+}  // namespace
+
+TEST(MaxInnerProductSpaceTest, Augment) {
+  std::vector<PointX> random = GenerateRandomN<PointX>(256, -10.0f, 10.0f);
+  MaxInnerProductSpaceX space(random);
+
+  EXPECT_EQ(space.size(), random.size());
+  EXPECT_EQ(space.sdim(), PointX::Dim + 1);
+
+  // All augmented points have the same norm.
+  Scalar const max_squared_norm = space.max_squared_norm();
+  for (std::size_t i = 0; i < random.size(); ++i) {
+    auto const p = space[i];
+    Scalar squared_norm = Scalar(0.0);
+    for (std::size_t j = 0; j < space.sdim(); ++j) {
+      squared_norm += p[j] * p[j];
+    }
+    EXPECT_NEAR(squared_norm, max_squared_norm, max_squared_norm * 1e-5f);
+  }
+
+  auto const q = space.Query(random[0]);
+  EXPECT_EQ(q[PointX::Dim], Scalar(0.0));
+}
+
+TEST(MaxInnerProductSpaceTest, QueryKnn) {
+  std::vector<PointX> random =
+      GenerateRandomN<PointX>(1024 * 16, -10.0f, 10.0f);
+  pico_tree::KdTree<MaxInnerProductSpaceX> tree(
+      MaxInnerProductSpaceX(random), 8);
+
+  std::size_t const k = 8;
+  std::vector<typename pico_tree::KdTree<MaxInnerProductSpaceX>::NeighborType>
+      knn;
+  std::vector<Scalar> compare(random.size());
+  for (auto const& q : GenerateRandomN<PointX>(64, -10.0f, 10.0f)) {
+    tree.SearchKnn(tree.points().Query(q), k, knn);
+    ASSERT_EQ(knn.size(), k);
+
+    // The k largest inner products by brute force.
+    for (std::size_t i = 0; i < random.size(); ++i) {
+      compare[i] = Dot(q, random[i]);
+    }
+    std::partial_sort(
+        compare.begin(),
+        compare.begin() + k,
+        compare.end(),
+        std::greater<Scalar>());
+
+    for (std::size_t i = 0; i < k; ++i) {
+      Scalar const inner_product = Dot(q, random[knn[i].index]);
+      // Rounding in the augmented space may swap nearly equal inner products.
+      EXPECT_NEAR(inner_product, compare[i], 1e-2f);
+      EXPECT_NEAR(
+          tree.points().InnerProduct(q, knn[i].distance),
+          inner_product,
+          1e-2f);
+    }
+  }
+}
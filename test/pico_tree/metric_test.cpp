@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <cstdint>
+#include <random>
 #include <pico_toolshed/point.hpp>
 #include <pico_tree/internal/point_wrapper.hpp>
 #include <pico_tree/metric.hpp>
@@ -45,6 +47,43 @@ TEST(MetricTest, L2Squared) {
   EXPECT_FLOAT_EQ(metric(-3.1f), 9.61f);
 }
 
+TEST(MetricTest, Uint8) {
+  std::mt19937 e2(0);
+  std::uniform_int_distribution<int> dist(0, 255);
+
+  // Covers both the vectorized loops and their remainders.
+  for (std::size_t n = 0; n < 100; ++n) {
+    std::vector<std::uint8_t> p0(n);
+    std::vector<std::uint8_t> p1(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      p0[i] = static_cast<std::uint8_t>(dist(e2));
+      p1[i] = static_cast<std::uint8_t>(dist(e2));
+    }
+    // Worst case differences.
+    if (n > 0) {
+      p0[0] = 0;
+      p1[0] = 255;
+    }
+
+    std::uint8_t const* b0 = p0.data();
+    std::uint8_t const* b1 = p1.data();
+
+    int l1 = 0;
+    int l2 = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      int const d = static_cast<int>(p0[i]) - static_cast<int>(p1[i]);
+      l1 += std::abs(d);
+      l2 += d * d;
+    }
+
+    EXPECT_EQ(pico_tree::L1()(b0, b0 + n, b1), l1);
+    EXPECT_EQ(pico_tree::L2Squared()(b0, b0 + n, b1), l2);
+  }
+
+  EXPECT_EQ(pico_tree::L2Squared()(std::uint8_t(3), std::uint8_t(250)), 61009);
+  EXPECT_EQ(pico_tree::L1()(std::uint8_t(3), std::uint8_t(250)), 247);
+}
+
 TEST(MetricTest, LInf) {
   Point2f p0{2.0f, 4.0f};
   Point2f p1{10.0f, 1.0f};
@@ -68,3 +107,140 @@ TEST(MetricTest, SO2) {
   EXPECT_FLOAT_EQ(metric(-0.4f, -0.3f, -0.2f, 0), std::abs(-0.4f - -0.3f));
   EXPECT_FLOAT_EQ(metric(-0.25f, -0.3f, -0.2f, 0), 0.0f);
 }
+
+TEST(MetricTest, Cosine) {
+  Point2f p0{0.6f, 0.8f};
+  Point2f p1{1.0f, 0.0f};
+
+  pico_tree::Cosine metric;
+
+  // 1 - cos(p0, p1) = 1 - 0.6.
+  EXPECT_FLOAT_EQ(Distance(metric, p0, p1), 0.4f);
+  EXPECT_FLOAT_EQ(metric(-3.0f, 1.0f), 8.0f);
+  EXPECT_FLOAT_EQ(metric(-3.0f), 4.5f);
+
+  // Covers both the vectorized loop and its remainder.
+  std::mt19937 e2(0);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (std::size_t n = 1; n < 40; ++n) {
+    std::vector<float> a(n);
+    std::vector<float> b(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      a[i] = dist(e2);
+      b[i] = dist(e2);
+    }
+    float l2 = 0.0f;
+    float dot = 0.0f;
+    for (std::size_t i = 0; i < n; ++i) {
+      l2 += (a[i] - b[i]) * (a[i] - b[i]);
+      dot += a[i] * b[i];
+    }
+
+    float const* b0 = a.data();
+    float const* b1 = b.data();
+    EXPECT_NEAR(metric(b0, b0 + n, b1), 0.5f * l2, 1e-4f);
+    EXPECT_NEAR(pico_tree::internal::Dot(b0, b0 + n, b1), dot, 1e-4f);
+  }
+}
+
+TEST(MetricTest, Minkowski) {
+  Point2f p0{2.0f, 4.0f};
+  Point2f p1{10.0f, 1.0f};
+
+  pico_tree::Minkowski<3> metric;
+
+  EXPECT_FLOAT_EQ(Distance(metric, p0, p1), 539.0f);
+  EXPECT_FLOAT_EQ(metric(-3.0f, 1.0f), 64.0f);
+  EXPECT_FLOAT_EQ(metric(-3.0f), 27.0f);
+
+  EXPECT_FLOAT_EQ(
+      Distance(pico_tree::Minkowski<1>(), p0, p1),
+      Distance(pico_tree::L1(), p0, p1));
+  EXPECT_FLOAT_EQ(
+      Distance(pico_tree::Minkowski<2>(), p0, p1),
+      Distance(pico_tree::L2Squared(), p0, p1));
+
+  // Powers of integral coordinates would overflow an int.
+  std::vector<std::uint8_t> u0(784, 0);
+  std::vector<std::uint8_t> u1(784, 255);
+  pico_tree::Minkowski<4> metric4;
+  EXPECT_DOUBLE_EQ(metric4(u0[0], u1[0]), 4228250625.0);
+  EXPECT_DOUBLE_EQ(
+      metric4(u0.data(), u0.data() + u0.size(), u1.data()),
+      784.0 * 4228250625.0);
+  EXPECT_DOUBLE_EQ(metric(std::uint8_t(255)), 16581375.0);
+}
+
+TEST(MetricTest, WeightedL2Squared) {
+  Point2f p0{2.0f, 4.0f};
+  Point2f p1{10.0f, 1.0f};
+
+  pico_tree::WeightedL2Squared<float> metric({0.5f, 2.0f});
+
+  EXPECT_FLOAT_EQ(Distance(metric, p0, p1), 50.0f);
+  EXPECT_FLOAT_EQ(metric(-3.0f, 1.0f, 0), 8.0f);
+  EXPECT_FLOAT_EQ(metric(-3.0f, 1.0f, 1), 32.0f);
+  EXPECT_FLOAT_EQ(
+      pico_tree::internal::CoordinateDistance(metric, -3.0f, 1.0f, 1), 32.0f);
+  EXPECT_FLOAT_EQ(
+      pico_tree::internal::CoordinateDistance(
+          pico_tree::L2Squared(), -3.0f, 1.0f, 1),
+      16.0f);
+}
+
+TEST(MetricTest, DiagonalMahalanobis) {
+  Point2f p0{2.0f, 4.0f};
+  Point2f p1{10.0f, 1.0f};
+
+  pico_tree::DiagonalMahalanobis<float> metric({4.0f, 0.25f});
+
+  EXPECT_FLOAT_EQ(Distance(metric, p0, p1), 52.0f);
+  EXPECT_FLOAT_EQ(metric(-3.0f, 1.0f, 0), 4.0f);
+  EXPECT_FLOAT_EQ(metric.weights()[1], 4.0f);
+}
+
+TEST(MetricTest, Haversine) {
+  float const pi = pico_tree::internal::kPi<float>;
+  Point2f p0{0.0f, 0.0f};
+  Point2f p1{0.0f, pi / 2.0f};
+  Point2f p2{pi / 2.0f, 1.0f};
+  Point2f p3{0.0f, pi - 0.1f};
+  Point2f p4{0.0f, -pi + 0.1f};
+
+  pico_tree::Haversine metric;
+
+  // hav(a) = sin^2(a / 2).
+  EXPECT_FLOAT_EQ(Distance(metric, p0, p1), 0.5f);
+  EXPECT_FLOAT_EQ(Distance(metric, p0, p2), 0.5f);
+  // The longitude wraps around -PI ~ PI.
+  EXPECT_NEAR(Distance(metric, p3, p4), metric(0.2f), 1e-6f);
+  EXPECT_FLOAT_EQ(metric(pi), 1.0f);
+
+  EXPECT_FLOAT_EQ(metric(0.1f, 0.2f, 0.4f, 0), metric(0.1f));
+  EXPECT_FLOAT_EQ(metric(0.3f, 0.2f, 0.4f, 0), 0.0f);
+  // Without a latitude bound the longitude doesn't bound the distance.
+  EXPECT_FLOAT_EQ(metric(3.0f, -3.1f, -3.0f, 1), 0.0f);
+
+  pico_tree::Haversine bounded(pi / 3.0f);
+  EXPECT_FLOAT_EQ(
+      bounded(3.0f, -3.1f, -3.0f, 1), 0.25f * metric(2.0f * pi - 6.1f));
+  EXPECT_FLOAT_EQ(bounded(-3.05f, -3.1f, -3.0f, 1), 0.0f);
+}
+
+TEST(MetricTest, Periodic) {
+  Point2f p0{1.0f, 4.0f};
+  Point2f p1{9.0f, 1.0f};
+
+  pico_tree::Periodic<float, pico_tree::L2Squared> metric({10.0f, 20.0f});
+
+  // The first coordinate wraps around: min(8, 10 - 8) = 2.
+  EXPECT_FLOAT_EQ(Distance(metric, p0, p1), 13.0f);
+  EXPECT_FLOAT_EQ(metric(-3.0f), 9.0f);
+  EXPECT_FLOAT_EQ(metric(1.0f, 2.0f, 3.0f, 0), 1.0f);
+  EXPECT_FLOAT_EQ(metric(9.5f, 2.0f, 3.0f, 0), 6.25f);
+  EXPECT_FLOAT_EQ(metric(9.5f, 2.0f, 3.0f, 1), 42.25f);
+  EXPECT_FLOAT_EQ(metric(2.5f, 2.0f, 3.0f, 1), 0.0f);
+
+  pico_tree::Periodic<float, pico_tree::L1> l1({10.0f, 20.0f});
+  EXPECT_FLOAT_EQ(Distance(l1, p0, p1), 5.0f);
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <pico_toolshed/point.hpp>
+#include <pico_tree/kd_tree.hpp>
+#include <pico_tree/vector_traits.hpp>
+#include <pico_understory/quantized_space.hpp>
+
+#include "common.hpp"
+
+using PointX = Point3f;
+using Scalar = typename PointX::ScalarType;
+using QuantizedSpaceX = pico_tree::QuantizedSpace<Scalar, PointX::Dim>;
+
+TEST(QuantizedSpaceTest, EncodeDecode) {
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024, 100.0f);
+  QuantizedSpaceX space(random);
+
+  EXPECT_EQ(space.size(), random.size());
+  EXPECT_EQ(space.sdim(), PointX::Dim);
+
+  // Rounding to the nearest code introduces an error of at most half a step.
+  Scalar const max_error = space.scale() * Scalar(0.5) + Scalar(1e-4);
+  for (std::size_t i = 0; i < random.size(); ++i) {
+    auto const decoded = space.Decode(i);
+    auto const encoded = space.Encode(random[i]);
+    for (std::size_t j = 0; j < PointX::Dim; ++j) {
+      EXPECT_LE(std::abs(decoded[j] - random[i][j]), max_error);
+      EXPECT_EQ(encoded[j], space[i][j]);
+    }
+  }
+}
+
+TEST(QuantizedSpaceTest, QueryKnnRerank) {
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 16, 100.0f);
+  pico_tree::KdTree<QuantizedSpaceX> tree(QuantizedSpaceX(random), 8);
+
+  // Distances between codes don't wrap around.
+  static_assert(
+      std::is_same_v<
+          typename pico_tree::KdTree<QuantizedSpaceX>::DistanceType,
+          int>,
+      "QUANTIZED_DISTANCE_TYPE_NOT_INT");
+
+  using Index = typename pico_tree::KdTree<QuantizedSpaceX>::IndexType;
+  using NeighborX = pico_tree::Neighbor<Index, Scalar>;
+
+  PointX const& q = random[random.size() / 2];
+  std::size_t const k = 8;
+
+  std::vector<NeighborX> knn_exact;
+  SearchKnn<pico_tree::SpaceTraits<std::vector<PointX>>>(
+      q, random, k, pico_tree::L2Squared(), &knn_exact);
+
+  // Quantization errors only shuffle points with nearly equal distances. A few
+  // extra candidates suffice to recover the exact neighbors.
+  std::vector<typename pico_tree::KdTree<QuantizedSpaceX>::NeighborType>
+      candidates;
+  tree.SearchKnn(tree.points().Encode(q), k * 4, candidates);
+
+  std::vector<NeighborX> knn;
+  pico_tree::Rerank(random, q, candidates, k, knn);
+
+  ASSERT_EQ(knn.size(), k);
+  for (std::size_t i = 0; i < k; ++i) {
+    FloatEq(knn_exact[i].distance, knn[i].distance);
+  }
+}
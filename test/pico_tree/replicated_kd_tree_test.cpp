@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <memory_resource>
+#include <numeric>
+#include <pico_toolshed/point.hpp>
+#include <pico_tree/kd_tree.hpp>
+#include <pico_tree/vector_traits.hpp>
+#include <pico_understory/replicated_kd_tree.hpp>
+
+#include "common.hpp"
+
+using PointX = Point2f;
+using Scalar = typename PointX::ScalarType;
+using KdTreeX = pico_tree::KdTree<std::vector<PointX>>;
+
+namespace {
+
+template <typename Neighbor_>
+void ExpectEqual(
+    std::vector<Neighbor_> const& a, std::vector<Neighbor_> const& b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    EXPECT_EQ(a[i].index, b[i].index);
+    EXPECT_EQ(a[i].distance, b[i].distance);
+  }
+}
+
+}  // namespace
+
+TEST(ReplicatedKdTreeTest, NumaNode) {
+  EXPECT_GE(pico_tree::NumaNodeCount(), 1);
+  EXPECT_LT(pico_tree::CurrentNumaNode(), pico_tree::NumaNodeCount());
+}
+
+TEST(ReplicatedKdTreeTest, ScopedNumaNodeAffinity) {
+  for (pico_tree::Size i = 0; i < pico_tree::NumaNodeCount(); ++i) {
+    pico_tree::ScopedNumaNodeAffinity affinity(i);
+    if (affinity.bound()) {
+      EXPECT_EQ(pico_tree::CurrentNumaNode(), i);
+    }
+  }
+}
+
+TEST(ReplicatedKdTreeTest, NumaMemoryResource) {
+  pico_tree::NumaMemoryResource resource(pico_tree::CurrentNumaNode());
+  std::pmr::vector<int> values(100000, &resource);
+  std::iota(values.begin(), values.end(), 0);
+  EXPECT_EQ(values.back(), 99999);
+}
+
+TEST(ReplicatedKdTreeTest, Clone) {
+  KdTreeX tree(GenerateRandomN<PointX>(10000, Scalar(100.0)), 8);
+  std::pmr::monotonic_buffer_resource resource;
+  KdTreeX copy(tree, &resource);
+  EXPECT_EQ(copy.resource(), &resource);
+  EXPECT_EQ(copy.points().size(), tree.points().size());
+  TestKnn(copy, 10);
+}
+
+TEST(ReplicatedKdTreeTest, Search) {
+  KdTreeX tree(GenerateRandomN<PointX>(10000, Scalar(100.0)), 8);
+  pico_tree::ReplicatedKdTree<KdTreeX> replicated(tree);
+  EXPECT_EQ(replicated.size(), pico_tree::NumaNodeCount());
+
+  std::pmr::unsynchronized_pool_resource pool;
+  pico_tree::ReplicatedKdTree<KdTreeX> pooled(
+      tree, {std::pmr::new_delete_resource(), &pool});
+  EXPECT_EQ(pooled.size(), 2);
+  EXPECT_EQ(pooled.replica(1).resource(), &pool);
+
+  std::vector<typename KdTreeX::NeighborType> expected;
+  std::vector<typename KdTreeX::NeighborType> knn;
+  for (std::size_t i = 0; i < tree.points().size(); i += 97) {
+    tree.SearchKnn(tree.points()[i], 8, expected);
+    replicated.SearchKnn(tree.points()[i], 8, knn);
+    ExpectEqual(knn, expected);
+    pooled.replica(1).SearchKnn(tree.points()[i], 8, knn);
+    ExpectEqual(knn, expected);
+  }
+}
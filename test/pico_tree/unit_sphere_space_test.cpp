@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <pico_toolshed/point.hpp>
+#include <pico_tree/kd_tree.hpp>
+#include <pico_tree/vector_traits.hpp>
+#include <pico_understory/unit_sphere_space.hpp>
+
+#include "common.hpp"
+
+using PointX = Point2f;
+using Scalar = typename PointX::ScalarType;
+using UnitSphereSpaceX = pico_tree::UnitSphereSpace<Scalar>;
+
+namespace {
+
+std::vector<PointX> GenerateLatLon(std::size_t n) {
+  Scalar const pi = pico_tree::internal::kPi<Scalar>;
+  std::vector<PointX> points = GenerateRandomN<PointX>(n, -pi, pi);
+  for (auto& p : points) {
+    p[0] /= Scalar(2.0);
+  }
+  return points;
+}
+
+Scalar Angle(PointX const& a, PointX const& b) {
+  Scalar const h = pico_tree::Haversine()(a.data(), a.data() + 2, b.data());
+  return Scalar(2.0) * std::asin(std::sqrt(h));
+}
+
+}  // namespace
+
+TEST(UnitSphereSpaceTest, Convert) {
+  std::vector<PointX> random = GenerateLatLon(256);
+  UnitSphereSpaceX space(random);
+
+  EXPECT_EQ(space.size(), random.size());
+  EXPECT_EQ(space.sdim(), 3);
+
+  auto const q = space.Query(random[0]);
+  for (std::size_t i = 0; i < random.size(); ++i) {
+    auto const p = space[i];
+    EXPECT_NEAR(p[0] * p[0] + p[1] * p[1] + p[2] * p[2], 1.0f, 1e-5f);
+
+    Scalar const d =
+        pico_tree::L2Squared()(q.data(), q.data() + q.size(), p.data());
+    EXPECT_NEAR(UnitSphereSpaceX::Angle(d), Angle(random[0], random[i]), 1e-3f);
+  }
+
+  EXPECT_FLOAT_EQ(UnitSphereSpaceX::ChordSquared(1.0f / 3.0f), 0.1100861f);
+  EXPECT_FLOAT_EQ(
+      UnitSphereSpaceX::Angle(UnitSphereSpaceX::ChordSquared(0.5f)), 0.5f);
+}
+
+TEST(UnitSphereSpaceTest, QueryKnn) {
+  std::vector<PointX> random = GenerateLatLon(1024 * 16);
+  pico_tree::KdTree<UnitSphereSpaceX> tree(UnitSphereSpaceX(random), 8);
+
+  std::size_t const k = 8;
+  std::vector<typename pico_tree::KdTree<UnitSphereSpaceX>::NeighborType> knn;
+  std::vector<Scalar> compare(random.size());
+  for (auto const& q : GenerateLatLon(64)) {
+    tree.SearchKnn(tree.points().Query(q), k, knn);
+    ASSERT_EQ(knn.size(), k);
+
+    for (std::size_t i = 0; i < random.size(); ++i) {
+      compare[i] = Angle(q, random[i]);
+    }
+    std::partial_sort(compare.begin(), compare.begin() + k, compare.end());
+
+    for (std::size_t i = 0; i < k; ++i) {
+      EXPECT_NEAR(UnitSphereSpaceX::Angle(knn[i].distance), compare[i], 1e-3f);
+    }
+  }
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <pico_toolshed/point.hpp>
+#include <pico_tree/kd_tree.hpp>
+#include <pico_tree/vector_traits.hpp>
+#include <pico_understory/whitened_space.hpp>
+
+#include "common.hpp"
+
+using PointX = Point2f;
+using Scalar = typename PointX::ScalarType;
+using WhitenedSpaceX = pico_tree::WhitenedSpace<Scalar, PointX::Dim>;
+
+namespace {
+
+// Covariance matrix S = [[4, 1], [1, 2]] and its inverse.
+std::vector<Scalar> const kCovariance{4.0f, 1.0f, 1.0f, 2.0f};
+Scalar const kDet = 7.0f;
+Scalar const kInverse[4]{2.0f / kDet, -1.0f / kDet, -1.0f / kDet, 4.0f / kDet};
+
+Scalar Mahalanobis(PointX const& a, PointX const& b) {
+  Scalar const x = a[0] - b[0];
+  Scalar const y = a[1] - b[1];
+  return x * (kInverse[0] * x + kInverse[1] * y) +
+         y * (kInverse[2] * x + kInverse[3] * y);
+}
+
+}  // namespace
+
+TEST(WhitenedSpaceTest, Whiten) {
+  std::vector<PointX> random = GenerateRandomN<PointX>(256, -10.0f, 10.0f);
+  WhitenedSpaceX space(random, kCovariance);
+
+  EXPECT_EQ(space.size(), random.size());
+  EXPECT_EQ(space.sdim(), PointX::Dim);
+
+  auto const q = space.Query(random[0]);
+  for (std::size_t i = 0; i < random.size(); ++i) {
+    Scalar const d =
+        pico_tree::L2Squared()(q.data(), q.data() + q.size(), space[i].data());
+    EXPECT_NEAR(d, Mahalanobis(random[0], random[i]), 1e-3f);
+  }
+}
+
+TEST(WhitenedSpaceTest, Covariance) {
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024, -10.0f, 10.0f);
+  for (auto& p : random) {
+    p[1] = 0.5f * p[0] + 0.1f * p[1];
+  }
+  WhitenedSpaceX space(random);
+
+  // Whitened points have an identity covariance matrix.
+  Scalar mean[2]{0.0f, 0.0f};
+  for (std::size_t i = 0; i < space.size(); ++i) {
+    mean[0] += space[i][0];
+    mean[1] += space[i][1];
+  }
+  mean[0] /= static_cast<Scalar>(space.size());
+  mean[1] /= static_cast<Scalar>(space.size());
+
+  Scalar covariance[3]{0.0f, 0.0f, 0.0f};
+  for (std::size_t i = 0; i < space.size(); ++i) {
+    Scalar const x = space[i][0] - mean[0];
+    Scalar const y = space[i][1] - mean[1];
+    covariance[0] += x * x;
+    covariance[1] += x * y;
+    covariance[2] += y * y;
+  }
+  Scalar const n = static_cast<Scalar>(space.size() - 1);
+  EXPECT_NEAR(covariance[0] / n, 1.0f, 1e-3f);
+  EXPECT_NEAR(covariance[1] / n, 0.0f, 1e-3f);
+  EXPECT_NEAR(covariance[2] / n, 1.0f, 1e-3f);
+}
+
+TEST(WhitenedSpaceTest, QueryKnn) {
+  std::vector<PointX> random =
+      GenerateRandomN<PointX>(1024 * 16, -10.0f, 10.0f);
+  pico_tree::KdTree<WhitenedSpaceX> tree(
+      WhitenedSpaceX(random, kCovariance), 8);
+
+  std::size_t const k = 8;
+  std::vector<typename pico_tree::KdTree<WhitenedSpaceX>::NeighborType> knn;
+  std::vector<Scalar> compare(random.size());
+  for (auto const& q : GenerateRandomN<PointX>(64, -10.0f, 10.0f)) {
+    tree.SearchKnn(tree.points().Query(q), k, knn);
+    ASSERT_EQ(knn.size(), k);
+
+    for (std::size_t i = 0; i < random.size(); ++i) {
+      compare[i] = Mahalanobis(q, random[i]);
+    }
+    std::partial_sort(compare.begin(), compare.begin() + k, compare.end());
+
+    for (std::size_t i = 0; i < k; ++i) {
+      EXPECT_NEAR(knn[i].distance, compare[i], 1e-3f);
+    }
+  }
+}
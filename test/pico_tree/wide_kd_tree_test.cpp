@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <pico_toolshed/point.hpp>
+#include <pico_tree/kd_tree.hpp>
+#include <pico_tree/map_traits.hpp>
+#include <pico_tree/vector_traits.hpp>
+#include <pico_understory/wide_kd_tree.hpp>
+
+#include "common.hpp"
+
+namespace {
+
+template <typename PointX, pico_tree::Size Ways_>
+using WideKdTree = pico_tree::WideKdTree<
+    std::vector<PointX>,
+    pico_tree::L2Squared,
+    pico_tree::SplittingRule::kSlidingMidpoint,
+    int,
+    Ways_>;
+
+// The wide tree has the same structure as a KdTree and the results of both
+// should be the same.
+template <pico_tree::Size Ways_>
+void CompareToKdTree(std::size_t point_count, pico_tree::Size max_leaf_size) {
+  using PointX = Point3f;
+  using NeighborType = pico_tree::Neighbor<int, float>;
+  std::vector<PointX> random = GenerateRandomN<PointX>(point_count, 100.0f);
+  pico_tree::KdTree<std::vector<PointX>> tree(random, max_leaf_size);
+  WideKdTree<PointX, Ways_> wide(random, max_leaf_size);
+
+  std::vector<PointX> queries = GenerateRandomN<PointX>(256, 110.0f);
+  std::vector<NeighborType> knn;
+  std::vector<NeighborType> wide_knn;
+  for (auto const& q : queries) {
+    tree.SearchKnn(q, 8, knn);
+    wide.SearchKnn(q, 8, wide_knn);
+    ASSERT_EQ(knn.size(), wide_knn.size());
+    for (std::size_t i = 0; i < knn.size(); ++i) {
+      EXPECT_EQ(knn[i].index, wide_knn[i].index);
+      EXPECT_EQ(knn[i].distance, wide_knn[i].distance);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(WideKdTreeTest, QueryKnn) {
+  using PointX = Point2f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 128, 100.0f);
+  WideKdTree<PointX, 4> tree(random, 8);
+
+  TestKnn(tree, 10);
+}
+
+TEST(WideKdTreeTest, QueryRadius) {
+  using PointX = Point2f;
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 128, 100.0f);
+  WideKdTree<PointX, 8> tree(random, 8);
+
+  TestRadius(tree, 2.5f);
+}
+
+TEST(WideKdTreeTest, SameAsKdTree) {
+  CompareToKdTree<2>(1024 * 16, 8);
+  CompareToKdTree<4>(1024 * 16, 8);
+  CompareToKdTree<8>(1024 * 16, 8);
+  // Binary leaves end up at every level of a wide node.
+  CompareToKdTree<8>(100, 8);
+  CompareToKdTree<4>(5, 8);
+}
+
+// A query with a run-time dimension is searched with the compile-time
+// dimension of the tree.
+TEST(WideKdTreeTest, QueryKnnRtQuery) {
+  using PointX = Point3f;
+  using PointMapX = pico_tree::PointMap<float const, pico_tree::kDynamicSize>;
+  using NeighborType = pico_tree::Neighbor<int, float>;
+
+  std::vector<PointX> random = GenerateRandomN<PointX>(1024 * 64, 100.0f);
+  WideKdTree<PointX, 4> tree(random, 8);
+
+  std::vector<NeighborType> knn;
+  std::vector<NeighborType> rt_knn;
+  for (auto const& q : GenerateRandomN<PointX>(256, 110.0f)) {
+    tree.SearchKnn(q, 8, knn);
+    tree.SearchKnn(PointMapX(q.data(), q.size()), 8, rt_knn);
+    ASSERT_EQ(knn.size(), rt_knn.size());
+    for (std::size_t i = 0; i < knn.size(); ++i) {
+      EXPECT_EQ(knn[i].index, rt_knn[i].index);
+    }
+  }
+}